@@ -0,0 +1,247 @@
+#include "alloc.h"
+
+#ifdef SNAKE_ALLOC
+
+#include <execinfo.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#define BACKTRACE_DEPTH 32
+
+// Resolved by the linker (--wrap) to the allocator the game would have called
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static _Atomic uint64_t count = 0;
+static _Atomic uint64_t bytes = 0;
+static _Atomic uint64_t frees = 0;
+static _Atomic uint64_t sdl_count = 0;
+static _Atomic uint64_t sdl_bytes = 0;
+static _Atomic int64_t live_bytes = 0;
+static _Atomic int64_t peak_bytes = 0;
+static _Atomic uint64_t steady_count = 0;
+
+// Frames, only touched by the game loop thread
+static uint64_t frames = 0;
+static uint64_t game_frames = 0;
+static uint64_t frame_max_count = 0;
+static uint64_t frame_max_bytes = 0;
+static uint64_t frame_start_count = 0;
+static uint64_t frame_start_bytes = 0;
+static bool frame_open = false;
+
+static long warmup_frames = -1;        // -1: no assertion
+// Inside a frame after the warm-up: only set for the game loop thread, the
+// other threads (bot workers, log and capture writers) are not asserted
+static _Thread_local bool steady = false;
+static _Thread_local int allowed = 0;  // alloc_allow_begin depth
+static _Thread_local bool reporting = false;
+
+/**
+ * An allocation in the steady state: print where it comes from and abort.
+ */
+static void steady_violation(size_t size, bool sdl) {
+    reporting = true;
+    fprintf(stderr, "alloc: %zu byte(s) allocated%s in frame %llu of the game, after a warm-up of %ld frame(s)\n",
+        size, sdl ? " by SDL" : "", (unsigned long long)game_frames, warmup_frames);
+    void* stack[BACKTRACE_DEPTH];
+    int depth = backtrace(stack, BACKTRACE_DEPTH);
+    backtrace_symbols_fd(stack, depth, STDERR_FILENO);
+    abort();
+}
+
+static void* account(void* ptr, size_t size, bool sdl) {
+    if (!ptr) {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes, size, memory_order_relaxed);
+    if (sdl) {
+        atomic_fetch_add_explicit(&sdl_count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&sdl_bytes, size, memory_order_relaxed);
+    }
+    int64_t live = atomic_fetch_add_explicit(&live_bytes, (int64_t)malloc_usable_size(ptr), memory_order_relaxed)
+        + (int64_t)malloc_usable_size(ptr);
+    int64_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, live,
+        memory_order_relaxed, memory_order_relaxed)) {
+    }
+    if (__builtin_expect(steady, 0) && !allowed) {
+        atomic_fetch_add_explicit(&steady_count, 1, memory_order_relaxed);
+        if (!reporting) {
+            steady_violation(size, sdl);
+        }
+    }
+    return ptr;
+}
+
+static void release(void* ptr) {
+    if (ptr) {
+        atomic_fetch_add_explicit(&frees, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&live_bytes, (int64_t)malloc_usable_size(ptr), memory_order_relaxed);
+    }
+}
+
+static void* resize(void* ptr, size_t size, bool sdl) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void* block = __real_realloc(ptr, size);
+    if (!block && size > 0) {
+        return NULL;   // ptr is untouched
+    }
+    if (ptr) {
+        atomic_fetch_sub_explicit(&live_bytes, (int64_t)old_size, memory_order_relaxed);
+        atomic_fetch_add_explicit(&frees, 1, memory_order_relaxed);
+    }
+    return account(block, size, sdl);
+}
+
+void* __wrap_malloc(size_t size) {
+    return account(__real_malloc(size), size, false);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    return account(__real_calloc(count, size), count * size, false);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    return resize(ptr, size, false);
+}
+
+void __wrap_free(void* ptr) {
+    release(ptr);
+    __real_free(ptr);
+}
+
+static void* sdl_malloc(size_t size) {
+    return account(__real_malloc(size), size, true);
+}
+
+static void* sdl_calloc(size_t count, size_t size) {
+    return account(__real_calloc(count, size), count * size, true);
+}
+
+static void* sdl_realloc(void* ptr, size_t size) {
+    return resize(ptr, size, true);
+}
+
+static void sdl_free(void* ptr) {
+    release(ptr);
+    __real_free(ptr);
+}
+
+bool alloc_init(void) {
+    if (SDL_SetMemoryFunctions(sdl_malloc, sdl_calloc, sdl_realloc, sdl_free) != 0) {
+        fprintf(stderr, "alloc: SDL allocations are not counted\n");
+    }
+    const char* mode = getenv("SNAKE_ALLOC_ASSERT");
+    if (mode && *mode && *mode != '0') {
+        char* end;
+        warmup_frames = strtol(mode, &end, 10);
+        if (*end || warmup_frames < 0) {
+            warmup_frames = ALLOC_DEFAULT_WARMUP;
+        }
+        printf("alloc: aborting on allocations after %ld warm-up frame(s)\n", warmup_frames);
+    }
+    return true;
+}
+
+void alloc_game_begin(void) {
+    game_frames = 0;
+}
+
+void alloc_frame_begin(void) {
+    if (frame_open) {
+        alloc_frame_end();
+    }
+    frame_open = true;
+    frame_start_count = atomic_load_explicit(&count, memory_order_relaxed);
+    frame_start_bytes = atomic_load_explicit(&bytes, memory_order_relaxed);
+    steady = warmup_frames >= 0 && game_frames >= (uint64_t)warmup_frames;
+}
+
+void alloc_frame_end(void) {
+    if (!frame_open) {
+        return;
+    }
+    steady = false;
+    frame_open = false;
+    uint64_t frame_count = atomic_load_explicit(&count, memory_order_relaxed) - frame_start_count;
+    uint64_t frame_bytes = atomic_load_explicit(&bytes, memory_order_relaxed) - frame_start_bytes;
+    frame_max_count = (frame_count > frame_max_count) ? frame_count : frame_max_count;
+    frame_max_bytes = (frame_bytes > frame_max_bytes) ? frame_bytes : frame_max_bytes;
+    frames++;
+    game_frames++;
+}
+
+void alloc_allow_begin(void) {
+    allowed++;
+}
+
+void alloc_allow_end(void) {
+    allowed--;
+}
+
+void alloc_get_stats(struct alloc_stats* stats) {
+    *stats = (struct alloc_stats){
+        .count = atomic_load(&count),
+        .bytes = atomic_load(&bytes),
+        .frees = atomic_load(&frees),
+        .sdl_count = atomic_load(&sdl_count),
+        .sdl_bytes = atomic_load(&sdl_bytes),
+        .live_bytes = atomic_load(&live_bytes),
+        .peak_bytes = atomic_load(&peak_bytes),
+        .frames = frames,
+        .frame_max_count = frame_max_count,
+        .frame_max_bytes = frame_max_bytes,
+        .steady_count = atomic_load(&steady_count),
+    };
+}
+
+void alloc_report(FILE* stream) {
+    struct alloc_stats stats;
+    alloc_get_stats(&stats);
+    fprintf(stream, "alloc: %llu allocation(s), %llu bytes (SDL %llu, %llu bytes), %llu free(s)\n",
+        (unsigned long long)stats.count, (unsigned long long)stats.bytes,
+        (unsigned long long)stats.sdl_count, (unsigned long long)stats.sdl_bytes, (unsigned long long)stats.frees);
+    fprintf(stream, "alloc: live %lld bytes, peak %lld bytes\n", (long long)stats.live_bytes, (long long)stats.peak_bytes);
+    fprintf(stream, "alloc: %llu frame(s), at most %llu allocation(s) / %llu bytes in one frame\n",
+        (unsigned long long)stats.frames, (unsigned long long)stats.frame_max_count,
+        (unsigned long long)stats.frame_max_bytes);
+}
+
+#else
+
+bool alloc_init(void) {
+    return false;
+}
+
+void alloc_game_begin(void) {
+}
+
+void alloc_frame_begin(void) {
+}
+
+void alloc_frame_end(void) {
+}
+
+void alloc_allow_begin(void) {
+}
+
+void alloc_allow_end(void) {
+}
+
+void alloc_get_stats(struct alloc_stats* stats) {
+    *stats = (struct alloc_stats){ 0 };
+}
+
+void alloc_report(FILE* stream) {
+    fprintf(stream, "alloc: accounting not compiled in (make ALLOC=1)\n");
+}
+
+#endif
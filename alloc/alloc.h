@@ -0,0 +1,82 @@
+#ifndef _ALLOC_H_
+#define _ALLOC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Heap allocation accounting, compiled in by `make ALLOC=1`: the game
+ * objects are linked with --wrap=malloc,calloc,realloc,free and SDL gets
+ * counting memory functions (SDL_SetMemoryFunctions), so allocations from
+ * both the game and SDL are counted. Other libraries are not seen.
+ *
+ * Counters are kept per frame (alloc_frame_begin / alloc_frame_end): the
+ * largest frame in count and bytes, and the peak of live bytes. With
+ * SNAKE_ALLOC_ASSERT=<frames>, any allocation made by the game loop thread
+ * inside a frame once that many frames of a game have run prints its call
+ * stack and aborts: the steady state of the game loop must not allocate.
+ * Other threads are not asserted, and alloc_allow_begin / alloc_allow_end
+ * exempt a growth that only happens when a high-water mark is passed.
+ *
+ * Without ALLOC=1 the functions are no-ops and alloc_report says so.
+ */
+#define ALLOC_DEFAULT_WARMUP 120   // frames when SNAKE_ALLOC_ASSERT is not a number
+
+struct alloc_stats {
+    uint64_t count;           // allocations (malloc, calloc, realloc), SDL included
+    uint64_t bytes;           // bytes requested
+    uint64_t frees;
+    uint64_t sdl_count;       // allocations made by SDL
+    uint64_t sdl_bytes;
+    int64_t live_bytes;       // usable size of the blocks not freed yet
+    int64_t peak_bytes;
+    uint64_t frames;
+    uint64_t frame_max_count; // most allocations in a single frame
+    uint64_t frame_max_bytes;
+    uint64_t steady_count;    // allocations in frames after the warm-up
+};
+
+/**
+ * Install the SDL memory functions (before SDL_Init) and read
+ * SNAKE_ALLOC_ASSERT.
+ *
+ * @return true if accounting is compiled in.
+ */
+bool alloc_init(void);
+
+/**
+ * Restart the warm-up, at the start of a game.
+ */
+void alloc_game_begin(void);
+
+void alloc_frame_begin(void);
+
+/**
+ * Close a frame: update the per-frame maxima.
+ */
+void alloc_frame_end(void);
+
+/**
+ * Exempt the allocations of the calling thread from the steady state
+ * assertion until the matching alloc_allow_end (they are still counted).
+ */
+void alloc_allow_begin(void);
+
+void alloc_allow_end(void);
+
+/**
+ * Read the counters.
+ *
+ * @param stats Receives the counters.
+ */
+void alloc_get_stats(struct alloc_stats* stats);
+
+/**
+ * Print the counters.
+ *
+ * @param stream The output stream.
+ */
+void alloc_report(FILE* stream);
+
+#endif
@@ -0,0 +1,229 @@
+#include "bitboard.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 256-bit vector of words (GCC vector extension): compiled to AVX2 or
+ * pairs of SSE2 registers depending on the target.
+ */
+typedef uint64_t bitboard_vec __attribute__((vector_size(32), aligned(32), may_alias));
+
+#define ROW_BYTES(board) ((size_t)(board)->words_per_row * sizeof(uint64_t))
+
+struct bitboard_t* bitboard_create(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+    struct bitboard_t* board = malloc(sizeof(struct bitboard_t));
+    if (!board) {
+        fprintf(stderr, "Failed to allocate memory for bitboard");
+        return NULL;
+    }
+    board->width = width;
+    board->height = height;
+    board->words_per_row = (width + 255) / 256 * BITBOARD_VECTOR_WORDS;
+    board->bits = aligned_alloc(sizeof(bitboard_vec), ROW_BYTES(board) * height);
+    if (!board->bits) {
+        fprintf(stderr, "Failed to allocate memory for bitboard");
+        free(board);
+        return NULL;
+    }
+    bitboard_clear(board);
+    return board;
+}
+
+void bitboard_destroy(struct bitboard_t** board) {
+    if (!board || !*board) {
+        return;
+    }
+    free((*board)->bits);
+    free(*board);
+    *board = NULL;
+}
+
+void bitboard_clear(struct bitboard_t* board) {
+    memset(board->bits, 0, ROW_BYTES(board) * board->height);
+}
+
+void bitboard_copy(struct bitboard_t* dst, const struct bitboard_t* src) {
+    memcpy(dst->bits, src->bits, ROW_BYTES(src) * src->height);
+}
+
+int bitboard_count(const struct bitboard_t* board) {
+    const size_t words = (size_t)board->words_per_row * board->height;
+    int count = 0;
+    for (size_t i = 0; i < words; i++) {
+        count += __builtin_popcountll(board->bits[i]);
+    }
+    return count;
+}
+
+bool bitboard_intersects(const struct bitboard_t* a, const struct bitboard_t* b) {
+    const size_t vectors = (size_t)a->words_per_row * a->height / BITBOARD_VECTOR_WORDS;
+    const bitboard_vec* va = (const bitboard_vec*)a->bits;
+    const bitboard_vec* vb = (const bitboard_vec*)b->bits;
+    bitboard_vec any = { 0 };
+    for (size_t i = 0; i < vectors; i++) {
+        any |= va[i] & vb[i];
+    }
+    return (any[0] | any[1] | any[2] | any[3]) != 0;
+}
+
+/**
+ * Horizontal closure of one row: every run of mask bits containing a seed
+ * is filled entirely. Seeds must be a subset of mask.
+ *
+ * Towards higher columns, adding the seeds to the mask makes the carry run
+ * through each seeded run (multi-word add). Towards lower columns, a
+ * Kogge-Stone occluded fill spreads each word in 6 shift/and/or steps, the
+ * word boundary being crossed from the high word to the low one.
+ */
+static void row_close(const uint64_t* mask, const uint64_t* seeds, uint64_t* out, int words) {
+    uint64_t carry = 0;
+    for (int i = 0; i < words; i++) {
+        uint64_t sum = mask[i] + seeds[i];
+        uint64_t carry_out = sum < mask[i];
+        uint64_t total = sum + carry;
+        carry_out |= total < sum;
+        out[i] = ((total ^ mask[i]) & mask[i]) | seeds[i];
+        carry = carry_out;
+    }
+
+    for (int i = words - 1; i >= 0; i--) {
+        uint64_t gen = out[i];
+        uint64_t pro = mask[i];
+        if (i + 1 < words && (out[i + 1] & 1u)) {
+            gen |= pro & (UINT64_C(1) << 63);
+        }
+        gen |= pro & (gen >> 1);
+        pro &= pro >> 1;
+        gen |= pro & (gen >> 2);
+        pro &= pro >> 2;
+        gen |= pro & (gen >> 4);
+        pro &= pro >> 4;
+        gen |= pro & (gen >> 8);
+        pro &= pro >> 8;
+        gen |= pro & (gen >> 16);
+        pro &= pro >> 16;
+        gen |= pro & (gen >> 32);
+        out[i] = gen;
+    }
+}
+
+/**
+ * Grow the region on one row from itself and its vertical neighbours.
+ *
+ * @return true if the row changed.
+ */
+static bool grow_row(const struct bitboard_t* passable, struct bitboard_t* region, int y, uint64_t* seeds) {
+    const int words = region->words_per_row;
+    const int vectors = words / BITBOARD_VECTOR_WORDS;
+    const bitboard_vec* mask = (const bitboard_vec*)bitboard_row(passable, y);
+    bitboard_vec* row = (bitboard_vec*)bitboard_row(region, y);
+    const bitboard_vec* above = (y > 0) ? (const bitboard_vec*)bitboard_row(region, y - 1) : NULL;
+    const bitboard_vec* below = (y + 1 < region->height) ? (const bitboard_vec*)bitboard_row(region, y + 1) : NULL;
+    bitboard_vec* seed_vectors = (bitboard_vec*)seeds;
+
+    // Vertical dilation: seeds = (row | above | below) & mask
+    bitboard_vec fresh = { 0 };
+    for (int v = 0; v < vectors; v++) {
+        bitboard_vec neighbours = row[v];
+        if (above) {
+            neighbours |= above[v];
+        }
+        if (below) {
+            neighbours |= below[v];
+        }
+        seed_vectors[v] = neighbours & mask[v];
+        fresh |= seed_vectors[v] & ~row[v];
+    }
+    if ((fresh[0] | fresh[1] | fresh[2] | fresh[3]) == 0) {
+        return false;
+    }
+
+    // Horizontal closure, keeping the (possibly non passable) start cell
+    uint64_t* words_out = bitboard_row(region, y);
+    uint64_t closed[words];
+    row_close(bitboard_row(passable, y), seeds, closed, words);
+    for (int i = 0; i < words; i++) {
+        words_out[i] |= closed[i];
+    }
+    return true;
+}
+
+/**
+ * Seed the region with the start cell and its passable 4-neighbours, then
+ * sweep down and up until no row changes. Each sweep carries the region
+ * across any number of rows, so the number of sweeps depends on how often
+ * the paths turn back vertically, not on their length.
+ */
+static bool flood(const struct bitboard_t* passable, int x, int y, struct bitboard_t* region, const struct bitboard_t* targets) {
+    bitboard_clear(region);
+    if (!bitboard_inside(region, x, y)) {
+        return false;
+    }
+    bitboard_set(region, x, y);
+    static const int dx[] = { -1, 1, 0, 0 };
+    static const int dy[] = { 0, 0, -1, 1 };
+    for (int i = 0; i < 4; i++) {
+        int nx = x + dx[i], ny = y + dy[i];
+        if (bitboard_inside(passable, nx, ny) && bitboard_test(passable, nx, ny)) {
+            bitboard_set(region, nx, ny);
+        }
+    }
+
+    // Rows of the region are kept horizontally closed from here on
+    const int words = region->words_per_row;
+    uint64_t seeds[words] __attribute__((aligned(32)));
+    uint64_t closed[words];
+    for (int row = y - 1; row <= y + 1; row++) {
+        if (row < 0 || row >= region->height) {
+            continue;
+        }
+        uint64_t* bits = bitboard_row(region, row);
+        const uint64_t* mask = bitboard_row(passable, row);
+        for (int w = 0; w < words; w++) {
+            seeds[w] = bits[w] & mask[w];
+        }
+        row_close(mask, seeds, closed, words);
+        for (int w = 0; w < words; w++) {
+            bits[w] |= closed[w];
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < region->height; i++) {
+                int row = (pass == 0) ? i : region->height - 1 - i;
+                if (!grow_row(passable, region, row, seeds)) {
+                    continue;
+                }
+                changed = true;
+                if (targets) {
+                    const uint64_t* reached = bitboard_row(region, row);
+                    const uint64_t* wanted = bitboard_row(targets, row);
+                    for (int w = 0; w < words; w++) {
+                        if (reached[w] & wanted[w]) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return targets && bitboard_intersects(region, targets);
+}
+
+int bitboard_flood_fill(const struct bitboard_t* passable, int x, int y, struct bitboard_t* region) {
+    flood(passable, x, y, region, NULL);
+    return bitboard_count(region);
+}
+
+bool bitboard_reachable(const struct bitboard_t* passable, int x, int y,
+    const struct bitboard_t* targets, struct bitboard_t* scratch) {
+    return flood(passable, x, y, scratch, targets);
+}
@@ -0,0 +1,116 @@
+#ifndef _BITBOARD_H_
+#define _BITBOARD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bit-packed board: one bit per cell, bit x of a row lives in word x / 64.
+ * Rows are padded to a multiple of 256 bits (4 words) so that each row is a
+ * whole number of SIMD vectors; padding bits are always 0.
+ */
+#define BITBOARD_VECTOR_WORDS 4
+
+struct bitboard_t {
+    int width;
+    int height;
+    int words_per_row;   // multiple of BITBOARD_VECTOR_WORDS
+    uint64_t* bits;      // height * words_per_row words, 32-byte aligned
+};
+
+/**
+ * Allocate an empty bitboard.
+ *
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @return A pointer to the bitboard, or NULL if allocation fails.
+ */
+struct bitboard_t* bitboard_create(int width, int height);
+
+/**
+ * Free a bitboard.
+ *
+ * @param board A pointer to the pointer of the bitboard to free.
+ */
+void bitboard_destroy(struct bitboard_t** board);
+
+/**
+ * Clear every cell.
+ *
+ * @param board The bitboard.
+ */
+void bitboard_clear(struct bitboard_t* board);
+
+/**
+ * Copy the cells of a bitboard into another one of the same size.
+ *
+ * @param dst The destination bitboard.
+ * @param src The source bitboard.
+ */
+void bitboard_copy(struct bitboard_t* dst, const struct bitboard_t* src);
+
+/**
+ * Count the set cells (popcount).
+ *
+ * @param board The bitboard.
+ * @return The number of set cells.
+ */
+int bitboard_count(const struct bitboard_t* board);
+
+/**
+ * Check whether two bitboards of the same size share a set cell.
+ *
+ * @param a The first bitboard.
+ * @param b The second bitboard.
+ * @return true if at least one cell is set in both.
+ */
+bool bitboard_intersects(const struct bitboard_t* a, const struct bitboard_t* b);
+
+/**
+ * Compute the 4-connected region of passable cells reachable from a start cell.
+ * The start cell is part of the region even if it is not passable (e.g. the head).
+ *
+ * @param passable Cells that can be entered.
+ * @param x Column of the start cell.
+ * @param y Row of the start cell.
+ * @param region Receives the region (same size as passable).
+ * @return The number of cells of the region.
+ */
+int bitboard_flood_fill(const struct bitboard_t* passable, int x, int y, struct bitboard_t* region);
+
+/**
+ * Check whether any target cell can be reached from a start cell.
+ * Stops as soon as the growing region touches a target.
+ *
+ * @param passable Cells that can be entered (targets must be passable).
+ * @param x Column of the start cell.
+ * @param y Row of the start cell.
+ * @param targets Cells to reach.
+ * @param scratch Work bitboard of the same size, overwritten.
+ * @return true if a target is reachable.
+ */
+bool bitboard_reachable(const struct bitboard_t* passable, int x, int y,
+    const struct bitboard_t* targets, struct bitboard_t* scratch);
+
+static inline uint64_t* bitboard_row(const struct bitboard_t* board, int y) {
+    return board->bits + (size_t)y * board->words_per_row;
+}
+
+static inline bool bitboard_inside(const struct bitboard_t* board, int x, int y) {
+    return x >= 0 && y >= 0 && x < board->width && y < board->height;
+}
+
+static inline bool bitboard_test(const struct bitboard_t* board, int x, int y) {
+    return (bitboard_row(board, y)[x >> 6] >> (x & 63)) & 1u;
+}
+
+static inline void bitboard_set(struct bitboard_t* board, int x, int y) {
+    bitboard_row(board, y)[x >> 6] |= UINT64_C(1) << (x & 63);
+}
+
+static inline void bitboard_reset(struct bitboard_t* board, int x, int y) {
+    bitboard_row(board, y)[x >> 6] &= ~(UINT64_C(1) << (x & 63));
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "board.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char* layout_names[] = {
+    [BOARD_ROW_MAJOR] = "row",
+    [BOARD_TILED] = "tiled",
+    [BOARD_MORTON] = "morton",
+};
+
+static int ceil_log2(int value) {
+    int bits = 0;
+    while ((1 << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+struct board_t* board_create(int width, int height, enum board_layout layout) {
+    if (width <= 0 || height <= 0 || layout >= BOARD_LAYOUTS) {
+        return NULL;
+    }
+    struct board_t* board = calloc(1, sizeof(struct board_t));
+    if (!board) {
+        fprintf(stderr, "Failed to allocate memory for board");
+        return NULL;
+    }
+    board->width = width;
+    board->height = height;
+    board->layout = layout;
+
+    switch (layout) {
+    case BOARD_TILED: {
+        board->tiles_per_row = (width + BOARD_TILE - 1) / BOARD_TILE;
+        int tile_rows = (height + BOARD_TILE - 1) / BOARD_TILE;
+        board->size = (size_t)board->tiles_per_row * tile_rows * BOARD_TILE * BOARD_TILE;
+        break;
+    }
+    case BOARD_MORTON: {
+        int x_bits = ceil_log2(width), y_bits = ceil_log2(height);
+        board->morton_wide = (x_bits >= y_bits);
+        board->morton_bits = board->morton_wide ? y_bits : x_bits;
+        board->size = (size_t)1 << (x_bits + y_bits);
+        break;
+    }
+    default:
+        board->size = (size_t)width * height;
+        break;
+    }
+
+    board->cells = aligned_alloc(BOARD_ALIGN, (board->size + BOARD_ALIGN - 1) / BOARD_ALIGN * BOARD_ALIGN);
+    if (!board->cells) {
+        fprintf(stderr, "Failed to allocate memory for board");
+        free(board);
+        return NULL;
+    }
+    board_clear(board);
+    return board;
+}
+
+void board_destroy(struct board_t** board) {
+    if (!board || !*board) {
+        return;
+    }
+    free((*board)->cells);
+    free(*board);
+    *board = NULL;
+}
+
+void board_clear(struct board_t* board) {
+    memset(board->cells, 0, board->size);
+}
+
+void board_copy_rows(const struct board_t* board, uint8_t* out) {
+    if (board->layout == BOARD_ROW_MAJOR) {
+        memcpy(out, board->cells, board->size);
+        return;
+    }
+    for (int y = 0; y < board->height; y++) {
+        for (int x = 0; x < board->width; x++) {
+            *out++ = board_get(board, x, y);
+        }
+    }
+}
+
+const char* board_layout_name(enum board_layout layout) {
+    return (layout < BOARD_LAYOUTS) ? layout_names[layout] : "?";
+}
+
+bool board_layout_find(const char* name, enum board_layout* layout) {
+    for (int i = 0; i < BOARD_LAYOUTS; i++) {
+        if (strcasecmp(name, layout_names[i]) == 0) {
+            *layout = (enum board_layout)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,129 @@
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Board of one byte per cell stored in one of several layouts, all read and
+ * written through board_get / board_set:
+ *
+ *   row-major  cell (x, y) at y * width + x, like ctxt->pixels;
+ *   tiled      8x8 tiles of 64 bytes (one cache line), tiles row-major and
+ *              cells row-major inside a tile: a 4-neighbour of a cell is in
+ *              the same line 7 times out of 8, where a row-major neighbour
+ *              above or below never is;
+ *   morton     Z-order: the bits of x and y interleaved, so that cells close
+ *              in 2D are close in memory at every scale. The sides are padded
+ *              to powers of two; on a non-square board the extra high bits of
+ *              the longer side select a square Z-ordered block.
+ */
+#define BOARD_TILE_BITS 3
+#define BOARD_TILE (1 << BOARD_TILE_BITS)
+#define BOARD_ALIGN 64
+
+enum board_layout {
+    BOARD_ROW_MAJOR,
+    BOARD_TILED,
+    BOARD_MORTON,
+    BOARD_LAYOUTS
+};
+
+struct board_t {
+    int width;
+    int height;
+    enum board_layout layout;
+    int tiles_per_row;       // tiled
+    int morton_bits;         // morton: interleaved bits of each coordinate
+    int morton_wide;         // morton: x (1) or y (0) has the extra high bits
+    size_t size;             // bytes of cells, padding included
+    uint8_t* cells;          // BOARD_ALIGN aligned
+};
+
+/**
+ * Allocate a board with every cell 0.
+ *
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param layout The layout of the cells.
+ * @return A pointer to the board, or NULL if allocation fails.
+ */
+struct board_t* board_create(int width, int height, enum board_layout layout);
+
+/**
+ * Free a board.
+ *
+ * @param board A pointer to the pointer of the board to free.
+ */
+void board_destroy(struct board_t** board);
+
+/**
+ * Set every cell to 0.
+ *
+ * @param board The board.
+ */
+void board_clear(struct board_t* board);
+
+/**
+ * Copy the cells in row-major order, whatever the layout.
+ *
+ * @param board The board.
+ * @param out Receives width * height bytes.
+ */
+void board_copy_rows(const struct board_t* board, uint8_t* out);
+
+/**
+ * @return The name of a layout ("row", "tiled", "morton").
+ */
+const char* board_layout_name(enum board_layout layout);
+
+/**
+ * Find a layout by name.
+ *
+ * @param name The name of the layout.
+ * @param layout Receives the layout.
+ * @return true if the name is known.
+ */
+bool board_layout_find(const char* name, enum board_layout* layout);
+
+/**
+ * Spread the low 32 bits of a value to the even bits of the result.
+ */
+static inline uint64_t board_spread_bits(uint32_t value) {
+    uint64_t bits = value;
+    bits = (bits | (bits << 16)) & UINT64_C(0x0000FFFF0000FFFF);
+    bits = (bits | (bits << 8)) & UINT64_C(0x00FF00FF00FF00FF);
+    bits = (bits | (bits << 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+    bits = (bits | (bits << 2)) & UINT64_C(0x3333333333333333);
+    bits = (bits | (bits << 1)) & UINT64_C(0x5555555555555555);
+    return bits;
+}
+
+static inline size_t board_index(const struct board_t* board, int x, int y) {
+    switch (board->layout) {
+    case BOARD_TILED: {
+        size_t tile = (size_t)(y >> BOARD_TILE_BITS) * board->tiles_per_row + (size_t)(x >> BOARD_TILE_BITS);
+        return (tile << (2 * BOARD_TILE_BITS))
+            | ((size_t)(y & (BOARD_TILE - 1)) << BOARD_TILE_BITS) | (size_t)(x & (BOARD_TILE - 1));
+    }
+    case BOARD_MORTON: {
+        uint32_t mask = ((uint32_t)1 << board->morton_bits) - 1;
+        uint64_t low = board_spread_bits((uint32_t)x & mask) | (board_spread_bits((uint32_t)y & mask) << 1);
+        uint64_t high = (uint32_t)(board->morton_wide ? x : y) >> board->morton_bits;
+        return (size_t)((high << (2 * board->morton_bits)) | low);
+    }
+    default:
+        return (size_t)y * board->width + (size_t)x;
+    }
+}
+
+static inline uint8_t board_get(const struct board_t* board, int x, int y) {
+    return board->cells[board_index(board, x, y)];
+}
+
+static inline void board_set(struct board_t* board, int x, int y, uint8_t value) {
+    board->cells[board_index(board, x, y)] = value;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "chunked.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_ALIGN 64     // alignment of struct chunk_t, its size is a multiple of it
+#define TABLE_MAX_LOAD 2   // the table doubles when more than 1 / TABLE_MAX_LOAD full
+
+static inline size_t table_slot(const struct chunked_board_t* board, uint64_t key) {
+    return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (board->table_size - 1);
+}
+
+static bool table_resize(struct chunked_board_t* board, size_t size) {
+    struct chunk_entry* table = calloc(size, sizeof(struct chunk_entry));
+    if (!table) {
+        fprintf(stderr, "Failed to allocate memory for chunk table");
+        return false;
+    }
+    struct chunk_entry* old = board->table;
+    size_t old_size = board->table_size;
+    board->table = table;
+    board->table_size = size;
+    for (size_t i = 0; i < old_size; i++) {
+        if (old[i].chunk) {
+            size_t slot = table_slot(board, old[i].key);
+            while (table[slot].chunk) {
+                slot = (slot + 1) & (size - 1);
+            }
+            table[slot] = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
+
+/**
+ * Remove a key, shifting the following entries of its probe sequence back
+ * so that no tombstone is needed.
+ */
+static void table_remove(struct chunked_board_t* board, uint64_t key) {
+    const size_t mask = board->table_size - 1;
+    size_t slot = table_slot(board, key);
+    while (board->table[slot].key != key || !board->table[slot].chunk) {
+        slot = (slot + 1) & mask;
+    }
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; board->table[next].chunk; next = (next + 1) & mask) {
+        size_t home = table_slot(board, board->table[next].key);
+        // Move the entry back unless its home lies in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            board->table[hole] = board->table[next];
+            hole = next;
+        }
+    }
+    board->table[hole] = (struct chunk_entry){ 0, NULL };
+    board->live--;
+}
+
+/**
+ * Take an empty chunk from the pool, growing it by a slab when it is empty.
+ */
+static struct chunk_t* pool_take(struct chunked_board_t* board) {
+    if (!board->free_chunks) {
+        if (board->slab_count == board->slab_capacity) {
+            size_t capacity = board->slab_capacity ? board->slab_capacity * 2 : 16;
+            struct chunk_t** slabs = realloc(board->slabs, capacity * sizeof(struct chunk_t*));
+            if (!slabs) {
+                fprintf(stderr, "Failed to allocate memory for chunk slabs");
+                return NULL;
+            }
+            board->slabs = slabs;
+            board->slab_capacity = capacity;
+        }
+        struct chunk_t* slab = aligned_alloc(CHUNK_ALIGN, CHUNK_SLAB * sizeof(struct chunk_t));
+        if (!slab) {
+            fprintf(stderr, "Failed to allocate memory for chunks");
+            return NULL;
+        }
+        board->slabs[board->slab_count++] = slab;
+        for (int i = CHUNK_SLAB - 1; i >= 0; i--) {
+            memset(slab[i].cells, 0, CHUNK_CELLS);
+            slab[i].next_free = board->free_chunks;
+            board->free_chunks = &slab[i];
+        }
+        board->pooled += CHUNK_SLAB;
+    }
+    struct chunk_t* chunk = board->free_chunks;
+    board->free_chunks = chunk->next_free;
+    board->pooled--;
+    return chunk;   // cells already 0
+}
+
+static void pool_give(struct chunked_board_t* board, struct chunk_t* chunk) {
+    chunk->next_free = board->free_chunks;
+    board->free_chunks = chunk;
+    board->pooled++;
+}
+
+struct chunked_board_t* chunked_create(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+    struct chunked_board_t* board = calloc(1, sizeof(struct chunked_board_t));
+    if (!board) {
+        fprintf(stderr, "Failed to allocate memory for chunked board");
+        return NULL;
+    }
+    board->width = width;
+    board->height = height;
+    if (!table_resize(board, CHUNK_TABLE_INITIAL)) {
+        free(board);
+        return NULL;
+    }
+    return board;
+}
+
+void chunked_destroy(struct chunked_board_t** board) {
+    if (!board || !*board) {
+        return;
+    }
+    for (size_t i = 0; i < (*board)->slab_count; i++) {
+        free((*board)->slabs[i]);
+    }
+    free((*board)->slabs);
+    free((*board)->table);
+    free(*board);
+    *board = NULL;
+}
+
+void chunked_clear(struct chunked_board_t* board) {
+    for (size_t i = 0; i < board->table_size; i++) {
+        struct chunk_t* chunk = board->table[i].chunk;
+        if (chunk) {
+            memset(chunk->cells, 0, CHUNK_CELLS);
+            pool_give(board, chunk);
+            board->table[i] = (struct chunk_entry){ 0, NULL };
+        }
+    }
+    board->live = 0;
+    board->hot = NULL;
+}
+
+static struct chunk_t* table_find(const struct chunked_board_t* board, uint64_t key) {
+    const size_t mask = board->table_size - 1;
+    for (size_t slot = table_slot(board, key); board->table[slot].chunk; slot = (slot + 1) & mask) {
+        if (board->table[slot].key == key) {
+            return board->table[slot].chunk;
+        }
+    }
+    return NULL;
+}
+
+struct chunk_t* chunked_find(struct chunked_board_t* board, uint64_t key) {
+    struct chunk_t* chunk = table_find(board, key);
+    if (chunk) {
+        board->hot = chunk;
+    }
+    return chunk;
+}
+
+bool chunked_set_slow(struct chunked_board_t* board, int x, int y, uint8_t value) {
+    uint64_t key = chunked_key(x, y);
+    struct chunk_t* chunk = chunked_find(board, key);
+    if (!chunk) {
+        if (value == 0) {
+            return true;
+        }
+        if ((board->live + 1) * TABLE_MAX_LOAD > board->table_size
+            && !table_resize(board, board->table_size * 2)) {
+            return false;
+        }
+        chunk = pool_take(board);
+        if (!chunk) {
+            return false;
+        }
+        chunk->key = key;
+        chunk->occupied = 0;
+        size_t slot = table_slot(board, key);
+        while (board->table[slot].chunk) {
+            slot = (slot + 1) & (board->table_size - 1);
+        }
+        board->table[slot] = (struct chunk_entry){ key, chunk };
+        board->live++;
+        board->hot = chunk;
+    }
+
+    uint8_t* cell = &chunk->cells[chunked_offset(x, y)];
+    if (*cell == 0 && value != 0) {
+        chunk->occupied++;
+    } else if (*cell != 0 && value == 0) {
+        if (--chunk->occupied == 0) {
+            // Last cell emptied: the chunk goes back to the pool, all 0
+            *cell = 0;
+            table_remove(board, key);
+            if (board->hot == chunk) {
+                board->hot = NULL;
+            }
+            pool_give(board, chunk);
+            return true;
+        }
+    }
+    *cell = value;
+    return true;
+}
+
+void chunked_copy_rows(const struct chunked_board_t* board, int x0, int y0, int width, int height, uint8_t* out) {
+    for (int y = y0; y < y0 + height; y++) {
+        int x = x0;
+        while (x < x0 + width) {
+            // One chunk row segment at a time
+            int end = ((x >> CHUNK_BITS) + 1) << CHUNK_BITS;
+            if (end > x0 + width) {
+                end = x0 + width;
+            }
+            const struct chunk_t* chunk = table_find(board, chunked_key(x, y));
+            if (chunk) {
+                memcpy(out, &chunk->cells[chunked_offset(x, y)], (size_t)(end - x));
+            } else {
+                memset(out, 0, (size_t)(end - x));
+            }
+            out += end - x;
+            x = end;
+        }
+    }
+}
+
+void chunked_get_stats(const struct chunked_board_t* board, struct chunked_stats* stats) {
+    stats->live = board->live;
+    stats->pooled = board->pooled;
+    stats->bytes = board->slab_count * CHUNK_SLAB * sizeof(struct chunk_t)
+        + board->table_size * sizeof(struct chunk_entry)
+        + board->slab_capacity * sizeof(struct chunk_t*);
+}
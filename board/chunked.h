@@ -0,0 +1,155 @@
+#ifndef _CHUNKED_H_
+#define _CHUNKED_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sparse board of one byte per cell for worlds too large for a dense grid.
+ *
+ * The world is cut in chunks of CHUNK_SIDE x CHUNK_SIDE cells; a chunk only
+ * exists while one of its cells is not 0 (wall, food, snake...), and reading
+ * a cell of a missing chunk gives 0. Chunks are found through an open
+ * addressing hash table of their coordinates, and the last chunk found is
+ * kept as the hot chunk: a lookup hitting it costs a compare over the dense
+ * grid. A chunk whose last cell is set back to 0 returns to a pool and is
+ * reused by the next chunk created; the pool grows by slabs of CHUNK_SLAB
+ * chunks and is only freed with the board, so memory follows the largest
+ * occupied area, not the size of the world.
+ */
+#define CHUNK_BITS 6
+#define CHUNK_SIDE (1 << CHUNK_BITS)
+#define CHUNK_CELLS (CHUNK_SIDE * CHUNK_SIDE)   // 4 KiB, a page
+#define CHUNK_SLAB 64
+#define CHUNK_TABLE_INITIAL 256                  // hash table slots, a power of two
+
+struct chunk_t {
+    uint8_t cells[CHUNK_CELLS];   // row-major inside the chunk
+    uint64_t key;                 // chunk coordinates, see chunked_key
+    uint32_t occupied;            // cells not 0
+    struct chunk_t* next_free;    // pool
+} __attribute__((aligned(64)));  // cells start on a cache line in a slab
+
+struct chunk_entry {
+    uint64_t key;
+    struct chunk_t* chunk;        // NULL: free slot
+};
+
+struct chunked_board_t {
+    int width;
+    int height;
+    struct chunk_t* hot;          // last chunk found
+    struct chunk_entry* table;
+    size_t table_size;
+    size_t live;                  // chunks in the table
+    struct chunk_t* free_chunks;
+    size_t pooled;
+    struct chunk_t** slabs;
+    size_t slab_count;
+    size_t slab_capacity;
+};
+
+struct chunked_stats {
+    size_t live;                  // chunks holding cells
+    size_t pooled;                // empty chunks kept for reuse
+    size_t bytes;                 // chunks, table and slab list
+};
+
+/**
+ * Allocate an empty board.
+ *
+ * @param width Number of columns of the world.
+ * @param height Number of rows of the world.
+ * @return A pointer to the board, or NULL if allocation fails.
+ */
+struct chunked_board_t* chunked_create(int width, int height);
+
+/**
+ * Free a board and its pool.
+ *
+ * @param board A pointer to the pointer of the board to free.
+ */
+void chunked_destroy(struct chunked_board_t** board);
+
+/**
+ * Set every cell to 0: every chunk returns to the pool.
+ *
+ * @param board The board.
+ */
+void chunked_clear(struct chunked_board_t* board);
+
+/**
+ * Find the chunk of a key and make it the hot chunk.
+ *
+ * @param board The board.
+ * @param key The chunk coordinates.
+ * @return The chunk, or NULL if it does not exist.
+ */
+struct chunk_t* chunked_find(struct chunked_board_t* board, uint64_t key);
+
+/**
+ * Set a cell, creating or releasing its chunk when needed.
+ *
+ * @param board The board.
+ * @param x Column of the cell.
+ * @param y Row of the cell.
+ * @param value The new value.
+ * @return false if a chunk could not be allocated (the cell is unchanged).
+ */
+bool chunked_set_slow(struct chunked_board_t* board, int x, int y, uint8_t value);
+
+/**
+ * Copy a rectangle of cells in row-major order.
+ *
+ * @param board The board.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param out Receives width * height bytes.
+ */
+void chunked_copy_rows(const struct chunked_board_t* board, int x0, int y0, int width, int height, uint8_t* out);
+
+/**
+ * Read the chunk counts and the memory used.
+ *
+ * @param board The board.
+ * @param stats Receives the counters.
+ */
+void chunked_get_stats(const struct chunked_board_t* board, struct chunked_stats* stats);
+
+static inline uint64_t chunked_key(int x, int y) {
+    return ((uint64_t)(uint32_t)(y >> CHUNK_BITS) << 32) | (uint32_t)(x >> CHUNK_BITS);
+}
+
+static inline size_t chunked_offset(int x, int y) {
+    return ((size_t)(y & (CHUNK_SIDE - 1)) << CHUNK_BITS) | (size_t)(x & (CHUNK_SIDE - 1));
+}
+
+static inline uint8_t chunked_get(struct chunked_board_t* board, int x, int y) {
+    uint64_t key = chunked_key(x, y);
+    struct chunk_t* chunk = board->hot;
+    if (!chunk || chunk->key != key) {
+        chunk = chunked_find(board, key);
+        if (!chunk) {
+            return 0;
+        }
+    }
+    return chunk->cells[chunked_offset(x, y)];
+}
+
+static inline bool chunked_set(struct chunked_board_t* board, int x, int y, uint8_t value) {
+    struct chunk_t* chunk = board->hot;
+    if (chunk && chunk->key == chunked_key(x, y)) {
+        uint8_t* cell = &chunk->cells[chunked_offset(x, y)];
+        if ((*cell != 0) == (value != 0)) {
+            // The occupancy of the chunk does not change
+            *cell = value;
+            return true;
+        }
+    }
+    return chunked_set_slow(board, x, y, value);
+}
+
+#endif
@@ -0,0 +1,811 @@
+#include "bot.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../bitboard/bitboard.h"
+#include "../trace/trace.h"
+
+#define BOT_MAX_THREADS 64
+#define BOT_ARENA_CHUNK (1 << 20)
+#define BOT_DEQUE_CAPACITY 4096
+#define BOT_SPLIT_DEPTH 3          // subtrees at least this deep are offered to the pool
+#define BOT_MOVES 3                // a reverse turn is never considered
+
+// Leaf values: eating dominates, then avoiding traps, then space and distance to food
+#define BOT_DEAD -1.0e6            // plus 1000 per ply survived
+#define BOT_FOOD_REWARD 10.0       // discounted by 0.95 per ply
+#define BOT_TRAPPED 1.0e4          // region without the tail smaller than the snake
+#define BOT_SPACE_WEIGHT 0.01      // per reachable cell
+#define BOT_DISTANCE_WEIGHT 0.05   // per cell to the nearest reachable food
+
+enum bot_cell {
+    BOT_BLOCKED,
+    BOT_FREE,
+    BOT_FOOD
+};
+
+struct bot_delta {
+    int cell;
+    uint8_t value;   // enum bot_cell
+};
+
+/**
+ * Game state after a sequence of moves. The board is the one of the root
+ * plus the deltas, latest last; the body is the body of the root followed
+ * by the heads of every ply, minus tail_skip cells at the tail.
+ */
+struct bot_node {
+    int head;
+    int length;
+    int tail_skip;
+    int ply;
+    enum direction direction;
+    int food_count;
+    int ticks_since_food;
+    bool dead;
+    double reward;
+    int delta_count;
+    struct bot_delta* deltas;
+    int* heads;
+    double value;
+};
+
+struct bot_task {
+    struct bot_node* node;
+    int depth;
+    atomic_int* pending;   // decremented once the value is written
+};
+
+struct bot_deque {
+    pthread_mutex_t lock;
+    int top;               // oldest task, stolen first
+    int bottom;            // next free slot, the owner pushes and pops here
+    struct bot_task tasks[BOT_DEQUE_CAPACITY];
+};
+
+struct bot_chunk {
+    struct bot_chunk* next;
+    size_t used;
+    size_t size;
+    unsigned char data[];
+};
+
+struct bot_arena {
+    struct bot_chunk* first;
+    struct bot_chunk* current;
+    struct bot_chunk* last;
+};
+
+struct bot_worker {
+    struct bot_t* bot;
+    int index;
+    pthread_t thread;
+    struct bot_deque deque;
+    struct bot_arena arena;
+    struct bitboard_t* passable;
+    struct bitboard_t* food;
+    struct bitboard_t* region;
+    uint64_t nodes;
+    uint64_t steals;
+};
+
+struct bot_t {
+    int thread_count;
+    struct bot_worker* workers;   // workers[0] is the thread calling bot_decide
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_bool searching;
+    atomic_bool stopping;
+    atomic_bool aborted;
+    uint64_t deadline_ns;
+
+    // Root of the current decision, read-only while searching
+    int columns, rows;
+    int border;
+    int max_food;
+    int food_interval_ticks;
+    struct bitboard_t* passable;
+    struct bitboard_t* food;
+    int* body;                    // tail first
+    int body_length;
+    int body_capacity;
+    double discount[BOT_MAX_DEPTH + 2];
+
+    struct bot_stats stats;
+};
+
+static const int dx[] = { [left] = -1, [up] = 0, [down] = 0, [right] = 1 };
+static const int dy[] = { [left] = 0, [up] = -1, [down] = 1, [right] = 0 };
+
+static uint64_t bot_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * The three directions that are not a reverse turn, straight ahead first.
+ */
+static void bot_moves(enum direction direction, enum direction moves[BOT_MOVES]) {
+    int count = 0;
+    moves[count++] = direction;
+    for (int d = 0; d < 4; d++) {
+        if (d != (int)direction && d + direction != 3) {
+            moves[count++] = (enum direction)d;
+        }
+    }
+}
+
+static void* arena_alloc(struct bot_arena* arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    while (arena->current && arena->current->used + size > arena->current->size) {
+        arena->current = arena->current->next;
+        if (arena->current) {
+            arena->current->used = 0;
+        }
+    }
+    if (!arena->current) {
+        size_t chunk_size = (size > BOT_ARENA_CHUNK) ? size : BOT_ARENA_CHUNK;
+        struct bot_chunk* chunk = malloc(sizeof(struct bot_chunk) + chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = NULL;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        if (arena->last) {
+            arena->last->next = chunk;
+        } else {
+            arena->first = chunk;
+        }
+        arena->last = chunk;
+        arena->current = chunk;
+    }
+    void* memory = arena->current->data + arena->current->used;
+    arena->current->used += size;
+    return memory;
+}
+
+static void arena_reset(struct bot_arena* arena) {
+    arena->current = arena->first;
+    if (arena->current) {
+        arena->current->used = 0;
+    }
+}
+
+static void arena_free(struct bot_arena* arena) {
+    struct bot_chunk* chunk = arena->first;
+    while (chunk) {
+        struct bot_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first = arena->current = arena->last = NULL;
+}
+
+static bool deque_push(struct bot_deque* deque, const struct bot_task* task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == BOT_DEQUE_CAPACITY && deque->top > 0) {
+        memmove(deque->tasks, deque->tasks + deque->top, (size_t)(deque->bottom - deque->top) * sizeof(struct bot_task));
+        deque->bottom -= deque->top;
+        deque->top = 0;
+    }
+    bool pushed = deque->bottom < BOT_DEQUE_CAPACITY;
+    if (pushed) {
+        deque->tasks[deque->bottom++] = *task;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+static bool deque_take(struct bot_deque* deque, struct bot_task* task, bool oldest) {
+    pthread_mutex_lock(&deque->lock);
+    bool taken = deque->bottom > deque->top;
+    if (taken) {
+        *task = oldest ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+        if (deque->top == deque->bottom) {
+            deque->top = deque->bottom = 0;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * Take the newest own task, or steal the oldest task of another worker:
+ * old tasks are the largest subtrees.
+ */
+static bool next_task(struct bot_worker* worker, struct bot_task* task) {
+    if (deque_take(&worker->deque, task, false)) {
+        return true;
+    }
+    const int count = worker->bot->thread_count;
+    for (int i = 1; i < count; i++) {
+        struct bot_worker* victim = &worker->bot->workers[(worker->index + i) % count];
+        if (deque_take(&victim->deque, task, true)) {
+            worker->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool out_of_time(struct bot_t* bot) {
+    if (atomic_load_explicit(&bot->aborted, memory_order_relaxed)) {
+        return true;
+    }
+    if (bot_now_ns() < bot->deadline_ns) {
+        return false;
+    }
+    atomic_store(&bot->aborted, true);
+    return true;
+}
+
+static enum bot_cell node_cell(const struct bot_t* bot, const struct bot_node* node, int cell) {
+    for (int i = node->delta_count - 1; i >= 0; i--) {
+        if (node->deltas[i].cell == cell) {
+            return (enum bot_cell)node->deltas[i].value;
+        }
+    }
+    const int x = cell % bot->columns, y = cell / bot->columns;
+    if (bitboard_test(bot->food, x, y)) {
+        return BOT_FOOD;
+    }
+    return bitboard_test(bot->passable, x, y) ? BOT_FREE : BOT_BLOCKED;
+}
+
+static int body_at(const struct bot_t* bot, const struct bot_node* node, int index) {
+    return (index < bot->body_length) ? bot->body[index] : node->heads[index - bot->body_length];
+}
+
+static bool spawn_pending(const struct bot_t* bot, const struct bot_node* node) {
+    return node->food_count == 0
+        || (node->ticks_since_food + 1 >= bot->food_interval_ticks && node->food_count < bot->max_food);
+}
+
+/**
+ * Draw the position of a spawned food like the game does (uniform on the
+ * empty cells), from a seed fixed by the node so that every iteration of
+ * the deepening samples the same positions.
+ */
+static int sample_spawn(const struct bot_t* bot, const struct bot_node* node, int sample) {
+    const int x_range = bot->columns - 2 * bot->border;
+    const int y_range = bot->rows - 2 * bot->border;
+    if (x_range <= 0 || y_range <= 0) {
+        return -1;
+    }
+    unsigned int seed = (unsigned int)node->head * 2654435761u ^ (unsigned int)node->ply * 40503u ^ (unsigned int)sample * 97u;
+    for (int attempt = 0; attempt < 64; attempt++) {
+        int x = bot->border + rand_r(&seed) % x_range;
+        int y = bot->border + rand_r(&seed) % y_range;
+        int cell = y * bot->columns + x;
+        if (node_cell(bot, node, cell) == BOT_FREE) {
+            return cell;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Create the state after one tick: the optional food spawn, then the move.
+ * The deltas and heads of the parent are copied, never modified.
+ */
+static struct bot_node* node_child(struct bot_worker* worker, const struct bot_node* parent,
+    bool spawning, int spawn, enum direction direction) {
+    struct bot_t* bot = worker->bot;
+    struct bot_node* node = arena_alloc(&worker->arena, sizeof(struct bot_node));
+    struct bot_delta* deltas = arena_alloc(&worker->arena, (size_t)(parent->delta_count + 3) * sizeof(struct bot_delta));
+    int* heads = arena_alloc(&worker->arena, (size_t)(parent->ply + 1) * sizeof(int));
+    if (!node || !deltas || !heads) {
+        return NULL;
+    }
+    *node = *parent;
+    memcpy(deltas, parent->deltas, (size_t)parent->delta_count * sizeof(struct bot_delta));
+    memcpy(heads, parent->heads, (size_t)parent->ply * sizeof(int));
+    node->deltas = deltas;
+    node->heads = heads;
+    node->ply++;
+    node->direction = direction;
+
+    node->ticks_since_food++;
+    if (spawning) {
+        node->food_count++;
+        node->ticks_since_food = 0;
+        if (spawn >= 0) {
+            deltas[node->delta_count++] = (struct bot_delta){ spawn, BOT_FOOD };
+        }
+    }
+
+    const int x = parent->head % bot->columns + dx[direction];
+    const int y = parent->head / bot->columns + dy[direction];
+    if (x < 0 || y < 0 || x >= bot->columns || y >= bot->rows) {
+        node->dead = true;
+        return node;
+    }
+    const int head = y * bot->columns + x;
+    const enum bot_cell cell = node_cell(bot, node, head);
+    if (cell == BOT_BLOCKED) {
+        // Walls and the whole body, tail included: it leaves after the head entered
+        node->dead = true;
+        return node;
+    }
+    deltas[node->delta_count++] = (struct bot_delta){ head, BOT_BLOCKED };
+    heads[node->ply - 1] = head;
+    node->head = head;
+    if (cell == BOT_FOOD) {
+        node->length++;
+        node->food_count--;
+        node->reward += BOT_FOOD_REWARD * bot->discount[node->ply];
+    } else {
+        deltas[node->delta_count++] = (struct bot_delta){ body_at(bot, node, node->tail_skip), BOT_FREE };
+        node->tail_skip++;
+    }
+    return node;
+}
+
+/**
+ * Children of a node, sample major: BOT_MOVES moves for each sampled food
+ * position (one sample when no food spawns on this tick).
+ *
+ * @return The number of children, -1 if the arena is exhausted.
+ */
+static int expand(struct bot_worker* worker, const struct bot_node* node, struct bot_node** children, int* samples) {
+    const bool spawning = spawn_pending(worker->bot, node);
+    enum direction moves[BOT_MOVES];
+    bot_moves(node->direction, moves);
+    *samples = spawning ? BOT_SPAWN_SAMPLES : 1;
+    int count = 0;
+    for (int s = 0; s < *samples; s++) {
+        int spawn = spawning ? sample_spawn(worker->bot, node, s) : -1;
+        for (int m = 0; m < BOT_MOVES; m++) {
+            children[count] = node_child(worker, node, spawning, spawn, moves[m]);
+            if (!children[count]) {
+                return -1;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Expectimax: mean over the food samples of the best move.
+ */
+static double combine(struct bot_node* const* children, int samples) {
+    double total = 0.0;
+    for (int s = 0; s < samples; s++) {
+        double best = children[s * BOT_MOVES]->value;
+        for (int m = 1; m < BOT_MOVES; m++) {
+            if (children[s * BOT_MOVES + m]->value > best) {
+                best = children[s * BOT_MOVES + m]->value;
+            }
+        }
+        total += best;
+    }
+    return total / samples;
+}
+
+/**
+ * Static value of a state: food eaten on the way, then the region reachable
+ * from the head (a trap if it neither holds the tail nor the whole snake),
+ * then the distance to the nearest reachable food.
+ */
+static double evaluate_leaf(struct bot_worker* worker, const struct bot_node* node) {
+    const struct bot_t* bot = worker->bot;
+    bitboard_copy(worker->passable, bot->passable);
+    bitboard_copy(worker->food, bot->food);
+    for (int i = 0; i < node->delta_count; i++) {
+        const int x = node->deltas[i].cell % bot->columns, y = node->deltas[i].cell / bot->columns;
+        switch (node->deltas[i].value) {
+        case BOT_BLOCKED:
+            bitboard_reset(worker->passable, x, y);
+            bitboard_reset(worker->food, x, y);
+            break;
+        case BOT_FREE:
+            bitboard_set(worker->passable, x, y);
+            bitboard_reset(worker->food, x, y);
+            break;
+        default:
+            bitboard_set(worker->passable, x, y);
+            bitboard_set(worker->food, x, y);
+            break;
+        }
+    }
+
+    // The tail moves away on the next tick
+    const int head_x = node->head % bot->columns, head_y = node->head / bot->columns;
+    const int tail = body_at(bot, node, node->tail_skip);
+    const int tail_x = tail % bot->columns, tail_y = tail / bot->columns;
+    bitboard_set(worker->passable, tail_x, tail_y);
+    const int area = bitboard_flood_fill(worker->passable, head_x, head_y, worker->region);
+
+    double value = node->reward + area * BOT_SPACE_WEIGHT;
+    if (!bitboard_test(worker->region, tail_x, tail_y) && area < node->length) {
+        value -= BOT_TRAPPED * (1.0 + (double)(node->length - area) / node->length);
+    }
+
+    int nearest = INT_MAX;
+    for (int y = 0; y < bot->rows; y++) {
+        const uint64_t* food = bitboard_row(worker->food, y);
+        const uint64_t* region = bitboard_row(worker->region, y);
+        for (int w = 0; w < worker->food->words_per_row; w++) {
+            uint64_t bits = food[w] & region[w];
+            while (bits) {
+                int x = w * 64 + __builtin_ctzll(bits);
+                int distance = abs(x - head_x) + abs(y - head_y);
+                if (distance < nearest) {
+                    nearest = distance;
+                }
+                bits &= bits - 1;
+            }
+        }
+    }
+    if (nearest != INT_MAX) {
+        value -= nearest * BOT_DISTANCE_WEIGHT;
+    } else {
+        value -= (bot->columns + bot->rows) * BOT_DISTANCE_WEIGHT;
+    }
+    return value;
+}
+
+static double evaluate(struct bot_worker* worker, struct bot_node* node, int depth);
+
+static void run_task(struct bot_worker* worker, struct bot_task* task) {
+    task->node->value = evaluate(worker, task->node, task->depth);
+    atomic_fetch_sub_explicit(task->pending, 1, memory_order_release);
+}
+
+/**
+ * Evaluate children in parallel: all but the first are offered to the
+ * pool, the first is evaluated here, then this worker runs its own or
+ * stolen tasks until every child has a value.
+ */
+static void evaluate_children(struct bot_worker* worker, struct bot_node** children, int count, int depth) {
+    atomic_int pending;
+    atomic_init(&pending, count - 1);
+    for (int i = count - 1; i >= 1; i--) {
+        struct bot_task task = { children[i], depth, &pending };
+        if (!deque_push(&worker->deque, &task)) {
+            run_task(worker, &task);
+        }
+    }
+    children[0]->value = evaluate(worker, children[0], depth);
+
+    struct bot_task task;
+    while (atomic_load_explicit(&pending, memory_order_acquire) > 0) {
+        if (next_task(worker, &task)) {
+            run_task(worker, &task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static double evaluate(struct bot_worker* worker, struct bot_node* node, int depth) {
+    struct bot_t* bot = worker->bot;
+    worker->nodes++;
+    if (node->dead) {
+        return BOT_DEAD + node->ply * 1000.0;
+    }
+    if (depth == 0) {
+        return evaluate_leaf(worker, node);
+    }
+    if (out_of_time(bot)) {
+        return 0.0;
+    }
+
+    struct bot_node* children[BOT_SPAWN_SAMPLES * BOT_MOVES];
+    int samples;
+    int count = expand(worker, node, children, &samples);
+    if (count < 0) {
+        atomic_store(&bot->aborted, true);
+        return 0.0;
+    }
+    if (depth >= BOT_SPLIT_DEPTH && bot->thread_count > 1) {
+        evaluate_children(worker, children, count, depth - 1);
+    } else {
+        for (int i = 0; i < count; i++) {
+            children[i]->value = evaluate(worker, children[i], depth - 1);
+        }
+    }
+    return combine(children, samples);
+}
+
+static void* worker_main(void* arg) {
+    struct bot_worker* worker = arg;
+    struct bot_t* bot = worker->bot;
+    trace_thread_name("bot worker");
+    while (true) {
+        pthread_mutex_lock(&bot->lock);
+        while (!atomic_load(&bot->searching) && !atomic_load(&bot->stopping)) {
+            pthread_cond_wait(&bot->wake, &bot->lock);
+        }
+        pthread_mutex_unlock(&bot->lock);
+        if (atomic_load(&bot->stopping)) {
+            break;
+        }
+
+        struct bot_task task;
+        while (atomic_load(&bot->searching)) {
+            if (next_task(worker, &task)) {
+                run_task(worker, &task);
+            } else {
+                sched_yield();
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool worker_boards(struct bot_worker* worker, int columns, int rows) {
+    bitboard_destroy(&worker->passable);
+    bitboard_destroy(&worker->food);
+    bitboard_destroy(&worker->region);
+    worker->passable = bitboard_create(columns, rows);
+    worker->food = bitboard_create(columns, rows);
+    worker->region = bitboard_create(columns, rows);
+    return worker->passable && worker->food && worker->region;
+}
+
+struct bot_t* bot_create(int threads) {
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cores > 0) ? (int)cores : 1;
+    }
+    if (threads > BOT_MAX_THREADS) {
+        threads = BOT_MAX_THREADS;
+    }
+
+    struct bot_t* bot = calloc(1, sizeof(struct bot_t));
+    struct bot_worker* workers = calloc((size_t)threads, sizeof(struct bot_worker));
+    if (!bot || !workers) {
+        fprintf(stderr, "Failed to allocate memory for bot");
+        free(bot);
+        free(workers);
+        return NULL;
+    }
+    bot->workers = workers;
+    pthread_mutex_init(&bot->lock, NULL);
+    pthread_cond_init(&bot->wake, NULL);
+    atomic_init(&bot->searching, false);
+    atomic_init(&bot->stopping, false);
+    atomic_init(&bot->aborted, false);
+    bot->discount[0] = 1.0;
+    for (int i = 1; i < BOT_MAX_DEPTH + 2; i++) {
+        bot->discount[i] = bot->discount[i - 1] * 0.95;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].bot = bot;
+        workers[i].index = i;
+        pthread_mutex_init(&workers[i].deque.lock, NULL);
+    }
+    // Worker 0 is the calling thread
+    bot->thread_count = 1;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start bot worker %d\n", i);
+            break;
+        }
+        bot->thread_count++;
+    }
+    return bot;
+}
+
+void bot_destroy(struct bot_t** bot) {
+    if (!bot || !*bot) {
+        return;
+    }
+    struct bot_t* b = *bot;
+    pthread_mutex_lock(&b->lock);
+    atomic_store(&b->stopping, true);
+    pthread_cond_broadcast(&b->wake);
+    pthread_mutex_unlock(&b->lock);
+    for (int i = 1; i < b->thread_count; i++) {
+        pthread_join(b->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < b->thread_count; i++) {
+        struct bot_worker* worker = &b->workers[i];
+        arena_free(&worker->arena);
+        bitboard_destroy(&worker->passable);
+        bitboard_destroy(&worker->food);
+        bitboard_destroy(&worker->region);
+        pthread_mutex_destroy(&worker->deque.lock);
+    }
+    bitboard_destroy(&b->passable);
+    bitboard_destroy(&b->food);
+    free(b->body);
+    free(b->workers);
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->wake);
+    free(b);
+    *bot = NULL;
+}
+
+/**
+ * Load the root of a decision: passable and food cells, body.
+ * Portals are avoided: the search does not model them.
+ */
+static bool load_root(struct bot_t* bot, const struct bot_view* view) {
+    const struct gfx_context_t* ctxt = view->ctxt;
+    const int columns = (int)ctxt->width / view->zoom;
+    const int rows = (int)ctxt->height / view->zoom;
+    if (!bot->passable || bot->columns != columns || bot->rows != rows) {
+        bitboard_destroy(&bot->passable);
+        bitboard_destroy(&bot->food);
+        free(bot->body);
+        bot->passable = bitboard_create(columns, rows);
+        bot->food = bitboard_create(columns, rows);
+        bot->body_capacity = columns * rows;
+        bot->body = malloc((size_t)bot->body_capacity * sizeof(int));
+        bool ready = bot->passable && bot->food && bot->body;
+        for (int i = 0; i < bot->thread_count && ready; i++) {
+            ready = worker_boards(&bot->workers[i], columns, rows);
+        }
+        if (!ready) {
+            fprintf(stderr, "Failed to allocate memory for bot");
+            bitboard_destroy(&bot->passable);
+            return false;
+        }
+        bot->columns = columns;
+        bot->rows = rows;
+    }
+
+    bitboard_clear(bot->passable);
+    bitboard_clear(bot->food);
+    for (int y = 0; y < rows; y++) {
+        const uint32_t* row = ctxt->pixels + (size_t)y * view->zoom * ctxt->width;
+        for (int x = 0; x < columns; x++) {
+            switch (row[x * view->zoom]) {
+            case COLOR_RED:
+                bitboard_set(bot->food, x, y);
+                bitboard_set(bot->passable, x, y);
+                break;
+            case COLOR_BLACK:
+                bitboard_set(bot->passable, x, y);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    bot->body_length = 0;
+    for (const struct coord_t* node = view->queue->head; node && bot->body_length < bot->body_capacity; node = node->next) {
+        bot->body[bot->body_length++] = (node->y / view->zoom) * columns + node->x / view->zoom;
+    }
+    bot->border = view->border;
+    bot->max_food = view->max_food;
+    bot->food_interval_ticks = (view->food_interval_ticks > 0) ? view->food_interval_ticks : 1;
+    return bot->body_length > 0;
+}
+
+/**
+ * Search every move of the root to the given depth.
+ *
+ * @return false if the search ran out of time (or memory).
+ */
+static bool search_root(struct bot_t* bot, const struct bot_node* root, int depth, double values[BOT_MOVES]) {
+    struct bot_worker* worker = &bot->workers[0];
+    struct bot_node* children[BOT_SPAWN_SAMPLES * BOT_MOVES];
+    int samples;
+    int count = expand(worker, root, children, &samples);
+    if (count < 0) {
+        return false;
+    }
+    if (bot->thread_count > 1 && depth > 1) {
+        pthread_mutex_lock(&bot->lock);
+        atomic_store(&bot->searching, true);
+        pthread_cond_broadcast(&bot->wake);
+        pthread_mutex_unlock(&bot->lock);
+        evaluate_children(worker, children, count, depth - 1);
+        atomic_store(&bot->searching, false);
+    } else {
+        for (int i = 0; i < count; i++) {
+            children[i]->value = evaluate(worker, children[i], depth - 1);
+        }
+    }
+    if (atomic_load(&bot->aborted)) {
+        return false;
+    }
+    for (int m = 0; m < BOT_MOVES; m++) {
+        values[m] = 0.0;
+        for (int s = 0; s < samples; s++) {
+            values[m] += children[s * BOT_MOVES + m]->value;
+        }
+        values[m] /= samples;
+    }
+    return true;
+}
+
+enum direction bot_decide(struct bot_t* bot, const struct bot_view* view, double budget_ms) {
+    TRACE_SCOPE("bot_decide");
+    const uint64_t start_ns = bot_now_ns();
+    bot->deadline_ns = start_ns + (uint64_t)(budget_ms * 1.0e6);
+    if (!load_root(bot, view)) {
+        return view->direction;
+    }
+
+    enum direction moves[BOT_MOVES];
+    bot_moves(view->direction, moves);
+    enum direction best = view->direction;
+    int completed = 0;
+    atomic_store(&bot->aborted, false);
+    for (int depth = 1; depth <= BOT_MAX_DEPTH; depth++) {
+        const uint64_t iteration_ns = bot_now_ns();
+        for (int i = 0; i < bot->thread_count; i++) {
+            arena_reset(&bot->workers[i].arena);
+        }
+        struct bot_node root = {
+            .head = bot->body[bot->body_length - 1],
+            .length = bot->body_length,
+            .direction = view->direction,
+            .food_count = view->food_count,
+            .ticks_since_food = view->ticks_since_food,
+        };
+        double values[BOT_MOVES];
+        if (!search_root(bot, &root, depth, values)) {
+            break;
+        }
+        int best_move = 0;
+        for (int m = 1; m < BOT_MOVES; m++) {
+            if (values[m] > values[best_move]) {
+                best_move = m;
+            }
+        }
+        best = moves[best_move];
+        completed = depth;
+
+        // The next iteration costs a few times this one: do not start it in vain
+        const uint64_t now_ns = bot_now_ns();
+        if (now_ns + 3 * (now_ns - iteration_ns) > bot->deadline_ns) {
+            break;
+        }
+    }
+
+    bot->stats.decisions++;
+    bot->stats.depth_sum += completed;
+    if (completed > bot->stats.max_depth) {
+        bot->stats.max_depth = completed;
+    }
+    for (int i = 0; i < bot->thread_count; i++) {
+        bot->stats.nodes += bot->workers[i].nodes;
+        bot->stats.steals += bot->workers[i].steals;
+        bot->workers[i].nodes = 0;
+        bot->workers[i].steals = 0;
+    }
+    bot->stats.search_ms += (bot_now_ns() - start_ns) / 1.0e6;
+    return best;
+}
+
+int bot_threads(const struct bot_t* bot) {
+    return bot->thread_count;
+}
+
+void bot_get_stats(const struct bot_t* bot, struct bot_stats* stats) {
+    *stats = bot->stats;
+}
+
+void bot_report(const struct bot_t* bot, FILE* stream) {
+    const struct bot_stats* stats = &bot->stats;
+    if (stats->decisions == 0) {
+        return;
+    }
+    fprintf(stream, "Bot: %llu decisions, %d thread(s), depth mean %.1f max %d, %.2f ms per decision, %.0f nodes/s, %llu steals\n",
+        (unsigned long long)stats->decisions, bot->thread_count,
+        (double)stats->depth_sum / stats->decisions, stats->max_depth,
+        stats->search_ms / stats->decisions,
+        stats->search_ms > 0.0 ? stats->nodes * 1000.0 / stats->search_ms : 0.0,
+        (unsigned long long)stats->steals);
+}
+
+void bot_reset_stats(struct bot_t* bot) {
+    memset(&bot->stats, 0, sizeof(bot->stats));
+}
@@ -0,0 +1,110 @@
+#ifndef _BOT_H_
+#define _BOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../gfx/gfx.h"
+#include "../queue/queue.h"
+#include "../snake/snake.h"
+
+/*
+ * Lookahead bot: expectimax over the next moves of the snake, the food
+ * spawned at the start of a tick being a chance node (a few sampled empty
+ * cells). Leaves are scored by the food eaten on the way, the free space
+ * reachable from the head (bitboard flood fill) and the distance to food.
+ *
+ * The search is split across a work-stealing pool: every worker owns a
+ * deque of subtrees and an arena of nodes; idle workers steal the oldest
+ * subtree of another worker. A node shares the board of the root and only
+ * stores its changes (cells entered, left or eaten), copied from its
+ * parent when it is created. Iterative deepening keeps the best move of
+ * the deepest completed search within the time budget.
+ */
+#define BOT_MAX_DEPTH 24
+#define BOT_SPAWN_SAMPLES 3   // sampled food positions per chance node
+
+struct bot_t;
+
+/**
+ * What the bot knows of the game before a tick.
+ */
+struct bot_view {
+    const struct gfx_context_t* ctxt;   // board, zoom pixels per cell
+    int zoom;
+    const struct queue_t* queue;        // snake body, tail first
+    enum direction direction;           // direction of the last tick
+    int border;                         // food spawns in [border, size - border) cells
+    int food_count;
+    int max_food;
+    int ticks_since_food;
+    int food_interval_ticks;            // ticks between two spawns
+};
+
+struct bot_stats {
+    uint64_t decisions;
+    uint64_t nodes;
+    uint64_t depth_sum;       // completed depth of every decision
+    int max_depth;
+    double search_ms;         // time spent deciding
+    uint64_t steals;
+};
+
+/**
+ * Create a bot and its worker threads.
+ *
+ * @param threads Number of workers, the calling thread included (0: one per core).
+ * @return A pointer to the bot, or NULL if allocation fails.
+ */
+struct bot_t* bot_create(int threads);
+
+/**
+ * Stop the workers and free a bot.
+ *
+ * @param bot A pointer to the pointer of the bot to free.
+ */
+void bot_destroy(struct bot_t** bot);
+
+/**
+ * Choose the direction of the next tick.
+ *
+ * @param bot The bot.
+ * @param view The game state.
+ * @param budget_ms Time allowed for the decision.
+ * @return The direction to take (never a reverse turn).
+ */
+enum direction bot_decide(struct bot_t* bot, const struct bot_view* view, double budget_ms);
+
+/**
+ * Number of workers of a bot.
+ *
+ * @param bot The bot.
+ * @return The number of workers, the calling thread included.
+ */
+int bot_threads(const struct bot_t* bot);
+
+/**
+ * Read the statistics accumulated since the last reset.
+ *
+ * @param bot The bot.
+ * @param stats Receives the statistics.
+ */
+void bot_get_stats(const struct bot_t* bot, struct bot_stats* stats);
+
+/**
+ * Print the statistics (decisions, mean and max depth, nodes/s, steals).
+ *
+ * @param bot The bot.
+ * @param stream The output stream.
+ */
+void bot_report(const struct bot_t* bot, FILE* stream);
+
+/**
+ * Clear the statistics.
+ *
+ * @param bot The bot.
+ */
+void bot_reset_stats(struct bot_t* bot);
+
+#endif
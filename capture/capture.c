@@ -0,0 +1,449 @@
+#include "capture.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../pattern/pattern.h"
+#include "../trace/trace.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Ring capacity, a power of two larger than the pool so a ring never overflows
+#define RING_SIZE 16
+
+/**
+ * Single producer / single consumer ring of frame indices.
+ */
+struct frame_ring_t {
+    _Atomic uint32_t head;  // next slot to read (consumer)
+    _Atomic uint32_t tail;  // next slot to write (producer)
+    int slots[RING_SIZE];
+};
+
+struct capture_t {
+    enum capture_format format;
+    char* path;
+    FILE* stream;           // Y4M output, NULL for PPM sequences
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t* frames[CAPTURE_POOL_SIZE];
+    struct frame_ring_t free_frames;   // writer -> game
+    struct frame_ring_t ready_frames;  // game -> writer
+
+    uint8_t* planes;        // conversion buffer owned by the writer
+    uint32_t ppm_index;
+    int ppm_prefix;         // path bytes before the frame number conversion
+    int ppm_suffix;         // offset of the path after the conversion
+    int ppm_digits;         // field width of the frame number
+    bool ppm_zero;          // frame number padded with zeros
+
+    pthread_t writer;
+    sem_t pending;
+    atomic_bool stopping;
+
+    _Atomic uint64_t submitted;
+    _Atomic uint64_t written;
+    _Atomic uint64_t dropped;
+};
+
+static void ring_init(struct frame_ring_t* ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+static bool ring_push(struct frame_ring_t* ring, int index) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == RING_SIZE) {
+        return false;
+    }
+    ring->slots[tail % RING_SIZE] = index;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool ring_pop(struct frame_ring_t* ring, int* index) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *index = ring->slots[head % RING_SIZE];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+/*
+ * BT.601 limited range conversion, integer version:
+ *   Y = (( 66 R + 129 G +  25 B + 128) >> 8) +  16
+ *   U = ((-38 R -  74 G + 112 B + 128) >> 8) + 128
+ *   V = ((112 R -  94 G -  18 B + 128) >> 8) + 128
+ * Chroma is computed from the rounded average of each 2x2 block.
+ * The SIMD and scalar paths produce identical bytes.
+ */
+static inline uint8_t rgb_to_y(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t rgb_to_u(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t rgb_to_v(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+#define PIXEL_R(p) (((p) >> 16) & 0xff)
+#define PIXEL_G(p) (((p) >> 8) & 0xff)
+#define PIXEL_B(p) ((p) & 0xff)
+
+/**
+ * Scalar luma conversion of the pixels [from, to) of one row.
+ */
+static void luma_row_scalar(const uint32_t* src, uint8_t* dst, uint32_t from, uint32_t to) {
+    for (uint32_t x = from; x < to; x++) {
+        dst[x] = rgb_to_y(PIXEL_R(src[x]), PIXEL_G(src[x]), PIXEL_B(src[x]));
+    }
+}
+
+/**
+ * Scalar chroma conversion of the chroma samples [from, to) of one chroma row.
+ * Odd frame sizes are handled by clamping the 2x2 block to the frame.
+ */
+static void chroma_row_scalar(const uint32_t* row0, const uint32_t* row1, uint32_t width,
+    uint8_t* u, uint8_t* v, uint32_t from, uint32_t to) {
+    for (uint32_t cx = from; cx < to; cx++) {
+        uint32_t x0 = 2 * cx;
+        uint32_t x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+        uint32_t p[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+        int r = 2, g = 2, b = 2;
+        for (int i = 0; i < 4; i++) {
+            r += PIXEL_R(p[i]);
+            g += PIXEL_G(p[i]);
+            b += PIXEL_B(p[i]);
+        }
+        r >>= 2;
+        g >>= 2;
+        b >>= 2;
+        u[cx] = rgb_to_u(r, g, b);
+        v[cx] = rgb_to_v(r, g, b);
+    }
+}
+
+#ifdef __SSE2__
+/**
+ * Extract one 8-bit channel of 8 ARGB pixels into 8 signed 16-bit lanes.
+ */
+static inline __m128i channel_epi16(__m128i lo, __m128i hi, int shift) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    __m128i a = _mm_and_si128(_mm_srl_epi32(lo, count), mask);
+    __m128i b = _mm_and_si128(_mm_srl_epi32(hi, count), mask);
+    return _mm_packs_epi32(a, b);
+}
+
+/**
+ * Luma of one row, 16 pixels per iteration.
+ * @return The number of pixels converted; the caller finishes the tail.
+ */
+static uint32_t luma_row_simd(const uint32_t* src, uint8_t* dst, uint32_t width) {
+    const __m128i ky_r = _mm_set1_epi16(66);
+    const __m128i ky_g = _mm_set1_epi16(129);
+    const __m128i ky_b = _mm_set1_epi16(25);
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i offset = _mm_set1_epi16(16);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y16[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(src + x + 8 * half));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(src + x + 8 * half + 4));
+            __m128i r = channel_epi16(lo, hi, 16);
+            __m128i g = channel_epi16(lo, hi, 8);
+            __m128i b = channel_epi16(lo, hi, 0);
+            // The sum stays below 2^16, so a logical shift gives the unsigned result
+            __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, ky_r), _mm_mullo_epi16(g, ky_g));
+            sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, ky_b));
+            sum = _mm_add_epi16(sum, round);
+            y16[half] = _mm_add_epi16(_mm_srli_epi16(sum, 8), offset);
+        }
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(y16[0], y16[1]));
+    }
+    return x;
+}
+
+/**
+ * Average 8 horizontally adjacent pixels of two rows into 4 channel values.
+ */
+static inline __m128i block_average(__m128i c0, __m128i c1) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(c0, ones), _mm_madd_epi16(c1, ones));
+    sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(sum, sum);
+}
+
+/**
+ * Chroma of one chroma row, 4 samples (8 source pixels of two rows) per iteration.
+ * @return The number of chroma samples converted; the caller finishes the tail.
+ */
+static uint32_t chroma_row_simd(const uint32_t* row0, const uint32_t* row1, uint32_t width, uint8_t* u, uint8_t* v) {
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i bias = _mm_set1_epi16(128);
+
+    uint32_t cx = 0;
+    for (; 2 * cx + 8 <= width; cx += 4) {
+        uint32_t x = 2 * cx;
+        __m128i lo0 = _mm_loadu_si128((const __m128i*)(row0 + x));
+        __m128i hi0 = _mm_loadu_si128((const __m128i*)(row0 + x + 4));
+        __m128i lo1 = _mm_loadu_si128((const __m128i*)(row1 + x));
+        __m128i hi1 = _mm_loadu_si128((const __m128i*)(row1 + x + 4));
+
+        __m128i r = block_average(channel_epi16(lo0, hi0, 16), channel_epi16(lo1, hi1, 16));
+        __m128i g = block_average(channel_epi16(lo0, hi0, 8), channel_epi16(lo1, hi1, 8));
+        __m128i b = block_average(channel_epi16(lo0, hi0, 0), channel_epi16(lo1, hi1, 0));
+
+        // |sum| < 2^15, so signed 16-bit lanes and an arithmetic shift are exact
+        __m128i su = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(-38)), _mm_mullo_epi16(g, _mm_set1_epi16(-74)));
+        su = _mm_add_epi16(su, _mm_mullo_epi16(b, _mm_set1_epi16(112)));
+        su = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(su, round), 8), bias);
+
+        __m128i sv = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)), _mm_mullo_epi16(g, _mm_set1_epi16(-94)));
+        sv = _mm_add_epi16(sv, _mm_mullo_epi16(b, _mm_set1_epi16(-18)));
+        sv = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(sv, round), 8), bias);
+
+        uint32_t packed_u = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(su, su));
+        uint32_t packed_v = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sv, sv));
+        memcpy(u + cx, &packed_u, sizeof(packed_u));
+        memcpy(v + cx, &packed_v, sizeof(packed_v));
+    }
+    return cx;
+}
+#endif
+
+/**
+ * Convert an ARGB frame to planar YUV 4:2:0 (Y plane, then U, then V).
+ */
+static void argb_to_yuv420(const uint32_t* src, uint32_t width, uint32_t height, uint8_t* planes) {
+    const uint32_t chroma_width = (width + 1) / 2;
+    const uint32_t chroma_height = (height + 1) / 2;
+    uint8_t* y_plane = planes;
+    uint8_t* u_plane = y_plane + (size_t)width * height;
+    uint8_t* v_plane = u_plane + (size_t)chroma_width * chroma_height;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint32_t* row = src + (size_t)y * width;
+        uint8_t* dst = y_plane + (size_t)y * width;
+        uint32_t done = 0;
+#ifdef __SSE2__
+        done = luma_row_simd(row, dst, width);
+#endif
+        luma_row_scalar(row, dst, done, width);
+    }
+
+    for (uint32_t cy = 0; cy < chroma_height; cy++) {
+        const uint32_t* row0 = src + (size_t)(2 * cy) * width;
+        const uint32_t* row1 = (2 * cy + 1 < height) ? row0 + width : row0;
+        uint8_t* u = u_plane + (size_t)cy * chroma_width;
+        uint8_t* v = v_plane + (size_t)cy * chroma_width;
+        uint32_t done = 0;
+#ifdef __SSE2__
+        done = chroma_row_simd(row0, row1, width, u, v);
+#endif
+        chroma_row_scalar(row0, row1, width, u, v, done, chroma_width);
+    }
+}
+
+static size_t yuv420_size(uint32_t width, uint32_t height) {
+    return (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+}
+
+static bool write_y4m_frame(struct capture_t* capture, const uint32_t* pixels) {
+    argb_to_yuv420(pixels, capture->width, capture->height, capture->planes);
+    size_t size = yuv420_size(capture->width, capture->height);
+    return fputs("FRAME\n", capture->stream) >= 0
+        && fwrite(capture->planes, 1, size, capture->stream) == size;
+}
+
+static bool write_ppm_frame(struct capture_t* capture, const uint32_t* pixels) {
+    char name[4096];
+    snprintf(name, sizeof(name), capture->ppm_zero ? "%.*s%0*u%s" : "%.*s%*u%s",
+        capture->ppm_prefix, capture->path, capture->ppm_digits, capture->ppm_index++,
+        capture->path + capture->ppm_suffix);
+    FILE* file = fopen(name, "wb");
+    if (!file) {
+        return false;
+    }
+
+    size_t count = (size_t)capture->width * capture->height;
+    uint8_t* rgb = capture->planes;
+    for (size_t i = 0; i < count; i++) {
+        rgb[3 * i] = PIXEL_R(pixels[i]);
+        rgb[3 * i + 1] = PIXEL_G(pixels[i]);
+        rgb[3 * i + 2] = PIXEL_B(pixels[i]);
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", capture->width, capture->height);
+    bool ok = fwrite(rgb, 3, count, file) == count;
+    return (fclose(file) == 0) && ok;
+}
+
+/**
+ * Writer thread: converts and writes the ready frames, then gives them back to the pool.
+ */
+static void* capture_writer(void* arg) {
+    struct capture_t* capture = arg;
+    trace_thread_name("capture writer");
+    while (true) {
+        sem_wait(&capture->pending);
+
+        int index;
+        if (!ring_pop(&capture->ready_frames, &index)) {
+            if (atomic_load(&capture->stopping)) {
+                break;
+            }
+            continue;
+        }
+
+        TRACE_SCOPE("capture_write");
+        bool ok = (capture->format == CAPTURE_Y4M)
+            ? write_y4m_frame(capture, capture->frames[index])
+            : write_ppm_frame(capture, capture->frames[index]);
+        if (ok) {
+            atomic_fetch_add(&capture->written, 1);
+        } else {
+            atomic_fetch_add(&capture->dropped, 1);
+        }
+        ring_push(&capture->free_frames, index);
+    }
+    return NULL;
+}
+
+static bool has_suffix(const char* text, const char* suffix) {
+    size_t text_len = strlen(text);
+    size_t suffix_len = strlen(suffix);
+    return text_len >= suffix_len && strcmp(text + text_len - suffix_len, suffix) == 0;
+}
+
+/**
+ * Free everything owned by a session (the writer thread must not be running).
+ */
+static void capture_free(struct capture_t* capture) {
+    for (int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        free(capture->frames[i]);
+    }
+    if (capture->stream) {
+        fclose(capture->stream);
+    }
+    free(capture->planes);
+    free(capture->path);
+    free(capture);
+}
+
+struct capture_t* capture_open(const char* path, uint32_t width, uint32_t height, int fps) {
+    struct capture_t* capture = calloc(1, sizeof(struct capture_t));
+    if (!capture) {
+        fprintf(stderr, "Failed to allocate memory for capture");
+        return NULL;
+    }
+
+    capture->format = has_suffix(path, ".y4m") ? CAPTURE_Y4M : CAPTURE_PPM;
+    capture->width = width;
+    capture->height = height;
+    capture->path = strdup(path);
+    if (capture->format == CAPTURE_PPM && !parse_frame_pattern(path, &capture->ppm_zero,
+            &capture->ppm_digits, &capture->ppm_prefix, &capture->ppm_suffix)) {
+        fprintf(stderr, "Invalid capture pattern, expected one %%u or %%d: %s\n", path);
+        capture_free(capture);
+        return NULL;
+    }
+
+    size_t frame_size = (size_t)width * height * sizeof(uint32_t);
+    size_t planes_size = (capture->format == CAPTURE_Y4M) ? yuv420_size(width, height) : (size_t)width * height * 3;
+    capture->planes = malloc(planes_size);
+    bool ok = capture->path && capture->planes;
+
+    ring_init(&capture->free_frames);
+    ring_init(&capture->ready_frames);
+    for (int i = 0; i < CAPTURE_POOL_SIZE && ok; i++) {
+        capture->frames[i] = malloc(frame_size);
+        ok = capture->frames[i] && ring_push(&capture->free_frames, i);
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate memory for capture frames");
+        capture_free(capture);
+        return NULL;
+    }
+
+    if (capture->format == CAPTURE_Y4M) {
+        capture->stream = fopen(path, "wb");
+        if (!capture->stream) {
+            fprintf(stderr, "Failed to open capture file: %s\n", path);
+            capture_free(capture);
+            return NULL;
+        }
+        setvbuf(capture->stream, NULL, _IOFBF, 1 << 20);
+        fprintf(capture->stream, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    }
+
+    atomic_init(&capture->stopping, false);
+    atomic_init(&capture->submitted, 0);
+    atomic_init(&capture->written, 0);
+    atomic_init(&capture->dropped, 0);
+    sem_init(&capture->pending, 0, 0);
+    if (pthread_create(&capture->writer, NULL, capture_writer, capture) != 0) {
+        fprintf(stderr, "Failed to start capture writer thread\n");
+        sem_destroy(&capture->pending);
+        capture_free(capture);
+        return NULL;
+    }
+    return capture;
+}
+
+bool capture_frame(struct capture_t* capture, const uint32_t* pixels) {
+    atomic_fetch_add_explicit(&capture->submitted, 1, memory_order_relaxed);
+
+    int index;
+    if (!ring_pop(&capture->free_frames, &index)) {
+        atomic_fetch_add_explicit(&capture->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    memcpy(capture->frames[index], pixels, (size_t)capture->width * capture->height * sizeof(uint32_t));
+    ring_push(&capture->ready_frames, index);
+    sem_post(&capture->pending);
+    return true;
+}
+
+struct capture_stats capture_get_stats(struct capture_t* capture) {
+    struct capture_stats stats = {
+        .submitted = atomic_load(&capture->submitted),
+        .written = atomic_load(&capture->written),
+        .dropped = atomic_load(&capture->dropped),
+    };
+    return stats;
+}
+
+void capture_close(struct capture_t** capture, struct capture_stats* stats) {
+    if (!capture || !*capture) {
+        return;
+    }
+
+    atomic_store(&(*capture)->stopping, true);
+    sem_post(&(*capture)->pending);
+    pthread_join((*capture)->writer, NULL);
+    sem_destroy(&(*capture)->pending);
+
+    if (stats) {
+        *stats = capture_get_stats(*capture);
+    }
+    capture_free(*capture);
+    *capture = NULL;
+}
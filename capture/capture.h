@@ -0,0 +1,71 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Number of frames preallocated in the capture pool. When every frame is
+ * waiting for the writer, new frames are dropped instead of stalling the game.
+ */
+#define CAPTURE_POOL_SIZE 8
+
+enum capture_format {
+    CAPTURE_Y4M,   // single YUV4MPEG2 stream (4:2:0)
+    CAPTURE_PPM    // one binary PPM file per frame
+};
+
+struct capture_stats {
+    uint64_t submitted;
+    uint64_t written;
+    uint64_t dropped;
+};
+
+/**
+ * Opaque capture session (frame pool, rings and writer thread).
+ */
+struct capture_t;
+
+/**
+ * Open a capture session and start its writer thread.
+ *
+ * The format is chosen from the path: a path ending in ".y4m" produces a
+ * Y4M stream, anything else is a pattern for PPM files holding exactly one
+ * %u or %d conversion for the frame number, with an optional 0 flag and
+ * width (e.g. "frames/frame_%06u.ppm").
+ *
+ * @param path Output file or PPM file name pattern.
+ * @param width Width of the captured frames in pixels.
+ * @param height Height of the captured frames in pixels.
+ * @param fps Frame rate written in the Y4M header.
+ * @return A pointer to the capture session, or NULL on failure.
+ */
+struct capture_t* capture_open(const char* path, uint32_t width, uint32_t height, int fps);
+
+/**
+ * Copy a frame into the pool and hand it to the writer thread.
+ * Never blocks on disk I/O: if no pool frame is free, the frame is dropped.
+ *
+ * @param capture The capture session.
+ * @param pixels ARGB8888 pixels, width * height entries.
+ * @return true if the frame was queued, false if it was dropped.
+ */
+bool capture_frame(struct capture_t* capture, const uint32_t* pixels);
+
+/**
+ * Read the frame counters of a capture session.
+ *
+ * @param capture The capture session.
+ * @return The number of submitted, written and dropped frames.
+ */
+struct capture_stats capture_get_stats(struct capture_t* capture);
+
+/**
+ * Flush the pending frames, stop the writer thread and free the session.
+ *
+ * @param capture A pointer to the pointer of the session to close.
+ * @param stats If not NULL, receives the final frame counters.
+ */
+void capture_close(struct capture_t** capture, struct capture_stats* stats);
+
+#endif
@@ -1,20 +1,92 @@
 #include "coord.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+struct coord_chunk {
+    struct coord_chunk* next;
+    size_t count;
+    struct coord_t nodes[];
+};
+
+struct coord_pool {
+    struct coord_t* free;           // linked through next
+    size_t available;
+    struct coord_chunk* chunks;
+};
+
+static _Thread_local struct coord_pool pool = { NULL, 0, NULL };
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Thread exit: free the chunks of the exiting thread.
+ */
+static void pool_release(void* arg) {
+    struct coord_pool* exiting = arg;
+    struct coord_chunk* chunk = exiting->chunks;
+    while (chunk) {
+        struct coord_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    exiting->chunks = NULL;
+    exiting->free = NULL;
+    exiting->available = 0;
+}
+
+static void pool_key_create(void) {
+    pthread_key_create(&pool_key, pool_release);
+}
+
+static bool pool_grow(size_t count) {
+    struct coord_chunk* chunk = malloc(sizeof(struct coord_chunk) + count * sizeof(struct coord_t));
+    if (!chunk) {
+        return false;
+    }
+    if (!pool.chunks) {
+        pthread_once(&pool_key_once, pool_key_create);
+        pthread_setspecific(pool_key, &pool);
+    }
+    chunk->count = count;
+    chunk->next = pool.chunks;
+    pool.chunks = chunk;
+    for (size_t i = 0; i < count; i++) {
+        chunk->nodes[i].next = pool.free;
+        pool.free = &chunk->nodes[i];
+    }
+    pool.available += count;
+    return true;
+}
+
+bool coord_pool_reserve(size_t count) {
+    return pool.available >= count || pool_grow(count - pool.available);
+}
+
 struct coord_t* coord_init(int x, int y) {
-    struct coord_t* element = malloc(sizeof(struct coord_t));
-    if (!element) {
+    if (!pool.free && !pool_grow(COORD_CHUNK_NODES)) {
         fprintf(stderr, "Failed to allocate memory for element");
         return NULL;
     }
+    struct coord_t* element = pool.free;
+    pool.free = element->next;
+    pool.available--;
     element->x = x;
     element->y = y;
     element->next = NULL;
     return element;
 }
 
+void coord_free(struct coord_t* element) {
+    if (!element) {
+        return;
+    }
+    element->next = pool.free;
+    pool.free = element;
+    pool.available++;
+}
+
 bool coord_list_destroy(struct coord_t** head) {
     if (!head || !*head) {
         return false;
@@ -23,10 +95,10 @@ bool coord_list_destroy(struct coord_t** head) {
     struct coord_t* current = *head;
     while (current) {
         struct coord_t* next = current->next;
-        free(current);
+        coord_free(current);
         current = next;
     }
 
     *head = NULL;
     return true;
-}
\ No newline at end of file
+}
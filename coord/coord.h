@@ -3,6 +3,15 @@
 #define _COORD_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Nodes come from a per-thread pool: freed nodes are kept on a free list
+ * and reused, so a moving snake does not allocate. The pool grows by
+ * chunks and is released when its thread exits. A node must be freed
+ * (coord_free) by the thread that allocated it.
+ */
+#define COORD_CHUNK_NODES 256   // nodes allocated at once when the pool is empty
 
 /**
  * Coordinates x, y, with linked list
@@ -20,6 +29,22 @@ struct coord_t {
  */
 struct coord_t* coord_init(int x, int y);
 
+/**
+ * Return a node to the pool of the calling thread.
+ *
+ * @param element The node, may be NULL.
+ */
+void coord_free(struct coord_t* element);
+
+/**
+ * Make sure the pool of the calling thread holds at least count free nodes,
+ * e.g. the largest snake of a game, so that the game never allocates nodes.
+ *
+ * @param count The number of nodes.
+ * @return true on success, false if allocation fails.
+ */
+bool coord_pool_reserve(size_t count);
+
 /**
  * Frees an entire singly linked list of coord_t elements.
  *
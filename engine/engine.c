@@ -0,0 +1,389 @@
+#include "engine.h"
+#include "../board/board.h"
+#include "../board/chunked.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct engine_ops* engines[] = {
+    &engine_reference, &engine_grid, &engine_grid_tiled, &engine_grid_morton, &engine_grid_chunked
+};
+
+#define ENGINE_COUNT (sizeof(engines) / sizeof(engines[0]))
+
+const struct engine_ops* engine_find(const char* name) {
+    for (size_t i = 0; i < ENGINE_COUNT; i++) {
+        if (strcmp(engines[i]->name, name) == 0) {
+            return engines[i];
+        }
+    }
+    return NULL;
+}
+
+void engine_list(FILE* stream) {
+    for (size_t i = 0; i < ENGINE_COUNT; i++) {
+        fprintf(stream, "%s%s", i ? " " : "", engines[i]->name);
+    }
+}
+
+void engine_config_layout(struct engine_config* config) {
+    // Same arithmetic as main.c with CELL = 1
+    const int x_min = config->border;
+    const int y_min = config->border;
+    const int x_max = config->columns - config->border - 1;
+    const int y_max = config->rows - config->border - 1;
+    config->head_x = x_max / 2;
+    config->head_y = y_max / 2;
+    config->max_length = (x_max - x_min) * (y_max - y_min) - config->obstacle_count;
+}
+
+struct engine_state* engine_state_create(const struct engine_config* config) {
+    const size_t cells = (size_t)config->columns * config->rows;
+    struct engine_state* state = calloc(1, sizeof(struct engine_state));
+    if (!state) {
+        fprintf(stderr, "Failed to allocate memory for engine state");
+        return NULL;
+    }
+    state->cells = malloc(cells);
+    state->body = malloc(cells * sizeof(struct engine_point));
+    if (!state->cells || !state->body) {
+        fprintf(stderr, "Failed to allocate memory for engine state");
+        engine_state_destroy(&state);
+        return NULL;
+    }
+    state->columns = config->columns;
+    state->rows = config->rows;
+    return state;
+}
+
+void engine_state_destroy(struct engine_state** state) {
+    if (!state || !*state) {
+        return;
+    }
+    free((*state)->cells);
+    free((*state)->body);
+    free(*state);
+    *state = NULL;
+}
+
+bool engine_state_equal(const struct engine_state* a, const struct engine_state* b, char* diff, size_t size) {
+    char scratch[1];
+    if (!diff) {
+        diff = scratch;
+        size = sizeof(scratch);
+    }
+    if (a->status != b->status) {
+        snprintf(diff, size, "status %d != %d", a->status, b->status);
+        return false;
+    }
+    if (a->score != b->score) {
+        snprintf(diff, size, "score %d != %d", a->score, b->score);
+        return false;
+    }
+    if (a->food_count != b->food_count) {
+        snprintf(diff, size, "food count %d != %d", a->food_count, b->food_count);
+        return false;
+    }
+    if (a->seed != b->seed) {
+        snprintf(diff, size, "food seed %u != %u", a->seed, b->seed);
+        return false;
+    }
+    if (a->length != b->length) {
+        snprintf(diff, size, "length %d != %d", a->length, b->length);
+        return false;
+    }
+    for (int i = 0; i < a->length; i++) {
+        if (a->body[i].x != b->body[i].x || a->body[i].y != b->body[i].y) {
+            snprintf(diff, size, "body[%d] (%d, %d) != (%d, %d)",
+                i, a->body[i].x, a->body[i].y, b->body[i].x, b->body[i].y);
+            return false;
+        }
+    }
+    const int cells = a->columns * a->rows;
+    if (memcmp(a->cells, b->cells, (size_t)cells) != 0) {
+        for (int i = 0; i < cells; i++) {
+            if (a->cells[i] != b->cells[i]) {
+                snprintf(diff, size, "cell (%d, %d) %d != %d",
+                    i % a->columns, i / a->columns, a->cells[i], b->cells[i]);
+                break;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+#define GRID_BODY_INITIAL 1024   // ring capacity of the chunked grid, doubled when full
+
+/**
+ * Grid engine: one byte per cell (board_t, in any of its layouts, or a
+ * sparse chunked board) and the body in a ring buffer of cells, every tick
+ * is O(1) (the food draws aside).
+ */
+struct grid_engine {
+    struct engine_config config;
+    struct board_t* cells;
+    struct chunked_board_t* sparse;   // instead of cells
+    struct engine_point* body;   // ring of cells, tail at body[tail]
+    int capacity;
+    int tail;
+    int length;
+    enum direction last_direction;
+    enum engine_status status;
+    int score;
+    int food_count;
+    int ticks_since_food;
+    unsigned int seed;
+};
+
+static inline uint8_t grid_get(struct grid_engine* grid, int x, int y) {
+    return grid->sparse ? chunked_get(grid->sparse, x, y) : board_get(grid->cells, x, y);
+}
+
+/**
+ * Set a cell.
+ *
+ * @return false if the chunk of a sparse board could not be allocated (the cell is unchanged).
+ */
+static inline bool grid_set(struct grid_engine* grid, int x, int y, uint8_t value) {
+    if (grid->sparse) {
+        return chunked_set(grid->sparse, x, y, value);
+    }
+    board_set(grid->cells, x, y, value);
+    return true;
+}
+
+/**
+ * Double the body ring, unwrapping it to start at index 0.
+ */
+static bool grid_grow_body(struct grid_engine* grid) {
+    if (grid->capacity > INT_MAX / 2) {
+        return false;
+    }
+    int capacity = grid->capacity * 2;
+    struct engine_point* body = malloc((size_t)capacity * sizeof(struct engine_point));
+    if (!body) {
+        fprintf(stderr, "Failed to allocate memory for grid engine");
+        return false;
+    }
+    for (int i = 0; i < grid->length; i++) {
+        body[i] = grid->body[(grid->tail + i) % grid->capacity];
+    }
+    free(grid->body);
+    grid->body = body;
+    grid->capacity = capacity;
+    grid->tail = 0;
+    return true;
+}
+
+static bool grid_spawn_food(struct grid_engine* grid) {
+    const int border = grid->config.border;
+    const int x_range = grid->config.columns - 2 * border;
+    const int y_range = grid->config.rows - 2 * border;
+    int x, y;
+    do {
+        x = rand_r(&grid->seed) % x_range + border;
+        y = rand_r(&grid->seed) % y_range + border;
+    } while (grid_get(grid, x, y) != ENGINE_CELL_EMPTY);
+    return grid_set(grid, x, y, ENGINE_CELL_FOOD);
+}
+
+static void grid_destroy(void* engine) {
+    struct grid_engine* grid = engine;
+    if (!grid) {
+        return;
+    }
+    board_destroy(&grid->cells);
+    chunked_destroy(&grid->sparse);
+    free(grid->body);
+    free(grid);
+}
+
+/**
+ * Create a grid engine on a board of the given layout, or on a chunked
+ * board if sparse is set.
+ */
+static void* grid_create_board(const struct engine_config* config, enum board_layout layout, bool sparse) {
+    struct grid_engine* grid = calloc(1, sizeof(struct grid_engine));
+    if (!grid) {
+        fprintf(stderr, "Failed to allocate memory for grid engine");
+        return NULL;
+    }
+    const int columns = config->columns;
+    const int64_t cell_count = (int64_t)columns * config->rows;
+    grid->config = *config;
+    if (sparse) {
+        grid->sparse = chunked_create(columns, config->rows);
+        // The body grows with the snake instead of covering the world
+        grid->capacity = (int)((cell_count < GRID_BODY_INITIAL) ? cell_count : GRID_BODY_INITIAL);
+    } else if (cell_count <= INT_MAX) {
+        grid->cells = board_create(columns, config->rows, layout);
+        grid->capacity = (int)cell_count;
+    }
+    grid->body = grid->capacity ? malloc((size_t)grid->capacity * sizeof(struct engine_point)) : NULL;
+    if ((!grid->cells && !grid->sparse) || !grid->body) {
+        fprintf(stderr, "Failed to allocate memory for grid engine");
+        grid_destroy(grid);
+        return NULL;
+    }
+
+    // Border ring as drawn by draw_border in main.c
+    const int x0 = config->border - 1, x1 = columns - config->border;
+    const int y0 = config->border - 1, y1 = config->rows - config->border;
+    bool ok = true;
+    for (int x = x0; x <= x1; x++) {
+        ok &= grid_set(grid, x, y0, ENGINE_CELL_WALL);
+        ok &= grid_set(grid, x, y1, ENGINE_CELL_WALL);
+    }
+    for (int y = y0; y <= y1; y++) {
+        ok &= grid_set(grid, x0, y, ENGINE_CELL_WALL);
+        ok &= grid_set(grid, x1, y, ENGINE_CELL_WALL);
+    }
+    for (int i = 0; i < config->obstacle_count; i++) {
+        ok &= grid_set(grid, config->obstacles[i].x, config->obstacles[i].y, ENGINE_CELL_WALL);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        grid->body[i] = (struct engine_point){ config->head_x, config->head_y - 2 + i };
+        ok &= grid_set(grid, config->head_x, config->head_y - 2 + i, ENGINE_CELL_SNAKE);
+    }
+    grid->length = 3;
+    grid->last_direction = right;
+    grid->status = ENGINE_RUNNING;
+    grid->seed = config->seed;
+    grid->food_count = 1;
+    if (!ok || !grid_spawn_food(grid)) {
+        fprintf(stderr, "Failed to allocate memory for grid engine");
+        grid_destroy(grid);
+        return NULL;
+    }
+    return grid;
+}
+
+static void* grid_create(const struct engine_config* config) {
+    return grid_create_board(config, BOARD_ROW_MAJOR, false);
+}
+
+static void* grid_create_tiled(const struct engine_config* config) {
+    return grid_create_board(config, BOARD_TILED, false);
+}
+
+static void* grid_create_morton(const struct engine_config* config) {
+    return grid_create_board(config, BOARD_MORTON, false);
+}
+
+static void* grid_create_chunked(const struct engine_config* config) {
+    return grid_create_board(config, BOARD_ROW_MAJOR, true);
+}
+
+static enum engine_status grid_tick(void* engine, enum direction dir) {
+    struct grid_engine* grid = engine;
+    if (grid->status != ENGINE_RUNNING) {
+        return grid->status;
+    }
+    if (grid->length >= grid->config.max_length) {
+        return grid->status = ENGINE_WON;
+    }
+
+    grid->ticks_since_food++;
+    if ((grid->ticks_since_food >= grid->config.food_interval && grid->food_count < grid->config.max_food)
+        || grid->food_count == 0) {
+        if (!grid_spawn_food(grid)) {
+            return grid->status = ENGINE_HIT_SELF;   // out of memory ends the game
+        }
+        grid->food_count++;
+        grid->ticks_since_food = 0;
+    }
+
+    static const int dx[] = { [left] = -1, [up] = 0, [down] = 0, [right] = 1 };
+    static const int dy[] = { [left] = 0, [up] = -1, [down] = 1, [right] = 0 };
+    const bool is_reverse_turn = (grid->last_direction + dir == 3);
+    grid->last_direction = dir;
+
+    struct engine_point head = grid->body[(grid->tail + grid->length - 1) % grid->capacity];
+    head.x += dx[dir];
+    head.y += dy[dir];
+    switch (grid_get(grid, head.x, head.y)) {
+    case ENGINE_CELL_WALL:
+        return grid->status = ENGINE_HIT_WALL;
+    case ENGINE_CELL_SNAKE:
+        // The tail only leaves after the head entered, biting it is fatal
+        return grid->status = is_reverse_turn ? ENGINE_HIT_WALL : ENGINE_HIT_SELF;
+    case ENGINE_CELL_FOOD:
+        if (is_reverse_turn) {
+            return grid->status = ENGINE_HIT_WALL;
+        }
+        // Keep a free slot in the ring: a move writes the head before it frees the tail
+        if (grid->length + 1 == grid->capacity && !grid_grow_body(grid)) {
+            return grid->status = ENGINE_HIT_SELF;   // out of memory ends the game
+        }
+        if (!grid_set(grid, head.x, head.y, ENGINE_CELL_SNAKE)) {
+            return grid->status = ENGINE_HIT_SELF;
+        }
+        grid->score += 10;
+        grid->food_count--;
+        grid->body[(grid->tail + grid->length++) % grid->capacity] = head;
+        return ENGINE_RUNNING;
+    default:
+        if (is_reverse_turn) {
+            return grid->status = ENGINE_HIT_WALL;
+        }
+        if (!grid_set(grid, head.x, head.y, ENGINE_CELL_SNAKE)) {
+            return grid->status = ENGINE_HIT_SELF;   // out of memory ends the game
+        }
+        grid->body[(grid->tail + grid->length) % grid->capacity] = head;
+        grid_set(grid, grid->body[grid->tail].x, grid->body[grid->tail].y, ENGINE_CELL_EMPTY);
+        grid->tail = (grid->tail + 1) % grid->capacity;
+        return ENGINE_RUNNING;
+    }
+}
+
+static void grid_snapshot(const void* engine, struct engine_state* state) {
+    const struct grid_engine* grid = engine;
+    state->status = grid->status;
+    state->score = grid->score;
+    state->food_count = grid->food_count;
+    state->seed = grid->seed;
+    state->length = grid->length;
+    if (grid->sparse) {
+        chunked_copy_rows(grid->sparse, 0, 0, grid->config.columns, grid->config.rows, state->cells);
+    } else {
+        board_copy_rows(grid->cells, state->cells);
+    }
+    for (int i = 0; i < grid->length; i++) {
+        state->body[i] = grid->body[(grid->tail + i) % grid->capacity];
+    }
+}
+
+const struct engine_ops engine_grid = {
+    .name = "grid",
+    .create = grid_create,
+    .destroy = grid_destroy,
+    .tick = grid_tick,
+    .snapshot = grid_snapshot,
+};
+
+const struct engine_ops engine_grid_tiled = {
+    .name = "grid-tiled",
+    .create = grid_create_tiled,
+    .destroy = grid_destroy,
+    .tick = grid_tick,
+    .snapshot = grid_snapshot,
+};
+
+const struct engine_ops engine_grid_morton = {
+    .name = "grid-morton",
+    .create = grid_create_morton,
+    .destroy = grid_destroy,
+    .tick = grid_tick,
+    .snapshot = grid_snapshot,
+};
+
+const struct engine_ops engine_grid_chunked = {
+    .name = "grid-chunked",
+    .create = grid_create_chunked,
+    .destroy = grid_destroy,
+    .tick = grid_tick,
+    .snapshot = grid_snapshot,
+};
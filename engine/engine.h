@@ -0,0 +1,141 @@
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../snake/snake.h"
+
+/**
+ * Headless game engines, stepped one snake move (tick) at a time.
+ *
+ * Every engine implements the rules of the game loop of main.c:
+ *  - the board is bordered by a ring of walls drawn like main.c does, the
+ *    playable cells being [border, columns - border) x [border, rows - border);
+ *  - the snake starts with its head at (head_x, head_y), body upwards, going right;
+ *  - on each tick: the game is won once the snake reaches max_length; then a
+ *    food is spawned if none is left, or every food_interval ticks while fewer
+ *    than max_food are on the board (rand_r on seed: column then row, drawn
+ *    again until the cell is empty); then the snake moves;
+ *  - a move into a wall, or opposite to the previous tick's direction, ends
+ *    the game (WALL); a move into the body, tail included, ends it (SELF);
+ *    eating a food grows the snake and scores 10.
+ *
+ * The reference engine runs the game code itself (pixel buffer, pixel based
+ * get_collision_type, linked list queue); other engines must produce the
+ * same states tick after tick (see tools/diffcheck.c).
+ */
+
+#define ENGINE_MAX_OBSTACLES 64
+
+enum engine_cell {
+    ENGINE_CELL_EMPTY,
+    ENGINE_CELL_WALL,
+    ENGINE_CELL_SNAKE,
+    ENGINE_CELL_FOOD,
+    ENGINE_CELL_INVALID   // not a game color (reference engine only)
+};
+
+enum engine_status {
+    ENGINE_RUNNING,
+    ENGINE_HIT_WALL, // wall or reverse turn, reported together by the game
+    ENGINE_HIT_SELF,
+    ENGINE_WON
+};
+
+struct engine_point {
+    int x, y;
+};
+
+struct engine_config {
+    int columns, rows;       // board size in cells, walls included
+    int border;              // cells between the board edge and the playable area
+    int head_x, head_y;      // start of the head, the body extends upwards
+    unsigned int seed;       // rand_r state of the food placement
+    int food_interval;       // ticks between two food spawns
+    int max_food;            // must be less than the number of free playable cells
+    int max_length;          // length winning the game
+    int obstacle_count;
+    struct engine_point obstacles[ENGINE_MAX_OBSTACLES];   // extra walls, off the snake
+};
+
+/**
+ * Comparable state of an engine after a tick.
+ */
+struct engine_state {
+    int columns, rows;
+    enum engine_status status;
+    int score;
+    int food_count;
+    unsigned int seed;            // rand_r state, catches diverging draws early
+    int length;
+    uint8_t* cells;               // columns * rows enum engine_cell
+    struct engine_point* body;    // length points, tail first
+};
+
+struct engine_ops {
+    const char* name;
+    void* (*create)(const struct engine_config* config);
+    void (*destroy)(void* engine);
+    enum engine_status (*tick)(void* engine, enum direction dir);
+    void (*snapshot)(const void* engine, struct engine_state* state);
+};
+
+extern const struct engine_ops engine_reference;
+extern const struct engine_ops engine_grid;
+extern const struct engine_ops engine_grid_tiled;   // grid engine on a tiled board
+extern const struct engine_ops engine_grid_morton;  // grid engine on a Z-ordered board
+extern const struct engine_ops engine_grid_chunked; // grid engine on a sparse chunked board
+
+/**
+ * Find an engine by name.
+ *
+ * @param name The engine name ("reference", "grid", "grid-tiled", "grid-morton", "grid-chunked").
+ * @return The engine, or NULL if unknown.
+ */
+const struct engine_ops* engine_find(const char* name);
+
+/**
+ * Print the names of the engines, separated by spaces.
+ *
+ * @param stream The output stream.
+ */
+void engine_list(FILE* stream);
+
+/**
+ * Fill the geometry of a config the way main.c sets up a game on a board of
+ * the given size: spawn point, winning length (obstacles must be set first).
+ *
+ * @param config The config, columns, rows, border and obstacles set.
+ */
+void engine_config_layout(struct engine_config* config);
+
+/**
+ * Allocate a state able to hold any state of the given config.
+ *
+ * @param config The config of the engines.
+ * @return A pointer to the state, or NULL if allocation fails.
+ */
+struct engine_state* engine_state_create(const struct engine_config* config);
+
+/**
+ * Free a state.
+ *
+ * @param state A pointer to the pointer of the state to free.
+ */
+void engine_state_destroy(struct engine_state** state);
+
+/**
+ * Compare two states and describe the first difference.
+ *
+ * @param a The first state.
+ * @param b The second state.
+ * @param diff Receives a description of the first difference, may be NULL.
+ * @param size Size of diff.
+ * @return true if the states are identical.
+ */
+bool engine_state_equal(const struct engine_state* a, const struct engine_state* b, char* diff, size_t size);
+
+#endif
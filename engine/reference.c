@@ -0,0 +1,174 @@
+#include "engine.h"
+
+#include <stdlib.h>
+
+#include "../food/food.h"
+#include "../gfx/gfx.h"
+#include "../queue/queue.h"
+
+/**
+ * Reference engine: the game loop of main.c on an offscreen pixel buffer at
+ * one pixel per cell, with the functions the game uses.
+ */
+struct reference_engine {
+    struct engine_config config;
+    struct gfx_context_t* ctxt;
+    struct queue_t* queue;
+    enum direction last_direction;
+    enum engine_status status;
+    int score;
+    int food_counter;
+    int ticks_since_food;
+    unsigned int seed;
+};
+
+// CELL of main.c
+#define REFERENCE_CELL 1
+
+static void reference_destroy(void* engine) {
+    struct reference_engine* reference = engine;
+    if (!reference) {
+        return;
+    }
+    queue_destroy(&reference->queue);
+    if (reference->ctxt) {
+        gfx_destroy(reference->ctxt);
+    }
+    free(reference);
+}
+
+static void* reference_create(const struct engine_config* config) {
+    struct reference_engine* reference = calloc(1, sizeof(struct reference_engine));
+    if (!reference) {
+        fprintf(stderr, "Failed to allocate memory for reference engine");
+        return NULL;
+    }
+    reference->config = *config;
+    reference->ctxt = gfx_create_backend("reference", config->columns, config->rows, GFX_BACKEND_OFFSCREEN);
+    if (!reference->ctxt) {
+        reference_destroy(reference);
+        return NULL;
+    }
+    struct gfx_context_t* ctxt = reference->ctxt;
+
+    const int x_min = config->border;
+    const int y_min = config->border;
+    const int x_max = config->columns - config->border - REFERENCE_CELL;
+    const int y_max = config->rows - config->border - REFERENCE_CELL;
+    draw_border(ctxt, x_min - 1, x_max + REFERENCE_CELL + 1, y_min - 1, y_max + REFERENCE_CELL + 1, COLOR_BLUE);
+    for (int i = 0; i < config->obstacle_count; i++) {
+        draw_pixel(ctxt, config->obstacles[i].x, config->obstacles[i].y, REFERENCE_CELL, COLOR_BLUE);
+    }
+
+    reference->queue = init_snake_at(config->head_x, config->head_y, REFERENCE_CELL);
+    if (!reference->queue) {
+        reference_destroy(reference);
+        return NULL;
+    }
+    draw_snake_initial(ctxt, reference->queue, REFERENCE_CELL, COLOR_WHITE);
+
+    reference->seed = config->seed;
+    reference->food_counter = 1;
+    spawn_food_seeded(ctxt, config->border, REFERENCE_CELL, COLOR_BLACK, COLOR_RED, &reference->seed);
+    reference->last_direction = right;
+    reference->status = ENGINE_RUNNING;
+    return reference;
+}
+
+static enum engine_status reference_tick(void* engine, enum direction direction) {
+    struct reference_engine* reference = engine;
+    struct gfx_context_t* ctxt = reference->ctxt;
+    struct queue_t* queue = reference->queue;
+    if (reference->status != ENGINE_RUNNING) {
+        return reference->status;
+    }
+
+    if (queue->size >= reference->config.max_length) {
+        return reference->status = ENGINE_WON;
+    }
+
+    reference->ticks_since_food++;
+    bool should_spawn_food = (
+        (reference->ticks_since_food >= reference->config.food_interval && reference->food_counter < reference->config.max_food)
+        || reference->food_counter == 0
+        );
+    if (should_spawn_food) {
+        reference->food_counter++;
+        spawn_food_seeded(ctxt, reference->config.border, REFERENCE_CELL, COLOR_BLACK, COLOR_RED, &reference->seed);
+        reference->ticks_since_food = 0;
+    }
+
+    const enum direction last_direction = reference->last_direction;
+    reference->last_direction = direction;
+    struct coord_t* new_head = new_position(direction, queue->tail, REFERENCE_CELL);
+    bool is_reverse_turn = (last_direction + direction == 3);
+    enum collision_type collision = get_collision_type(ctxt, new_head, REFERENCE_CELL);
+
+    // No level: a portal cannot be reached
+    bool hit_wall_or_reverse = (collision == WALL_COLLISION || collision == PORTAL_COLLISION || is_reverse_turn);
+    bool hit_self = (collision == SNAKE_COLLISION);
+    bool ate_food = (collision == FOOD_COLLISION);
+    if (hit_wall_or_reverse) {
+        coord_free(new_head);
+        return reference->status = ENGINE_HIT_WALL;
+    }
+    if (hit_self) {
+        coord_free(new_head);
+        return reference->status = ENGINE_HIT_SELF;
+    }
+
+    if (ate_food) {
+        reference->score += 10;
+        draw_pixel(ctxt, new_head->x, new_head->y, REFERENCE_CELL, COLOR_BLACK);
+        draw_pixel(ctxt, new_head->x, new_head->y, REFERENCE_CELL, COLOR_WHITE);
+        queue_enqueue(queue, new_head);
+        reference->food_counter--;
+    } else {
+        move_snake(ctxt, queue, new_head, REFERENCE_CELL, COLOR_WHITE, COLOR_BLACK);
+    }
+    return ENGINE_RUNNING;
+}
+
+static void reference_snapshot(const void* engine, struct engine_state* state) {
+    const struct reference_engine* reference = engine;
+    const struct gfx_context_t* ctxt = reference->ctxt;
+    state->status = reference->status;
+    state->score = reference->score;
+    state->food_count = reference->food_counter;
+    state->seed = reference->seed;
+    state->length = reference->queue->size;
+
+    const int cells = reference->config.columns * reference->config.rows;
+    for (int i = 0; i < cells; i++) {
+        switch (ctxt->pixels[i]) {
+        case COLOR_BLACK:
+            state->cells[i] = ENGINE_CELL_EMPTY;
+            break;
+        case COLOR_BLUE:
+            state->cells[i] = ENGINE_CELL_WALL;
+            break;
+        case COLOR_WHITE:
+            state->cells[i] = ENGINE_CELL_SNAKE;
+            break;
+        case COLOR_RED:
+            state->cells[i] = ENGINE_CELL_FOOD;
+            break;
+        default:
+            state->cells[i] = ENGINE_CELL_INVALID;
+            break;
+        }
+    }
+
+    int i = 0;
+    for (const struct coord_t* node = reference->queue->head; node; node = node->next) {
+        state->body[i++] = (struct engine_point){ node->x / REFERENCE_CELL, node->y / REFERENCE_CELL };
+    }
+}
+
+const struct engine_ops engine_reference = {
+    .name = "reference",
+    .create = reference_create,
+    .destroy = reference_destroy,
+    .tick = reference_tick,
+    .snapshot = reference_snapshot,
+};
@@ -0,0 +1,405 @@
+#include "export.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RECOVERY_BATCH 4096   // values read per pread while looking for orphan ticks
+
+static const char* table_names[EXPORT_TABLES] = { "games", "ticks" };
+
+static const struct export_column_def game_columns[EXPORT_GAME_COLUMNS] = {
+    [EXPORT_GAME_ID] = { "id", EXPORT_U32 },
+    [EXPORT_GAME_SEED] = { "seed", EXPORT_U64 },
+    [EXPORT_GAME_DIFFICULTY] = { "difficulty", EXPORT_U8 },
+    [EXPORT_GAME_OUTCOME] = { "outcome", EXPORT_U8 },
+    [EXPORT_GAME_TICKS] = { "ticks", EXPORT_U32 },
+    [EXPORT_GAME_SCORE] = { "score", EXPORT_U32 },
+    [EXPORT_GAME_LENGTH] = { "length", EXPORT_U32 },
+    [EXPORT_GAME_DURATION_MS] = { "duration_ms", EXPORT_U32 },
+    [EXPORT_GAME_FIRST_TICK] = { "first_tick", EXPORT_U64 },
+};
+
+static const struct export_column_def tick_columns[EXPORT_TICK_COLUMNS] = {
+    [EXPORT_TICK_GAME] = { "game", EXPORT_U32 },
+    [EXPORT_TICK_TICK] = { "tick", EXPORT_U32 },
+    [EXPORT_TICK_HEAD_X] = { "head_x", EXPORT_U16 },
+    [EXPORT_TICK_HEAD_Y] = { "head_y", EXPORT_U16 },
+    [EXPORT_TICK_LENGTH] = { "length", EXPORT_U32 },
+    [EXPORT_TICK_SCORE] = { "score", EXPORT_U32 },
+    [EXPORT_TICK_FOOD] = { "food", EXPORT_U16 },
+    [EXPORT_TICK_DECISION_US] = { "decision_us", EXPORT_U32 },
+};
+
+static size_t type_width(enum export_type type) {
+    static const size_t widths[] = { [EXPORT_U8] = 1, [EXPORT_U16] = 2, [EXPORT_U32] = 4, [EXPORT_U64] = 8 };
+    return widths[type];
+}
+
+const struct export_column_def* export_columns(enum export_table_id table, int* count) {
+    if (table == EXPORT_GAMES) {
+        *count = EXPORT_GAME_COLUMNS;
+        return game_columns;
+    }
+    *count = EXPORT_TICK_COLUMNS;
+    return tick_columns;
+}
+
+static char* column_path(const char* dir, enum export_table_id table, const char* column) {
+    size_t size = strlen(dir) + strlen(table_names[table]) + strlen(column) + 8;
+    char* path = malloc(size);
+    if (path) {
+        snprintf(path, size, "%s/%s.%s.col", dir, table_names[table], column);
+    }
+    return path;
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * Open a column for appending, writing its header if it is new.
+ *
+ * @return The number of complete values in the file, -1 on failure.
+ */
+static int64_t open_column(struct export_column* column, const char* dir, enum export_table_id table,
+    const struct export_column_def* def) {
+    char* path = column_path(dir, table, def->name);
+    if (!path) {
+        return -1;
+    }
+    column->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (column->fd < 0) {
+        fprintf(stderr, "Failed to open export column: %s\n", path);
+        free(path);
+        return -1;
+    }
+    column->type = def->type;
+    column->width = type_width(def->type);
+    column->pending = 0;
+    column->block = malloc(EXPORT_BLOCK_ROWS * column->width);
+
+    struct stat st;
+    int64_t rows = -1;
+    if (!column->block || fstat(column->fd, &st) != 0) {
+        fprintf(stderr, "Failed to open export column: %s\n", path);
+    } else if (st.st_size < EXPORT_HEADER_SIZE) {
+        // New (or torn before the first value): start over with a header
+        struct export_header header = { EXPORT_MAGIC, EXPORT_VERSION, def->type, (uint32_t)column->width, "", "" };
+        snprintf(header.table, sizeof(header.table), "%s", table_names[table]);
+        snprintf(header.column, sizeof(header.column), "%s", def->name);
+        if (ftruncate(column->fd, 0) == 0 && write_all(column->fd, &header, sizeof(header))) {
+            rows = 0;
+        }
+    } else {
+        struct export_header header;
+        bool valid = pread(column->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+            && header.magic == EXPORT_MAGIC && header.version == EXPORT_VERSION
+            && header.type == (uint32_t)def->type && header.width == column->width;
+        if (valid) {
+            rows = (st.st_size - EXPORT_HEADER_SIZE) / (int64_t)column->width;
+        } else {
+            fprintf(stderr, "Invalid export column: %s\n", path);
+        }
+    }
+    free(path);
+    return rows;
+}
+
+static bool truncate_table(struct export_t* export, enum export_table_id table, uint64_t rows) {
+    int count;
+    export_columns(table, &count);
+    for (int c = 0; c < count; c++) {
+        const struct export_column* column = &export->columns[table][c];
+        if (ftruncate(column->fd, EXPORT_HEADER_SIZE + (off_t)(rows * column->width)) != 0) {
+            return false;
+        }
+    }
+    export->rows[table] = rows;
+    return true;
+}
+
+/**
+ * Ticks are flushed before games: after an interrupted flush, the ticks of
+ * games that were not written are cut off.
+ */
+static bool drop_orphan_ticks(struct export_t* export) {
+    const struct export_column* game = &export->columns[EXPORT_TICKS][EXPORT_TICK_GAME];
+    const uint32_t games = (uint32_t)export->rows[EXPORT_GAMES];
+    uint64_t rows = export->rows[EXPORT_TICKS];
+    uint32_t ids[RECOVERY_BATCH];
+    while (rows > 0) {
+        uint64_t count = (rows < RECOVERY_BATCH) ? rows : RECOVERY_BATCH;
+        off_t offset = EXPORT_HEADER_SIZE + (off_t)((rows - count) * sizeof(uint32_t));
+        if (pread(game->fd, ids, count * sizeof(uint32_t), offset) != (ssize_t)(count * sizeof(uint32_t))) {
+            return false;
+        }
+        uint64_t kept = count;
+        while (kept > 0 && ids[kept - 1] >= games) {
+            kept--;
+        }
+        rows -= count - kept;
+        if (kept > 0) {
+            break;
+        }
+    }
+    return rows == export->rows[EXPORT_TICKS] || truncate_table(export, EXPORT_TICKS, rows);
+}
+
+static bool flush_table(struct export_t* export, enum export_table_id table) {
+    int count;
+    export_columns(table, &count);
+    bool ok = true;
+    for (int c = 0; c < count; c++) {
+        struct export_column* column = &export->columns[table][c];
+        if (column->pending > 0) {
+            ok &= write_all(column->fd, column->block, column->pending * column->width);
+            column->pending = 0;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Write the buffered rows. After a failure the row counts no longer match
+ * the files, so the export stops there: the columns are cut back to the
+ * complete rows on the next open.
+ */
+static bool flush_all(struct export_t* export) {
+    if (export->failed) {
+        return false;
+    }
+    export->failed = !flush_table(export, EXPORT_TICKS) || !flush_table(export, EXPORT_GAMES);
+    if (export->failed) {
+        fprintf(stderr, "Failed to write the export, no more rows are added\n");
+    }
+    return !export->failed;
+}
+
+static void close_columns(struct export_t* export) {
+    for (int t = 0; t < EXPORT_TABLES; t++) {
+        for (int c = 0; c < EXPORT_MAX_COLUMNS; c++) {
+            struct export_column* column = &export->columns[t][c];
+            if (column->fd >= 0) {
+                close(column->fd);
+            }
+            free(column->block);
+        }
+    }
+}
+
+struct export_t* export_open(const char* dir, bool ticks) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create export directory: %s\n", dir);
+        return NULL;
+    }
+    struct export_t* export = calloc(1, sizeof(struct export_t));
+    if (!export) {
+        fprintf(stderr, "Failed to allocate memory for export");
+        return NULL;
+    }
+    for (int t = 0; t < EXPORT_TABLES; t++) {
+        for (int c = 0; c < EXPORT_MAX_COLUMNS; c++) {
+            export->columns[t][c].fd = -1;
+        }
+    }
+    pthread_mutex_init(&export->lock, NULL);
+    export->ticks = ticks;
+
+    // The ticks table is always opened, to keep it consistent with the games
+    bool ok = true;
+    for (int t = 0; t < EXPORT_TABLES && ok; t++) {
+        int count;
+        const struct export_column_def* defs = export_columns((enum export_table_id)t, &count);
+        int64_t rows = INT64_MAX;
+        bool torn = false;
+        for (int c = 0; c < count && ok; c++) {
+            int64_t column_rows = open_column(&export->columns[t][c], dir, (enum export_table_id)t, &defs[c]);
+            ok = column_rows >= 0;
+            torn |= (c > 0 && column_rows != rows);
+            if (column_rows < rows) {
+                rows = column_rows;
+            }
+        }
+        if (ok) {
+            export->rows[t] = (uint64_t)rows;
+            ok = !torn || truncate_table(export, (enum export_table_id)t, (uint64_t)rows);
+        }
+    }
+    ok = ok && drop_orphan_ticks(export);
+    if (!ok) {
+        close_columns(export);
+        pthread_mutex_destroy(&export->lock);
+        free(export);
+        return NULL;
+    }
+    return export;
+}
+
+static inline void put_value(struct export_column* column, uint64_t value) {
+    unsigned char* slot = column->block + column->pending * column->width;
+    switch (column->type) {
+    case EXPORT_U8:
+        *slot = (uint8_t)value;
+        break;
+    case EXPORT_U16: {
+        uint16_t v = (uint16_t)value;
+        memcpy(slot, &v, sizeof(v));
+        break;
+    }
+    case EXPORT_U32: {
+        uint32_t v = (uint32_t)value;
+        memcpy(slot, &v, sizeof(v));
+        break;
+    }
+    case EXPORT_U64:
+        memcpy(slot, &value, sizeof(value));
+        break;
+    }
+    column->pending++;
+}
+
+/**
+ * Append ticks of the next game, export->lock held.
+ */
+static bool append_ticks(struct export_t* export, const struct export_tick* ticks, uint32_t tick_count) {
+    const uint32_t id = (uint32_t)export->rows[EXPORT_GAMES];
+    struct export_column* columns = export->columns[EXPORT_TICKS];
+    for (uint32_t i = 0; export->ticks && i < tick_count; i++) {
+        if (columns[0].pending == EXPORT_BLOCK_ROWS && !flush_all(export)) {
+            return false;
+        }
+        put_value(&columns[EXPORT_TICK_GAME], id);
+        put_value(&columns[EXPORT_TICK_TICK], export->game_ticks + i);
+        put_value(&columns[EXPORT_TICK_HEAD_X], ticks[i].head_x);
+        put_value(&columns[EXPORT_TICK_HEAD_Y], ticks[i].head_y);
+        put_value(&columns[EXPORT_TICK_LENGTH], ticks[i].length);
+        put_value(&columns[EXPORT_TICK_SCORE], ticks[i].score);
+        put_value(&columns[EXPORT_TICK_FOOD], ticks[i].food);
+        put_value(&columns[EXPORT_TICK_DECISION_US], ticks[i].decision_us);
+        export->rows[EXPORT_TICKS]++;
+    }
+    export->game_ticks += tick_count;
+    return true;
+}
+
+bool export_add_ticks(struct export_t* export, const struct export_tick* ticks, uint32_t tick_count) {
+    pthread_mutex_lock(&export->lock);
+    bool ok = !export->failed && append_ticks(export, ticks, tick_count);
+    pthread_mutex_unlock(&export->lock);
+    return ok;
+}
+
+bool export_add_game(struct export_t* export, const struct export_game* game, const struct export_tick* ticks, uint32_t tick_count) {
+    pthread_mutex_lock(&export->lock);
+    const uint32_t id = (uint32_t)export->rows[EXPORT_GAMES];
+    bool ok = !export->failed && append_ticks(export, ticks, tick_count);
+    const uint64_t game_ticks = export->game_ticks;
+    const uint64_t first_tick = export->rows[EXPORT_TICKS] - (export->ticks ? game_ticks : 0);
+    export->game_ticks = 0;
+
+    struct export_column* columns = export->columns[EXPORT_GAMES];
+    if (ok && columns[0].pending == EXPORT_BLOCK_ROWS) {
+        ok = flush_all(export);
+    }
+    if (ok) {
+        put_value(&columns[EXPORT_GAME_ID], id);
+        put_value(&columns[EXPORT_GAME_SEED], game->seed);
+        put_value(&columns[EXPORT_GAME_DIFFICULTY], game->difficulty);
+        put_value(&columns[EXPORT_GAME_OUTCOME], game->outcome);
+        put_value(&columns[EXPORT_GAME_TICKS], game_ticks);
+        put_value(&columns[EXPORT_GAME_SCORE], game->score);
+        put_value(&columns[EXPORT_GAME_LENGTH], game->length);
+        put_value(&columns[EXPORT_GAME_DURATION_MS], game->duration_ms);
+        put_value(&columns[EXPORT_GAME_FIRST_TICK], first_tick);
+        export->rows[EXPORT_GAMES]++;
+    }
+    pthread_mutex_unlock(&export->lock);
+    return ok;
+}
+
+bool export_close(struct export_t** export) {
+    if (!export || !*export) {
+        return false;
+    }
+    bool ok = flush_all(*export);
+    close_columns(*export);
+    pthread_mutex_destroy(&(*export)->lock);
+    free(*export);
+    *export = NULL;
+    return ok;
+}
+
+bool export_table_open(const char* dir, enum export_table_id table, struct export_table* out) {
+    memset(out, 0, sizeof(*out));
+    out->defs = export_columns(table, &out->column_count);
+    out->rows = UINT64_MAX;
+    for (int c = 0; c < out->column_count; c++) {
+        char* path = column_path(dir, table, out->defs[c].name);
+        int fd = path ? open(path, O_RDONLY) : -1;
+        struct stat st;
+        bool ok = fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= EXPORT_HEADER_SIZE;
+        if (ok) {
+            out->map_sizes[c] = (size_t)st.st_size;
+            out->maps[c] = mmap(NULL, out->map_sizes[c], PROT_READ, MAP_SHARED, fd, 0);
+            ok = out->maps[c] != MAP_FAILED;
+            if (!ok) {
+                out->maps[c] = NULL;
+            }
+        }
+        if (ok) {
+            const struct export_header* header = out->maps[c];
+            const size_t width = type_width(out->defs[c].type);
+            ok = header->magic == EXPORT_MAGIC && header->version == EXPORT_VERSION
+                && header->type == (uint32_t)out->defs[c].type && header->width == width;
+            if (ok) {
+                madvise(out->maps[c], out->map_sizes[c], MADV_SEQUENTIAL);
+                out->columns[c] = (const unsigned char*)out->maps[c] + EXPORT_HEADER_SIZE;
+                uint64_t rows = (out->map_sizes[c] - EXPORT_HEADER_SIZE) / width;
+                if (rows < out->rows) {
+                    out->rows = rows;
+                }
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (!ok) {
+            fprintf(stderr, "Failed to map export column: %s\n", path ? path : dir);
+            free(path);
+            export_table_close(out);
+            return false;
+        }
+        free(path);
+    }
+    return true;
+}
+
+void export_table_close(struct export_table* table) {
+    for (int c = 0; c < EXPORT_MAX_COLUMNS; c++) {
+        if (table->maps[c]) {
+            munmap(table->maps[c], table->map_sizes[c]);
+        }
+        table->maps[c] = NULL;
+        table->columns[c] = NULL;
+    }
+    table->rows = 0;
+}
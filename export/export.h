@@ -0,0 +1,203 @@
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Columnar export of game results, in a directory with one file per column:
+ *
+ *   <dir>/games.<column>.col   one row per game
+ *   <dir>/ticks.<column>.col   one row per move (optional)
+ *
+ * A column file is a 64-byte header followed by the values, little-endian
+ * and packed: once mapped, a column is a plain C array. Rows are buffered
+ * per column and appended in blocks of EXPORT_BLOCK_ROWS. A game and its
+ * ticks are appended together; columns left with different lengths by an
+ * interrupted write are cut back to the shortest one on the next open.
+ */
+#define EXPORT_MAGIC 0x4c4f434eu      // "NCOL"
+#define EXPORT_VERSION 1
+#define EXPORT_HEADER_SIZE 64
+#define EXPORT_BLOCK_ROWS 65536
+#define EXPORT_MAX_COLUMNS 16
+#define EXPORT_SIMULATED 0xFF         // difficulty of games played by tools
+
+enum export_type {
+    EXPORT_U8,
+    EXPORT_U16,
+    EXPORT_U32,
+    EXPORT_U64
+};
+
+enum export_table_id {
+    EXPORT_GAMES,
+    EXPORT_TICKS,
+    EXPORT_TABLES
+};
+
+enum export_game_column {
+    EXPORT_GAME_ID,
+    EXPORT_GAME_SEED,
+    EXPORT_GAME_DIFFICULTY,
+    EXPORT_GAME_OUTCOME,
+    EXPORT_GAME_TICKS,
+    EXPORT_GAME_SCORE,
+    EXPORT_GAME_LENGTH,
+    EXPORT_GAME_DURATION_MS,
+    EXPORT_GAME_FIRST_TICK,       // row of its first tick in the ticks table
+    EXPORT_GAME_COLUMNS
+};
+
+enum export_tick_column {
+    EXPORT_TICK_GAME,
+    EXPORT_TICK_TICK,
+    EXPORT_TICK_HEAD_X,
+    EXPORT_TICK_HEAD_Y,
+    EXPORT_TICK_LENGTH,
+    EXPORT_TICK_SCORE,
+    EXPORT_TICK_FOOD,
+    EXPORT_TICK_DECISION_US,      // time spent choosing the direction (bot), 0 otherwise
+    EXPORT_TICK_COLUMNS
+};
+
+enum export_outcome {
+    EXPORT_OUTCOME_WON,
+    EXPORT_OUTCOME_WALL,          // wall or reverse turn
+    EXPORT_OUTCOME_SELF,
+    EXPORT_OUTCOME_QUIT,          // window closed or tick limit reached
+    EXPORT_OUTCOMES
+};
+
+struct export_column_def {
+    const char* name;
+    enum export_type type;
+};
+
+/**
+ * Column header (64 bytes), the values follow.
+ */
+struct export_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;            // enum export_type
+    uint32_t width;           // bytes per value
+    char table[16];
+    char column[32];
+};
+
+struct export_game {
+    uint64_t seed;
+    uint8_t difficulty;       // enum difficulty_level, EXPORT_SIMULATED for tools
+    uint8_t outcome;          // enum export_outcome
+    uint32_t score;
+    uint32_t length;
+    uint32_t duration_ms;
+};
+
+struct export_tick {
+    uint16_t head_x, head_y;  // in cells
+    uint32_t length;
+    uint32_t score;
+    uint16_t food;
+    uint32_t decision_us;
+};
+
+struct export_column {
+    int fd;
+    enum export_type type;
+    size_t width;
+    unsigned char* block;     // EXPORT_BLOCK_ROWS values
+    size_t pending;           // values in block
+};
+
+struct export_t {
+    pthread_mutex_t lock;     // export_add_game may be called from several threads
+    bool ticks;               // per-tick records enabled
+    bool failed;              // a block could not be written: no row is added any more
+    uint32_t game_ticks;      // ticks of the next game already added by export_add_ticks
+    uint64_t rows[EXPORT_TABLES];
+    struct export_column columns[EXPORT_TABLES][EXPORT_MAX_COLUMNS];
+};
+
+/**
+ * Mapped table, read-only.
+ */
+struct export_table {
+    uint64_t rows;            // complete rows (shortest column)
+    int column_count;
+    const struct export_column_def* defs;
+    const void* columns[EXPORT_MAX_COLUMNS];
+    void* maps[EXPORT_MAX_COLUMNS];
+    size_t map_sizes[EXPORT_MAX_COLUMNS];
+};
+
+/**
+ * Column definitions of a table.
+ *
+ * @param table The table.
+ * @param count Receives the number of columns.
+ * @return The definitions, in enum order.
+ */
+const struct export_column_def* export_columns(enum export_table_id table, int* count);
+
+/**
+ * Open (or create) an export directory for appending.
+ *
+ * @param dir The directory, created if needed.
+ * @param ticks true to also write the per-tick table.
+ * @return A pointer to the export, or NULL on failure.
+ */
+struct export_t* export_open(const char* dir, bool ticks);
+
+/**
+ * Append the first ticks of the game being played, so that a long game does
+ * not have to keep all of them: the game itself and its last ticks are added
+ * by export_add_game. Only one game at a time may use it.
+ *
+ * @param export The export.
+ * @param ticks The state after each move, ignored if ticks are disabled.
+ * @param tick_count The number of ticks.
+ * @return true on success.
+ */
+bool export_add_ticks(struct export_t* export, const struct export_tick* ticks, uint32_t tick_count);
+
+/**
+ * Append a finished game and its (last) ticks. Thread-safe.
+ *
+ * @param export The export.
+ * @param game The game result.
+ * @param ticks The state after each move, ignored if ticks are disabled.
+ * @param tick_count The number of ticks, the game counting them after those of export_add_ticks.
+ * @return true on success, false once a block could not be written.
+ */
+bool export_add_game(struct export_t* export, const struct export_game* game, const struct export_tick* ticks, uint32_t tick_count);
+
+/**
+ * Flush the buffered rows and close an export.
+ *
+ * @param export A pointer to the pointer of the export to close.
+ * @return true if every block was written.
+ */
+bool export_close(struct export_t** export);
+
+/**
+ * Map every column of a table.
+ *
+ * @param dir The export directory.
+ * @param table The table to map.
+ * @param out Receives the mapped table.
+ * @return true on success.
+ */
+bool export_table_open(const char* dir, enum export_table_id table, struct export_table* out);
+
+/**
+ * Unmap a table.
+ *
+ * @param table The mapped table.
+ */
+void export_table_close(struct export_table* table);
+
+#endif
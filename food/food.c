@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "../trace/trace.h"
+
 /**
  * Generate a coordinate for placing a new food item in the game grid.
  *
@@ -13,9 +15,10 @@
  * @param border_offset Margin in pixels around the playable area
  * @param zoom Grid size to align the food position
  * @param empty_color Color representing an empty space (required for validation)
+ * @param seed State of rand_r, or NULL to use rand()
  * @return Pointer to a newly allocated coord_t with food position, or NULL on failure
  */
-static struct coord_t* generate_food(struct gfx_context_t* context, const int border_offset, const int zoom, const uint32_t empty_color) {
+static struct coord_t* generate_food(struct gfx_context_t* context, const int border_offset, const int zoom, const uint32_t empty_color, unsigned int* seed) {
     const int x_min = ((border_offset + zoom - 1) / zoom) * zoom;
     const int y_min = ((border_offset + zoom - 1) / zoom) * zoom;
     const int x_max = context->width - border_offset;
@@ -35,17 +38,22 @@ static struct coord_t* generate_food(struct gfx_context_t* context, const int bo
     }
 
     do {
-        food->x = (rand() % x_range) * zoom + x_min;
-        food->y = (rand() % y_range) * zoom + y_min;
+        food->x = ((seed ? rand_r(seed) : rand()) % x_range) * zoom + x_min;
+        food->y = ((seed ? rand_r(seed) : rand()) % y_range) * zoom + y_min;
     } while (gfx_getpixel(context, food->x, food->y) != empty_color);
 
     return food;
 }
 
 void spawn_food(struct gfx_context_t* ctxt, const int border_offset, const int zoom, const uint32_t empty_color, const uint32_t food_color) {
-    struct coord_t* food = generate_food(ctxt, border_offset, zoom, empty_color);
+    spawn_food_seeded(ctxt, border_offset, zoom, empty_color, food_color, NULL);
+}
+
+void spawn_food_seeded(struct gfx_context_t* ctxt, const int border_offset, const int zoom, const uint32_t empty_color, const uint32_t food_color, unsigned int* seed) {
+    TRACE_SCOPE("spawn_food");
+    struct coord_t* food = generate_food(ctxt, border_offset, zoom, empty_color, seed);
     if (food != NULL) {
         draw_pixel(ctxt, food->x, food->y, zoom, food_color);
-        free(food);
+        coord_free(food);
     }
 }
\ No newline at end of file
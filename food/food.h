@@ -18,4 +18,17 @@
  */
 void spawn_food(struct gfx_context_t* ctxt, const int border_offset, const int zoom, const uint32_t empty_color, const uint32_t food_color);
 
+/**
+ * Same as spawn_food, drawing the position from a private rand_r state instead
+ * of rand(), so that several games can run side by side reproducibly.
+ *
+ * @param ctxt Pointer to the graphics context
+ * @param border_offset Distance in pixels from the window edges defining the game border
+ * @param zoom Size of a grid cell (used to align the food to the grid)
+ * @param empty_color Color representing an empty cell
+ * @param food_color Color used to draw the food
+ * @param seed State of rand_r, updated; NULL uses rand()
+ */
+void spawn_food_seeded(struct gfx_context_t* ctxt, const int border_offset, const int zoom, const uint32_t empty_color, const uint32_t food_color, unsigned int* seed);
+
 #endif
@@ -13,16 +13,428 @@
 #include "gfx.h"
 
 #include <assert.h>
-#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "font_glyphs.h"
+#include "../pattern/pattern.h"
+#include "../trace/trace.h"
 
 /// Create a fullscreen graphic window.
+/// The backend is read from the SNAKE_GFX_BACKEND environment variable
+/// ("sdl" or "offscreen"), SDL being the default, and the present path from
+/// SNAKE_GFX_PRESENT ("texture", "rects", or "auto" by default).
 /// @param title Title of the window.
 /// @param width Width of the window in pixels.
 /// @param height Height of the window in pixels.
 /// @return a pointer to the graphic context or NULL if it failed.
 struct gfx_context_t* gfx_create(char* title, uint32_t width, uint32_t height) {
+	const char* name = getenv("SNAKE_GFX_BACKEND");
+	enum gfx_backend backend = GFX_BACKEND_SDL;
+	if (name && strcmp(name, "offscreen") == 0)
+		backend = GFX_BACKEND_OFFSCREEN;
+	struct gfx_context_t* ctxt = gfx_create_backend(title, width, height, backend);
+
+	const char* present = getenv("SNAKE_GFX_PRESENT");
+	if (ctxt && present && strcmp(present, "texture") == 0)
+		gfx_set_present_mode(ctxt, GFX_PRESENT_TEXTURE);
+	else if (ctxt && present && strcmp(present, "rects") == 0)
+		gfx_set_present_mode(ctxt, GFX_PRESENT_RECTS);
+	return ctxt;
+}
+
+/// Create an offscreen graphic context: only the pixels buffer exists.
+/// If SNAKE_GFX_DUMP is set (e.g. "frames/frame_%06u.ppm", one %u or %d for
+/// the frame number), every present writes the buffer to a PPM file.
+/// @param width Width of the buffer in pixels.
+/// @param height Height of the buffer in pixels.
+/// @return a pointer to the graphic context or NULL if it failed.
+static struct gfx_context_t* gfx_create_offscreen(uint32_t width, uint32_t height) {
+	uint32_t* pixels = malloc(width * height * sizeof(uint32_t));
+	struct gfx_context_t* ctxt = calloc(1, sizeof(struct gfx_context_t));
+	if (!pixels || !ctxt) {
+		free(pixels);
+		free(ctxt);
+		return NULL;
+	}
+
+	const char* dump = getenv("SNAKE_GFX_DUMP");
+	ctxt->backend = GFX_BACKEND_OFFSCREEN;
+	ctxt->width = width;
+	ctxt->height = height;
+	ctxt->scale = 1;
+	ctxt->window_width = width;
+	ctxt->window_height = height;
+	ctxt->viewport = (SDL_Rect){ 0, 0, width, height };
+	ctxt->pixels = pixels;
+	ctxt->dump_pattern = (dump && *dump) ? strdup(dump) : NULL;
+	if (ctxt->dump_pattern && !parse_frame_pattern(ctxt->dump_pattern, &ctxt->dump_zero,
+			&ctxt->dump_digits, &ctxt->dump_prefix, &ctxt->dump_suffix)) {
+		fprintf(stderr, "Invalid SNAKE_GFX_DUMP pattern, expected one %%u or %%d: %s\n", dump);
+		free(ctxt->dump_pattern);
+		ctxt->dump_pattern = NULL;
+	}
+
+	gfx_clear(ctxt, COLOR_BLACK);
+	return ctxt;
+}
+
+/// Timed presents per path when the present mode is GFX_PRESENT_AUTO.
+#define GFX_CALIBRATION_FRAMES 16
+/// Colors filled with their own rect batch per frame; other colors are filled one rect at a time.
+#define GFX_BATCH_GROUPS 8
+/// Queued key presses looked at by quit_signal.
+#define GFX_QUIT_PEEK_KEYS 32
+
+/// Colors of the static layer (walls and portals), cached in a render target.
+static const uint32_t gfx_static_colors[] = { COLOR_BLUE, COLOR_GREEN };
+
+#define GFX_STATIC_COUNT (sizeof(gfx_static_colors) / sizeof(gfx_static_colors[0]))
+
+/// Rect with its own color (colors beyond GFX_BATCH_GROUPS).
+struct gfx_colored_rect {
+	SDL_Rect rect;
+	uint32_t color;
+};
+
+/// Growable array of rects of one color.
+struct gfx_rect_group {
+	uint32_t color;
+	int count;
+	int capacity;
+	SDL_Rect* rects;
+};
+
+/// State of the GFX_PRESENT_RECTS path.
+struct gfx_batch_t {
+	SDL_Texture* static_layer;     // static cells in its top-left logical size, NULL if targets are unsupported
+	uint64_t static_hash;          // content rendered in static_layer, 0 if none
+	struct gfx_rect_group statics[GFX_STATIC_COUNT];   // logical pixels
+	struct gfx_rect_group fills[GFX_BATCH_GROUPS];     // window pixels
+	int fill_groups;
+	struct gfx_colored_rect* others;   // window pixels
+	int other_count;
+	int other_capacity;
+};
+
+static uint64_t gfx_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void gfx_batch_destroy(struct gfx_batch_t** batch) {
+	if (!*batch)
+		return;
+	struct gfx_batch_t* b = *batch;
+	if (b->static_layer)
+		SDL_DestroyTexture(b->static_layer);
+	for (size_t i = 0; i < GFX_STATIC_COUNT; i++)
+		free(b->statics[i].rects);
+	for (int i = 0; i < GFX_BATCH_GROUPS; i++)
+		free(b->fills[i].rects);
+	free(b->others);
+	free(b);
+	*batch = NULL;
+}
+
+/// Create the static layer at the creation size, the largest logical size.
+static struct gfx_batch_t* gfx_batch_create(struct gfx_context_t* ctxt) {
+	struct gfx_batch_t* batch = calloc(1, sizeof(struct gfx_batch_t));
+	if (!batch)
+		return NULL;
+
+	if (SDL_RenderTargetSupported(ctxt->renderer)) {
+		batch->static_layer = SDL_CreateTexture(ctxt->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+			ctxt->window_width, ctxt->window_height);
+		if (batch->static_layer) {
+			SDL_SetTextureBlendMode(batch->static_layer, SDL_BLENDMODE_BLEND);
+			SDL_SetTextureScaleMode(batch->static_layer, SDL_ScaleModeNearest);
+		}
+	}
+	for (size_t i = 0; i < GFX_STATIC_COUNT; i++)
+		batch->statics[i].color = gfx_static_colors[i];
+	return batch;
+}
+
+/// Append a rect to a group, growing it as needed.
+static bool gfx_group_push(struct gfx_rect_group* group, SDL_Rect rect) {
+	if (group->count == group->capacity) {
+		int capacity = group->capacity ? 2 * group->capacity : 256;
+		SDL_Rect* rects = realloc(group->rects, capacity * sizeof(SDL_Rect));
+		if (!rects)
+			return false;
+		group->rects = rects;
+		group->capacity = capacity;
+	}
+	group->rects[group->count++] = rect;
+	return true;
+}
+
+/// Fill a group with its color in one call.
+static void gfx_group_fill(SDL_Renderer* renderer, const struct gfx_rect_group* group) {
+	if (group->count == 0)
+		return;
+	SDL_SetRenderDrawColor(renderer, COLOR_GET_R(group->color), COLOR_GET_G(group->color), COLOR_GET_B(group->color), 255);
+	SDL_RenderFillRects(renderer, group->rects, group->count);
+}
+
+/// Window rect of a horizontal run of logical pixels.
+static SDL_Rect gfx_run_rect(const struct gfx_context_t* ctxt, int x, int y, int length) {
+	const SDL_Rect* vp = &ctxt->viewport;
+	int x0 = vp->x + x * vp->w / (int)ctxt->width;
+	int x1 = vp->x + (x + length) * vp->w / (int)ctxt->width;
+	int y0 = vp->y + y * vp->h / (int)ctxt->height;
+	int y1 = vp->y + (y + 1) * vp->h / (int)ctxt->height;
+	return (SDL_Rect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+/// Sort a run into the static or fill batches.
+static bool gfx_batch_add_run(struct gfx_context_t* ctxt, struct gfx_batch_t* batch, uint32_t color, int x, int y, int length, uint64_t* hash) {
+	for (size_t i = 0; i < GFX_STATIC_COUNT; i++) {
+		if (color == gfx_static_colors[i]) {
+			// FNV-1a over the static runs, to know when the cached layer is stale
+			uint64_t key[2] = { ((uint64_t)x << 32) | (uint32_t)y, ((uint64_t)length << 32) | color };
+			const uint8_t* bytes = (const uint8_t*)key;
+			for (size_t b = 0; b < sizeof(key); b++)
+				*hash = (*hash ^ bytes[b]) * 0x100000001b3ull;
+			return gfx_group_push(&batch->statics[i], (SDL_Rect){ x, y, length, 1 });
+		}
+	}
+	SDL_Rect rect = gfx_run_rect(ctxt, x, y, length);
+	for (int i = 0; i < batch->fill_groups; i++) {
+		if (color == batch->fills[i].color)
+			return gfx_group_push(&batch->fills[i], rect);
+	}
+	if (batch->fill_groups < GFX_BATCH_GROUPS) {
+		batch->fills[batch->fill_groups].color = color;
+		batch->fills[batch->fill_groups].count = 0;
+		return gfx_group_push(&batch->fills[batch->fill_groups++], rect);
+	}
+	// Rare colors: one fill each
+	if (batch->other_count == batch->other_capacity) {
+		int capacity = batch->other_capacity ? 2 * batch->other_capacity : 64;
+		struct gfx_colored_rect* others = realloc(batch->others, capacity * sizeof(struct gfx_colored_rect));
+		if (!others)
+			return false;
+		batch->others = others;
+		batch->other_capacity = capacity;
+	}
+	batch->others[batch->other_count++] = (struct gfx_colored_rect){ rect, color };
+	return true;
+}
+
+/// Present path keeping the board as cells: runs of equal color are sent as
+/// rect fills batched per color, and the static layer is re-rendered only when walls or portals changed.
+/// @param ctxt Graphic context (SDL backend), already cleared.
+/// @return false if the batch state could not be created or grown.
+static bool gfx_present_rects(struct gfx_context_t* ctxt) {
+	if (!ctxt->batch && !(ctxt->batch = gfx_batch_create(ctxt)))
+		return false;
+	struct gfx_batch_t* batch = ctxt->batch;
+	for (size_t i = 0; i < GFX_STATIC_COUNT; i++)
+		batch->statics[i].count = 0;
+	batch->fill_groups = 0;
+	batch->other_count = 0;
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const int width = ctxt->width;
+	for (int y = 0; y < (int)ctxt->height; y++) {
+		const uint32_t* row = &ctxt->pixels[width * y];
+		for (int x = 0; x < width;) {
+			uint32_t color = row[x];
+			int start = x;
+			while (x < width && row[x] == color)
+				x++;
+			if (color != COLOR_BLACK && !gfx_batch_add_run(ctxt, batch, color, start, y, x - start, &hash))
+				return false;
+		}
+	}
+
+	SDL_Renderer* renderer = ctxt->renderer;
+	if (batch->static_layer) {
+		if (hash != batch->static_hash) {
+			TRACE_SCOPE("static_layer");
+			SDL_SetRenderTarget(renderer, batch->static_layer);
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+			SDL_RenderClear(renderer);
+			for (size_t i = 0; i < GFX_STATIC_COUNT; i++)
+				gfx_group_fill(renderer, &batch->statics[i]);
+			SDL_SetRenderTarget(renderer, NULL);
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			batch->static_hash = hash;
+		}
+		SDL_Rect area = { 0, 0, ctxt->width, ctxt->height };
+		SDL_RenderCopy(renderer, batch->static_layer, &area, &ctxt->viewport);
+	} else {
+		// No render targets: static runs are filled every frame
+		for (size_t i = 0; i < GFX_STATIC_COUNT; i++) {
+			struct gfx_rect_group* group = &batch->statics[i];
+			for (int r = 0; r < group->count; r++)
+				group->rects[r] = gfx_run_rect(ctxt, group->rects[r].x, group->rects[r].y, group->rects[r].w);
+			gfx_group_fill(renderer, group);
+		}
+	}
+
+	for (int i = 0; i < batch->fill_groups; i++)
+		gfx_group_fill(renderer, &batch->fills[i]);
+	for (int r = 0; r < batch->other_count; r++) {
+		uint32_t color = batch->others[r].color;
+		SDL_SetRenderDrawColor(renderer, COLOR_GET_R(color), COLOR_GET_G(color), COLOR_GET_B(color), 255);
+		SDL_RenderFillRect(renderer, &batch->others[r].rect);
+	}
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	return true;
+}
+
+/// Choose the path of the next presents for the current logical resolution:
+/// the requested one, or in AUTO mode the path already measured at this
+/// resolution, else start timing both.
+/// @param ctxt Graphic context.
+static void gfx_select_present_path(struct gfx_context_t* ctxt) {
+	ctxt->calibration_ns[GFX_PRESENT_TEXTURE] = 0;
+	ctxt->calibration_ns[GFX_PRESENT_RECTS] = 0;
+	ctxt->calibration_frames = 0;
+	if (ctxt->present_mode != GFX_PRESENT_AUTO || ctxt->backend != GFX_BACKEND_SDL) {
+		ctxt->present_path = (ctxt->present_mode == GFX_PRESENT_RECTS) ? GFX_PRESENT_RECTS : GFX_PRESENT_TEXTURE;
+		return;
+	}
+	for (int i = 0; i < ctxt->present_cached; i++) {
+		if (ctxt->present_cache[i].width == ctxt->width && ctxt->present_cache[i].height == ctxt->height) {
+			ctxt->present_path = ctxt->present_cache[i].path;
+			return;
+		}
+	}
+	ctxt->calibration_frames = 2 * GFX_CALIBRATION_FRAMES;
+	ctxt->present_path = GFX_PRESENT_TEXTURE;
+}
+
+/// Select how gfx_present sends the pixels to the renderer.
+/// GFX_PRESENT_AUTO times both paths over the next presents and keeps the
+/// faster; the choice is remembered per logical resolution, so switching back
+/// to a resolution already measured does not time it again. Setting a mode
+/// forgets the previous choices.
+/// @param ctxt Graphic context.
+/// @param mode GFX_PRESENT_TEXTURE, GFX_PRESENT_RECTS or GFX_PRESENT_AUTO.
+void gfx_set_present_mode(struct gfx_context_t* ctxt, enum gfx_present_mode mode) {
+	ctxt->present_mode = mode;
+	ctxt->present_cached = 0;
+	gfx_select_present_path(ctxt);
+}
+
+/// Account one timed present and alternate the paths; pick the faster at the end.
+static void gfx_calibrate(struct gfx_context_t* ctxt, enum gfx_present_mode path, uint64_t duration_ns) {
+	ctxt->calibration_ns[path] += duration_ns;
+	ctxt->present_path = (path == GFX_PRESENT_TEXTURE) ? GFX_PRESENT_RECTS : GFX_PRESENT_TEXTURE;
+	if (--ctxt->calibration_frames > 0)
+		return;
+	uint64_t texture_ns = ctxt->calibration_ns[GFX_PRESENT_TEXTURE];
+	uint64_t rects_ns = ctxt->calibration_ns[GFX_PRESENT_RECTS];
+	ctxt->present_path = (rects_ns < texture_ns) ? GFX_PRESENT_RECTS : GFX_PRESENT_TEXTURE;
+	if (ctxt->present_cached < GFX_PRESENT_CACHE)
+		ctxt->present_cache[ctxt->present_cached++] = (struct gfx_present_choice){ ctxt->width, ctxt->height, ctxt->present_path };
+	// stdout belongs to the asynchronous game log, and the log module is not linked in the tools
+	fprintf(stderr, "gfx: %ux%u presented with %s (texture %.1f us, rects %.1f us per frame)\n",
+		ctxt->width, ctxt->height, (ctxt->present_path == GFX_PRESENT_RECTS) ? "rects" : "texture",
+		texture_ns / 1e3 / GFX_CALIBRATION_FRAMES, rects_ns / 1e3 / GFX_CALIBRATION_FRAMES);
+}
+
+/// Event watch flagging window resizes, whichever loop consumes the event.
+/// @param userdata Graphic context of the window.
+/// @param event Event being queued.
+/// @return always 0 (ignored by SDL for event watches).
+static int gfx_event_watch(void* userdata, SDL_Event* event) {
+	struct gfx_context_t* ctxt = userdata;
+	if (event->type == SDL_WINDOWEVENT && event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+		ctxt->layout_dirty = true;
+		ctxt->dirty = true;
+	}
+	// The window content was lost (uncovered, restored): present again
+	if (event->type == SDL_WINDOWEVENT && event->window.event == SDL_WINDOWEVENT_EXPOSED)
+		ctxt->dirty = true;
+	// Render target content was lost: the static layer must be rendered again
+	if ((event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET) && ctxt->batch) {
+		ctxt->batch->static_hash = 0;
+		ctxt->dirty = true;
+	}
+	return 0;
+}
+
+/// Compute where the pixels buffer is presented in the current window:
+/// the largest integer upscale that fits, centered. If the buffer does not
+/// fit at all, it is shrunk to fit while keeping its aspect ratio.
+/// @param ctxt Graphic context (SDL backend).
+static void gfx_update_layout(struct gfx_context_t* ctxt) {
+	int output_width, output_height;
+	if (SDL_GetRendererOutputSize(ctxt->renderer, &output_width, &output_height) != 0) {
+		output_width = ctxt->window_width;
+		output_height = ctxt->window_height;
+	}
+
+	int factor_x = output_width / (int)ctxt->width;
+	int factor_y = output_height / (int)ctxt->height;
+	int factor = (factor_x < factor_y) ? factor_x : factor_y;
+	int w, h;
+	if (factor >= 1) {
+		w = ctxt->width * factor;
+		h = ctxt->height * factor;
+	} else if ((int64_t)output_width * ctxt->height < (int64_t)output_height * ctxt->width) {
+		w = output_width;
+		h = (int)((int64_t)output_width * ctxt->height / ctxt->width);
+	} else {
+		w = (int)((int64_t)output_height * ctxt->width / ctxt->height);
+		h = output_height;
+	}
+	ctxt->viewport = (SDL_Rect){ (output_width - w) / 2, (output_height - h) / 2, w, h };
+	ctxt->layout_dirty = false;
+}
+
+/// Change the logical resolution of a graphic context: the pixels buffer
+/// becomes (creation size / scale) and is upscaled when presented.
+/// The buffer and the textures keep their creation size, the largest
+/// logical size, and only their top-left part is used: nothing is
+/// reallocated. The buffer is cleared when the scale changes.
+/// @param ctxt Graphic context.
+/// @param scale Window pixels per logical pixel (1 = full resolution).
+/// @return true on success, false if the scale is 0.
+bool gfx_set_scale(struct gfx_context_t* ctxt, uint32_t scale) {
+	if (scale == 0)
+		return false;
+	if (scale == ctxt->scale)
+		return true;
+
+	ctxt->width = ctxt->window_width / scale;
+	ctxt->height = ctxt->window_height / scale;
+	ctxt->scale = scale;
+	if (ctxt->backend == GFX_BACKEND_SDL) {
+		ctxt->layout_dirty = true;
+		if (ctxt->batch)
+			ctxt->batch->static_hash = 0;
+	} else {
+		ctxt->viewport = (SDL_Rect){ 0, 0, ctxt->width, ctxt->height };
+	}
+	gfx_select_present_path(ctxt);
+	gfx_clear(ctxt, COLOR_BLACK);
+	return true;
+}
+
+/// Create a graphic context using the given backend.
+/// @param title Title of the window (ignored offscreen).
+/// @param width Width of the window in pixels.
+/// @param height Height of the window in pixels.
+/// @param backend GFX_BACKEND_SDL or GFX_BACKEND_OFFSCREEN.
+/// @return a pointer to the graphic context or NULL if it failed.
+struct gfx_context_t* gfx_create_backend(char* title, uint32_t width, uint32_t height, enum gfx_backend backend) {
+	if (backend == GFX_BACKEND_OFFSCREEN)
+		return gfx_create_offscreen(width, height);
+
 	if (SDL_Init(SDL_INIT_VIDEO) != 0)
 		goto error;
+	// Upscaling must keep the cells sharp
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
 	SDL_Window* window = SDL_CreateWindow(
 		title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height,
 		SDL_WINDOW_RESIZABLE);
@@ -30,20 +442,27 @@ struct gfx_context_t* gfx_create(char* title, uint32_t width, uint32_t height) {
 	SDL_Texture* texture = SDL_CreateTexture(
 		renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
 	uint32_t* pixels = malloc(width * height * sizeof(uint32_t));
-	struct gfx_context_t* ctxt = malloc(sizeof(struct gfx_context_t));
-	if (TTF_Init() == -1)
-		goto error;
+	struct gfx_context_t* ctxt = calloc(1, sizeof(struct gfx_context_t));
 
 	if (!window || !renderer || !texture || !pixels || !ctxt)
 		goto error;
 
+	ctxt->backend = GFX_BACKEND_SDL;
 	ctxt->renderer = renderer;
 	ctxt->texture = texture;
 	ctxt->window = window;
 	ctxt->width = width;
 	ctxt->height = height;
+	ctxt->scale = 1;
+	ctxt->window_width = width;
+	ctxt->window_height = height;
+	ctxt->layout_dirty = true;
 	ctxt->pixels = pixels;
 
+	gfx_set_present_mode(ctxt, GFX_PRESENT_AUTO);
+
+	SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+	SDL_AddEventWatch(gfx_event_watch, ctxt);
 	SDL_ShowCursor(SDL_DISABLE);
 	gfx_clear(ctxt, COLOR_BLACK);
 	return ctxt;
@@ -58,8 +477,10 @@ error:
 /// @param row Y coordinate of the pixel.
 /// @param color Color of the pixel.
 void gfx_putpixel(struct gfx_context_t* ctxt, uint32_t column, uint32_t row, uint32_t color) {
-	if (column < ctxt->width && row < ctxt->height)
+	if (column < ctxt->width && row < ctxt->height) {
 		ctxt->pixels[ctxt->width * row + column] = color;
+		ctxt->dirty = true;
+	}
 }
 
 /// Get a pixel in the specified graphic context.
@@ -80,38 +501,135 @@ void gfx_clear(struct gfx_context_t* ctxt, uint32_t color) {
 	int n = ctxt->width * ctxt->height;
 	while (n)
 		ctxt->pixels[--n] = color;
-	SDL_RenderClear(ctxt->renderer);
+	ctxt->dirty = true;
+	if (ctxt->renderer)
+		SDL_RenderClear(ctxt->renderer);
+}
+
+/// Write the pixels buffer of an offscreen context to the next dump file.
+/// @param ctxt Offscreen graphic context with a dump pattern.
+static void gfx_dump_frame(struct gfx_context_t* ctxt) {
+	char name[4096];
+	snprintf(name, sizeof(name), ctxt->dump_zero ? "%.*s%0*u%s" : "%.*s%*u%s",
+		ctxt->dump_prefix, ctxt->dump_pattern, ctxt->dump_digits, ctxt->frame_index,
+		ctxt->dump_pattern + ctxt->dump_suffix);
+	FILE* file = fopen(name, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open dump file: %s\n", name);
+		return;
+	}
+	fprintf(file, "P6\n%u %u\n255\n", ctxt->width, ctxt->height);
+	for (uint32_t i = 0; i < ctxt->width * ctxt->height; i++) {
+		uint32_t color = ctxt->pixels[i];
+		uint8_t rgb[3] = { COLOR_GET_R(color), COLOR_GET_G(color), COLOR_GET_B(color) };
+		fwrite(rgb, 1, sizeof(rgb), file);
+	}
+	fclose(file);
 }
 
 /// Display the graphic context.
 /// @param ctxt Graphic context to clear.
 void gfx_present(struct gfx_context_t* ctxt) {
-	SDL_UpdateTexture(ctxt->texture, NULL, ctxt->pixels, ctxt->width * sizeof(uint32_t));
-	SDL_RenderCopy(ctxt->renderer, ctxt->texture, NULL, NULL);
+	TRACE_SCOPE("gfx_present");
+	ctxt->dirty = false;
+	if (ctxt->backend == GFX_BACKEND_OFFSCREEN) {
+		if (ctxt->dump_pattern)
+			gfx_dump_frame(ctxt);
+		ctxt->frame_index++;
+		return;
+	}
+	if (ctxt->layout_dirty)
+		gfx_update_layout(ctxt);
+
+	enum gfx_present_mode path = ctxt->present_path;
+	const bool timed = ctxt->calibration_frames > 0;
+	const uint64_t start_ns = timed ? gfx_now_ns() : 0;
+	SDL_RenderClear(ctxt->renderer);
+	if (path != GFX_PRESENT_RECTS || !gfx_present_rects(ctxt)) {
+		SDL_Rect area = { 0, 0, ctxt->width, ctxt->height };
+		SDL_UpdateTexture(ctxt->texture, &area, ctxt->pixels, ctxt->width * sizeof(uint32_t));
+		SDL_RenderCopy(ctxt->renderer, ctxt->texture, &area, &ctxt->viewport);
+	}
+	// With vsync, the present itself only measures the wait for the display
+	if (timed && ctxt->vsync)
+		gfx_calibrate(ctxt, path, gfx_now_ns() - start_ns);
 	SDL_RenderPresent(ctxt->renderer);
+	if (timed && !ctxt->vsync)
+		gfx_calibrate(ctxt, path, gfx_now_ns() - start_ns);
+	ctxt->frame_index++;
+}
+
+/// Make presents wait for the vertical blank (SDL_RENDERER_PRESENTVSYNC).
+/// @param ctxt Graphic context.
+/// @param enabled true to synchronize presents with the display.
+/// @return true if the renderer reports the requested mode (always false offscreen).
+bool gfx_set_vsync(struct gfx_context_t* ctxt, bool enabled) {
+	if (ctxt->backend != GFX_BACKEND_SDL)
+		return false;
+	SDL_RendererInfo info;
+	if (SDL_RenderSetVSync(ctxt->renderer, enabled ? 1 : 0) != 0 || SDL_GetRendererInfo(ctxt->renderer, &info) != 0) {
+		ctxt->vsync = false;
+		return false;
+	}
+	ctxt->vsync = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+	return ctxt->vsync == enabled;
+}
+
+/// Sleep until an event is queued or the timeout expires (events are not removed).
+/// @param ctxt Graphic context.
+/// @param timeout_ms Maximum wait in milliseconds.
+void gfx_wait_event(struct gfx_context_t* ctxt, int timeout_ms) {
+	TRACE_SCOPE("gfx_wait_event");
+	if (timeout_ms <= 0)
+		return;
+	if (ctxt->backend == GFX_BACKEND_SDL)
+		SDL_WaitEventTimeout(NULL, timeout_ms);
+	else
+		SDL_Delay(timeout_ms);
 }
 
 /// Destroy a graphic window.
 /// @param ctxt Graphic context of the window to close.
 void gfx_destroy(struct gfx_context_t* ctxt) {
-	SDL_ShowCursor(SDL_ENABLE);
-	SDL_DestroyTexture(ctxt->texture);
-	SDL_DestroyRenderer(ctxt->renderer);
-	SDL_DestroyWindow(ctxt->window);
+	if (ctxt->backend == GFX_BACKEND_SDL) {
+		SDL_DelEventWatch(gfx_event_watch, ctxt);
+		SDL_ShowCursor(SDL_ENABLE);
+		gfx_batch_destroy(&ctxt->batch);
+		SDL_DestroyTexture(ctxt->texture);
+		SDL_DestroyRenderer(ctxt->renderer);
+		SDL_DestroyWindow(ctxt->window);
+	}
 	free(ctxt->pixels);
+	free(ctxt->dump_pattern);
 	ctxt->texture = NULL;
 	ctxt->renderer = NULL;
 	ctxt->window = NULL;
 	ctxt->pixels = NULL;
-	TTF_Quit();
-	SDL_Quit();
+	if (ctxt->backend == GFX_BACKEND_SDL)
+		SDL_Quit();
 	free(ctxt);
 }
 
+static gfx_key_source_fn key_source = NULL;
+static void* key_source_data = NULL;
+
+/// Install a source of synthetic keys, asked first by gfx_keypressed.
+/// @param source The source, NULL to remove it.
+/// @param data Passed to the source.
+void gfx_set_key_source(gfx_key_source_fn source, void* data) {
+	key_source = source;
+	key_source_data = data;
+}
+
 /// If a key was pressed, returns its key code (non blocking call).
 /// List of key codes: https://wiki.libsdl.org/SDL_Keycode
 /// @return the key that was pressed or 0 if none was pressed.
 SDL_Keycode gfx_keypressed() {
+	if (key_source) {
+		SDL_Keycode key = key_source(key_source_data);
+		if (key)
+			return key;
+	}
 	SDL_Event event;
 	if (SDL_PollEvent(&event)) {
 		if (event.type == SDL_KEYDOWN)
@@ -120,31 +638,53 @@ SDL_Keycode gfx_keypressed() {
 	return 0;
 }
 
+/// Same as gfx_keypressed, also giving the time the key event was queued.
+/// SDL timestamps count milliseconds since SDL_Init; the result is moved to
+/// the CLOCK_MONOTONIC time base of the game loop.
+/// @param event_ns Receives the event time in nanoseconds (CLOCK_MONOTONIC), if a key was pressed.
+/// @return the key that was pressed or 0 if none was pressed.
+SDL_Keycode gfx_keypressed_at(uint64_t* event_ns) {
+	SDL_Event event;
+	if (SDL_PollEvent(&event)) {
+		if (event.type == SDL_KEYDOWN) {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			uint64_t now_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+			uint64_t age_ns = (uint64_t)(Uint32)(SDL_GetTicks() - event.key.timestamp) * 1000000u;
+			*event_ns = (age_ns < now_ns) ? now_ns - age_ns : now_ns;
+			return event.key.keysym.sym;
+		}
+	}
+	return 0;
+}
+
 /// Check for quit signals such as: alt-f4, ctrl+c, ctrl+d or ESC
+/// Only the events that can quit are taken from the queue: other key presses
+/// stay there for gfx_keypressed, so a menu polling both does not lose them.
 //  @return true if there is a quit signal
 bool quit_signal() {
 	bool signal = false;
-	// process events
 	SDL_Event event;
-	while (SDL_PollEvent(&event)) {
-		switch (event.type) {
-		case SDL_QUIT:  // signal when window "X" icon pressed
+	SDL_PumpEvents();
+	// signal when window "X" icon pressed
+	while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_QUIT, SDL_QUIT) > 0)
+		signal = true;
+	// escape pressed
+	while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_KEYUP, SDL_KEYUP) > 0) {
+		if (event.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
 			signal = true;
-			break;
-		case SDL_KEYDOWN:
-			if ((event.key.keysym.mod & KMOD_CTRL) != 0) {
-				SDL_Keycode k = event.key.keysym.sym;
-				signal = (k == SDLK_c) || (k == SDLK_d);  // ctrl-c or ctrl-d pressed
-			}
-			break;
-		case SDL_KEYUP:
-			// escape pressed
-			signal = event.key.keysym.scancode == SDL_SCANCODE_ESCAPE;
-			break;
-		default:
-			break;
-		}
 	}
+	// ctrl-c or ctrl-d pressed, looked at without taking them
+	SDL_Event keys[GFX_QUIT_PEEK_KEYS];
+	int count = SDL_PeepEvents(keys, GFX_QUIT_PEEK_KEYS, SDL_PEEKEVENT, SDL_KEYDOWN, SDL_KEYDOWN);
+	for (int i = 0; i < count; i++) {
+		SDL_Keycode k = keys[i].key.keysym.sym;
+		if ((keys[i].key.keysym.mod & KMOD_CTRL) != 0 && (k == SDLK_c || k == SDLK_d))
+			signal = true;
+	}
+	// The other events (window, mouse, text) are not used
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_KEYDOWN - 1);
+	SDL_FlushEvents(SDL_KEYUP + 1, SDL_LASTEVENT);
 	return signal;
 }
 
@@ -155,43 +695,142 @@ void wait_for_quit_signal() {
 	}
 }
 
-void draw_pixel(struct gfx_context_t* context, int x, int y, int zoom, uint32_t color) {
-	for (int ix = 0; ix < zoom; ix++) {
-		for (int iy = 0; iy < zoom; iy++) {
-			gfx_putpixel(context, x + ix, y + iy, color);
-		}
-	}
+/// Generic cell kernels, for any zoom.
+static void cell_fill_generic(uint32_t* dst, uint32_t stride, int zoom, uint32_t color) {
+	for (int row = 0; row < zoom; row++, dst += stride)
+		for (int column = 0; column < zoom; column++)
+			dst[column] = color;
 }
 
-// https://stackoverflow.com/questions/22886500/how-to-render-text-in-sdl2
-void draw_text_ttf(struct gfx_context_t* ctxt, const char* text, int x, int y, int size, SDL_Color color, const char* font_path) {
-	TTF_Font* font = TTF_OpenFont(font_path, size);
-	if (!font) {
-		fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
-		return;
+static bool cell_test_generic(const uint32_t* src, uint32_t stride, int zoom, uint32_t color) {
+	uint32_t diff = 0;
+	for (int row = 0; row < zoom; row++, src += stride)
+		for (int column = 0; column < zoom; column++)
+			diff |= src[column] ^ color;
+	return diff == 0;
+}
+
+/// Kernels specialized for a compile-time zoom N: the constant trip counts
+/// let the compiler unroll each row into a few (vector) stores or compares.
+#define DEFINE_CELL_KERNELS(N) \
+	static void cell_fill_##N(uint32_t* dst, uint32_t stride, int zoom, uint32_t color) { \
+		(void)zoom; \
+		for (int row = 0; row < N; row++, dst += stride) { \
+			_Pragma("GCC unroll 32") \
+			for (int column = 0; column < N; column++) \
+				dst[column] = color; \
+		} \
+	} \
+	static bool cell_test_##N(const uint32_t* src, uint32_t stride, int zoom, uint32_t color) { \
+		(void)zoom; \
+		uint32_t diff = 0; \
+		for (int row = 0; row < N; row++, src += stride) { \
+			_Pragma("GCC unroll 32") \
+			for (int column = 0; column < N; column++) \
+				diff |= src[column] ^ color; \
+		} \
+		return diff == 0; \
 	}
 
-	SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
-	if (!surface) {
-		fprintf(stderr, "Failed to render text: %s\n", TTF_GetError());
-		TTF_CloseFont(font);
-		return;
+DEFINE_CELL_KERNELS(1)
+DEFINE_CELL_KERNELS(2)
+DEFINE_CELL_KERNELS(4)
+DEFINE_CELL_KERNELS(8)
+DEFINE_CELL_KERNELS(16)
+DEFINE_CELL_KERNELS(32)
+
+/// Specialized kernels, indexed by log2(zoom).
+static const struct {
+	gfx_cell_fill_fn fill;
+	gfx_cell_test_fn test;
+} cell_kernels[] = {
+	{ cell_fill_1, cell_test_1 },
+	{ cell_fill_2, cell_test_2 },
+	{ cell_fill_4, cell_test_4 },
+	{ cell_fill_8, cell_test_8 },
+	{ cell_fill_16, cell_test_16 },
+	{ cell_fill_32, cell_test_32 },
+};
+
+/// Select the cell kernels of a zoom; called once per zoom change.
+/// @param ctxt Graphic context caching the selection.
+/// @param zoom Cell size in pixels.
+static void gfx_select_cell_kernels(struct gfx_context_t* ctxt, int zoom) {
+	ctxt->cell_fill = cell_fill_generic;
+	ctxt->cell_test = cell_test_generic;
+	for (size_t i = 0; i < sizeof(cell_kernels) / sizeof(cell_kernels[0]); i++) {
+		if (zoom == 1 << i) {
+			ctxt->cell_fill = cell_kernels[i].fill;
+			ctxt->cell_test = cell_kernels[i].test;
+		}
 	}
+	ctxt->cell_zoom = zoom;
+}
+
+/// Check if a cell lies entirely inside the pixels buffer.
+static inline bool cell_inside(const struct gfx_context_t* ctxt, int x, int y, int zoom) {
+	return x >= 0 && y >= 0 && x + zoom <= (int)ctxt->width && y + zoom <= (int)ctxt->height;
+}
 
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(ctxt->renderer, surface);
-	SDL_FreeSurface(surface);
-	if (!texture) {
-		fprintf(stderr, "Failed to create texture: %s\n", SDL_GetError());
-		TTF_CloseFont(font);
+/// Fill a zoom x zoom cell; cells crossing the buffer edge are clipped.
+/// @param context Graphic context.
+/// @param x X coordinate of the top-left pixel of the cell.
+/// @param y Y coordinate of the top-left pixel of the cell.
+/// @param zoom Cell size in pixels.
+/// @param color Color of the cell.
+void draw_pixel(struct gfx_context_t* context, int x, int y, int zoom, uint32_t color) {
+	if (zoom != context->cell_zoom)
+		gfx_select_cell_kernels(context, zoom);
+	if (cell_inside(context, x, y, zoom)) {
+		context->cell_fill(&context->pixels[context->width * y + x], context->width, zoom, color);
+		context->dirty = true;
 		return;
 	}
+	for (int ix = 0; ix < zoom; ix++) {
+		for (int iy = 0; iy < zoom; iy++) {
+			gfx_putpixel(context, x + ix, y + iy, color);
+		}
+	}
+}
 
-	SDL_Rect dst = { x, y, 0, 0 };
-	SDL_QueryTexture(texture, NULL, NULL, &dst.w, &dst.h);
-	SDL_RenderCopy(ctxt->renderer, texture, NULL, &dst);
+/// Check if every pixel of a cell has the given color.
+/// @param ctxt Graphic context.
+/// @param x X coordinate of the top-left pixel of the cell.
+/// @param y Y coordinate of the top-left pixel of the cell.
+/// @param zoom Cell size in pixels.
+/// @param color Expected color.
+/// @return true if the cell is entirely inside the buffer and uniformly of that color.
+bool gfx_cell_is(struct gfx_context_t* ctxt, int x, int y, int zoom, uint32_t color) {
+	if (zoom != ctxt->cell_zoom)
+		gfx_select_cell_kernels(ctxt, zoom);
+	if (!cell_inside(ctxt, x, y, zoom))
+		return false;
+	return ctxt->cell_test(&ctxt->pixels[ctxt->width * y + x], ctxt->width, zoom, color);
+}
 
-	SDL_DestroyTexture(texture);
-	TTF_CloseFont(font);
+/// Draw text into the pixels buffer with the built-in bitmap font.
+/// Glyphs are upscaled by size / FONT_POINT_SIZE (at least 1); characters
+/// outside printable ASCII are drawn as '?'.
+/// @param ctxt Graphic context.
+/// @param text Text to draw.
+/// @param x X coordinate of the top-left pixel of the text.
+/// @param y Y coordinate of the top-left pixel of the text.
+/// @param size Font size in points.
+/// @param color Color of the text.
+void draw_text(struct gfx_context_t* ctxt, const char* text, int x, int y, int size, uint32_t color) {
+	TRACE_SCOPE("draw_text");
+	const int scale = (size >= FONT_POINT_SIZE) ? size / FONT_POINT_SIZE : 1;
+	for (int pen = x; *text; text++, pen += FONT_GLYPH_WIDTH * scale) {
+		unsigned char c = (unsigned char)*text;
+		if (c < FONT_FIRST_CHAR || c > FONT_LAST_CHAR)
+			c = '?';
+		const uint16_t* rows = font_glyphs[c - FONT_FIRST_CHAR];
+		for (int row = 0; row < FONT_GLYPH_HEIGHT; row++) {
+			for (uint16_t bits = rows[row]; bits; bits &= bits - 1) {
+				draw_pixel(ctxt, pen + __builtin_ctz(bits) * scale, y + row * scale, scale, color);
+			}
+		}
+	}
 }
 
 void draw_border(struct gfx_context_t* context, int x0, int x1, int y0, int y1, uint32_t wall) {
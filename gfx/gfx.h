@@ -18,25 +18,88 @@
 #define COLOR_WHITE  0x00FFFFFF
 #define COLOR_YELLOW 0x00FFFF00
 
+enum gfx_backend {
+    GFX_BACKEND_SDL,        // window, renderer and streaming texture
+    GFX_BACKEND_OFFSCREEN   // pixels buffer only, no display needed
+};
+
+/// How gfx_present sends the pixels buffer to the SDL renderer.
+enum gfx_present_mode {
+    GFX_PRESENT_TEXTURE,    // upload the whole buffer into a streaming texture
+    GFX_PRESENT_RECTS,      // batched rect fills per color, cached static layer
+    GFX_PRESENT_AUTO        // time both paths on the first presents, keep the faster
+};
+
+struct gfx_batch_t;
+
+/// Logical resolutions whose GFX_PRESENT_AUTO path is remembered.
+#define GFX_PRESENT_CACHE 4
+
+/// Present path measured by GFX_PRESENT_AUTO at one logical resolution.
+struct gfx_present_choice {
+    uint32_t width;
+    uint32_t height;
+    enum gfx_present_mode path;
+};
+
+/// Synthetic keys for gfx_keypressed (menus), e.g. an unattended run; 0 when it has none.
+typedef SDL_Keycode (*gfx_key_source_fn)(void* data);
+
+/// Cell kernels: fill or test a zoom x zoom cell whose top-left pixel is at dst/src.
+typedef void (*gfx_cell_fill_fn)(uint32_t* dst, uint32_t stride, int zoom, uint32_t color);
+typedef bool (*gfx_cell_test_fn)(const uint32_t* src, uint32_t stride, int zoom, uint32_t color);
+
 struct gfx_context_t {
+    enum gfx_backend backend;
     SDL_Window* window;
     SDL_Renderer* renderer;
-    SDL_Texture* texture;
+    SDL_Texture* texture;    // streaming texture and pixels buffer are sized for scale 1
     uint32_t* pixels;
-    uint32_t width;
+    uint32_t width;          // logical size of the pixels buffer
     uint32_t height;
+    uint32_t scale;          // window pixels per logical pixel at creation size
+    uint32_t window_width;   // size the context was created with
+    uint32_t window_height;
+    SDL_Rect viewport;       // where the buffer is presented in the window
+    bool layout_dirty;       // window resized since the viewport was computed
+    bool dirty;              // pixels changed (or window exposed) since the last present
+    bool vsync;              // presents wait for the vertical blank
+    char* dump_pattern;     // offscreen only: path of the PPM dumped on present, see parse_frame_pattern
+    int dump_prefix;        // pattern bytes before the frame number conversion
+    int dump_suffix;        // offset of the pattern after the conversion
+    int dump_digits;        // field width of the frame number
+    bool dump_zero;         // frame number padded with zeros
+    uint32_t frame_index;
+    enum gfx_present_mode present_mode;   // requested mode
+    enum gfx_present_mode present_path;   // path of the next present (texture or rects)
+    int calibration_frames;               // AUTO: presents still to be timed
+    uint64_t calibration_ns[2];           // AUTO: time spent per path
+    struct gfx_present_choice present_cache[GFX_PRESENT_CACHE];   // AUTO: path chosen per logical resolution
+    int present_cached;
+    struct gfx_batch_t* batch;            // state of the rects path, created on first use
+    int cell_zoom;                  // zoom the cell kernels below were selected for
+    gfx_cell_fill_fn cell_fill;
+    gfx_cell_test_fn cell_test;
 };
 
 extern void gfx_putpixel(struct gfx_context_t* ctxt, uint32_t column, uint32_t row, uint32_t color);
 extern uint32_t gfx_getpixel(struct gfx_context_t* ctxt, int x, int y);
 extern void gfx_clear(struct gfx_context_t* ctxt, uint32_t color);
 extern struct gfx_context_t* gfx_create(char* text, uint32_t width, uint32_t height);
+extern struct gfx_context_t* gfx_create_backend(char* text, uint32_t width, uint32_t height, enum gfx_backend backend);
 extern void gfx_destroy(struct gfx_context_t* ctxt);
+extern bool gfx_set_scale(struct gfx_context_t* ctxt, uint32_t scale);
 extern void gfx_present(struct gfx_context_t* ctxt);
+extern bool gfx_set_vsync(struct gfx_context_t* ctxt, bool enabled);
+extern void gfx_set_present_mode(struct gfx_context_t* ctxt, enum gfx_present_mode mode);
+extern void gfx_wait_event(struct gfx_context_t* ctxt, int timeout_ms);
+extern void gfx_set_key_source(gfx_key_source_fn source, void* data);
 extern SDL_Keycode gfx_keypressed();
+extern SDL_Keycode gfx_keypressed_at(uint64_t* event_ns);
 extern bool quit_signal();
 extern void wait_for_quit_signal();
 void draw_pixel(struct gfx_context_t* context, int x, int y, int zoom, uint32_t color);
-void draw_text_ttf(struct gfx_context_t* ctxt, const char* text, int x, int y, int size, SDL_Color color, const char* font_path);
+bool gfx_cell_is(struct gfx_context_t* ctxt, int x, int y, int zoom, uint32_t color);
+void draw_text(struct gfx_context_t* ctxt, const char* text, int x, int y, int size, uint32_t color);
 void draw_border(struct gfx_context_t* context, int x0, int x1, int y0, int y1, uint32_t color);
 #endif
@@ -0,0 +1,110 @@
+#include "latency.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* stage_names[LATENCY_STAGES] = { "queue", "tick", "render", "present", "total" };
+
+uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+struct latency_t* latency_create(void) {
+    struct latency_t* latency = calloc(1, sizeof(struct latency_t));
+    if (!latency) {
+        fprintf(stderr, "Failed to allocate memory for latency recorder");
+    }
+    return latency;
+}
+
+void latency_destroy(struct latency_t** latency) {
+    if (!latency || !*latency) {
+        return;
+    }
+    free(*latency);
+    *latency = NULL;
+}
+
+void latency_reset(struct latency_t* latency) {
+    latency->state = LATENCY_IDLE;
+    latency->keys = 0;
+    latency->coalesced = 0;
+    latency->count = 0;
+}
+
+void latency_key_read(struct latency_t* latency, uint64_t event_ns) {
+    latency->keys++;
+    if (latency->state != LATENCY_IDLE) {
+        latency->coalesced++;
+        return;
+    }
+    latency->read_ns = latency_now_ns();
+    // The event timestamp has a millisecond resolution
+    latency->event_ns = (event_ns < latency->read_ns) ? event_ns : latency->read_ns;
+    latency->state = LATENCY_READ;
+}
+
+void latency_move_applied(struct latency_t* latency) {
+    if (latency->state == LATENCY_READ) {
+        latency->applied_ns = latency_now_ns();
+        latency->state = LATENCY_APPLIED;
+    }
+}
+
+void latency_present_begin(struct latency_t* latency) {
+    latency->present_ns = latency_now_ns();
+}
+
+static uint32_t to_us(uint64_t from_ns, uint64_t to_ns) {
+    return (uint32_t)((to_ns - from_ns) / 1000u);
+}
+
+void latency_present_end(struct latency_t* latency) {
+    // A move applied during this present is shown by the next one
+    if (latency->state != LATENCY_APPLIED || latency->present_ns < latency->applied_ns) {
+        return;
+    }
+    uint64_t end_ns = latency_now_ns();
+    uint32_t slot = latency->count % LATENCY_MAX_SAMPLES;
+    latency->samples[LATENCY_QUEUE][slot] = to_us(latency->event_ns, latency->read_ns);
+    latency->samples[LATENCY_TICK][slot] = to_us(latency->read_ns, latency->applied_ns);
+    latency->samples[LATENCY_RENDER][slot] = to_us(latency->applied_ns, latency->present_ns);
+    latency->samples[LATENCY_PRESENT][slot] = to_us(latency->present_ns, end_ns);
+    latency->samples[LATENCY_TOTAL][slot] = to_us(latency->event_ns, end_ns);
+    latency->count++;
+    latency->state = LATENCY_IDLE;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+void latency_report(const struct latency_t* latency, FILE* stream) {
+    uint32_t count = (latency->count < LATENCY_MAX_SAMPLES) ? latency->count : LATENCY_MAX_SAMPLES;
+    fprintf(stream, "Input latency: %llu key(s), %u displayed, %llu coalesced\n",
+        (unsigned long long)latency->keys, latency->count, (unsigned long long)latency->coalesced);
+    if (count == 0) {
+        return;
+    }
+
+    uint32_t sorted[LATENCY_MAX_SAMPLES];
+    fprintf(stream, "  %-8s %9s %9s %9s %9s %9s  (ms)\n", "stage", "mean", "p50", "p90", "p99", "max");
+    for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+        memcpy(sorted, latency->samples[stage], count * sizeof(uint32_t));
+        qsort(sorted, count, sizeof(uint32_t), compare_u32);
+        double sum = 0.0;
+        for (uint32_t i = 0; i < count; i++) {
+            sum += sorted[i];
+        }
+        fprintf(stream, "  %-8s %9.2f %9.2f %9.2f %9.2f %9.2f\n", stage_names[stage],
+            sum / count / 1000.0,
+            sorted[count * 50 / 100] / 1000.0,
+            sorted[count * 90 / 100] / 1000.0,
+            sorted[count * 99 / 100] / 1000.0,
+            sorted[count - 1] / 1000.0);
+    }
+}
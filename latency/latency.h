@@ -0,0 +1,108 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Input-to-display latency of direction keys, split in stages:
+ *
+ *   queue    SDL event timestamp -> key read by the game loop
+ *   tick     key read            -> move tick that applied the direction
+ *   render   move applied        -> gfx_present call showing the new head
+ *   present  gfx_present call    -> gfx_present return
+ *
+ * One key is followed at a time; keys read while another one is in flight
+ * are counted as coalesced (they are shown by the same frame anyway).
+ */
+#define LATENCY_MAX_SAMPLES 4096   // per stage, the oldest are overwritten
+
+enum latency_stage {
+    LATENCY_QUEUE,
+    LATENCY_TICK,
+    LATENCY_RENDER,
+    LATENCY_PRESENT,
+    LATENCY_TOTAL,
+    LATENCY_STAGES
+};
+
+enum latency_state {
+    LATENCY_IDLE,       // no key in flight
+    LATENCY_READ,       // key read, waiting for the move tick
+    LATENCY_APPLIED,    // head moved, waiting for the next present
+};
+
+struct latency_t {
+    enum latency_state state;
+    uint64_t event_ns;          // times of the key in flight (CLOCK_MONOTONIC)
+    uint64_t read_ns;
+    uint64_t applied_ns;
+    uint64_t present_ns;
+    uint64_t keys;
+    uint64_t coalesced;
+    uint32_t count;             // samples recorded per stage
+    uint32_t samples[LATENCY_STAGES][LATENCY_MAX_SAMPLES];  // microseconds
+};
+
+/**
+ * Allocate an empty latency recorder.
+ *
+ * @return A pointer to the recorder, or NULL if allocation fails.
+ */
+struct latency_t* latency_create(void);
+
+/**
+ * Free a latency recorder.
+ *
+ * @param latency A pointer to the pointer of the recorder to free.
+ */
+void latency_destroy(struct latency_t** latency);
+
+/**
+ * Forget every sample (e.g. between two games).
+ *
+ * @param latency The recorder.
+ */
+void latency_reset(struct latency_t* latency);
+
+/**
+ * A direction key was read by the game loop.
+ *
+ * @param latency The recorder.
+ * @param event_ns Time the key event was queued (CLOCK_MONOTONIC, see gfx_keypressed_at).
+ */
+void latency_key_read(struct latency_t* latency, uint64_t event_ns);
+
+/**
+ * The move tick applied the current direction.
+ *
+ * @param latency The recorder.
+ */
+void latency_move_applied(struct latency_t* latency);
+
+/**
+ * Mark the start of gfx_present.
+ *
+ * @param latency The recorder.
+ */
+void latency_present_begin(struct latency_t* latency);
+
+/**
+ * Mark the end of gfx_present; completes the sample of a displayed key.
+ *
+ * @param latency The recorder.
+ */
+void latency_present_end(struct latency_t* latency);
+
+/**
+ * Print the distribution (mean and percentiles) of each stage.
+ *
+ * @param latency The recorder.
+ * @param stream Output stream.
+ */
+void latency_report(const struct latency_t* latency, FILE* stream);
+
+uint64_t latency_now_ns(void);
+
+#endif
@@ -0,0 +1,303 @@
+#include "leaderboard.h"
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RECORD_MAGIC 0x52434e53u  // "SNCR"
+#define INDEX_MAGIC 0x58494e53u   // "SNIX"
+#define INDEX_VERSION 1
+#define SCAN_BATCH 256            // records read per pread while scanning the log
+
+struct index_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t crc;          // CRC32 of the records array
+    uint64_t log_offset;   // log bytes covered by this index
+};
+
+/**
+ * CRC32 (IEEE 802.3, reflected), bitwise: records are only a few bytes long.
+ */
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t record_crc(const struct score_record* record) {
+    struct score_record copy = *record;
+    copy.crc = 0;
+    return crc32_update(0, &copy, sizeof(copy));
+}
+
+static bool record_valid(const struct score_record* record) {
+    return record->magic == RECORD_MAGIC && record->crc == record_crc(record);
+}
+
+/**
+ * Insert a record in the sorted top list; equal scores keep their log order.
+ */
+static void top_insert(struct leaderboard_t* board, const struct score_record* record) {
+    int position = board->count;
+    while (position > 0 && board->top[position - 1].score < record->score) {
+        position--;
+    }
+    if (position >= LEADERBOARD_CAPACITY) {
+        return;
+    }
+    int moved = ((board->count < LEADERBOARD_CAPACITY) ? board->count : LEADERBOARD_CAPACITY - 1) - position;
+    memmove(&board->top[position + 1], &board->top[position], moved * sizeof(struct score_record));
+    board->top[position] = *record;
+    if (board->count < LEADERBOARD_CAPACITY) {
+        board->count++;
+    }
+}
+
+/**
+ * Load the index file. On any inconsistency the index is ignored and the
+ * whole log will be scanned instead.
+ */
+static void load_index(struct leaderboard_t* board) {
+    board->count = 0;
+    board->index_offset = 0;
+
+    FILE* file = fopen(board->index_path, "rb");
+    if (!file) {
+        return;
+    }
+    struct index_header header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == INDEX_MAGIC && header.version == INDEX_VERSION
+        && header.count <= LEADERBOARD_CAPACITY
+        && fread(board->top, sizeof(struct score_record), header.count, file) == header.count
+        && crc32_update(0, board->top, header.count * sizeof(struct score_record)) == header.crc;
+    fclose(file);
+
+    if (ok) {
+        board->count = header.count;
+        board->index_offset = header.log_offset;
+    }
+}
+
+/**
+ * Read the log records after the index offset. Invalid records are skipped;
+ * log_end is set after the last valid one, so a torn tail gets truncated.
+ */
+static bool scan_log(struct leaderboard_t* board, uint64_t size) {
+    struct score_record batch[SCAN_BATCH];
+    uint64_t offset = board->index_offset;
+    board->log_end = offset;
+
+    while (offset + sizeof(struct score_record) <= size) {
+        ssize_t bytes = pread(board->log_fd, batch, sizeof(batch), offset);
+        if (bytes < (ssize_t)sizeof(struct score_record)) {
+            return bytes >= 0;
+        }
+        size_t records = bytes / sizeof(struct score_record);
+        for (size_t i = 0; i < records; i++) {
+            offset += sizeof(struct score_record);
+            if (record_valid(&batch[i])) {
+                top_insert(board, &batch[i]);
+                board->log_end = offset;
+            }
+        }
+    }
+    return true;
+}
+
+static char* concat(const char* prefix, const char* suffix) {
+    char* path = malloc(strlen(prefix) + strlen(suffix) + 1);
+    if (path) {
+        strcpy(path, prefix);
+        strcat(path, suffix);
+    }
+    return path;
+}
+
+static void leaderboard_free(struct leaderboard_t* board) {
+    if (board->log_fd >= 0) {
+        close(board->log_fd);
+    }
+    free(board->log_path);
+    free(board->index_path);
+    free(board);
+}
+
+static bool needs_compaction(const struct leaderboard_t* board) {
+    return (board->log_end - board->index_offset) / sizeof(struct score_record) >= LEADERBOARD_COMPACT_EVERY;
+}
+
+struct leaderboard_t* leaderboard_open(const char* prefix) {
+    struct leaderboard_t* board = calloc(1, sizeof(struct leaderboard_t));
+    if (!board) {
+        fprintf(stderr, "Failed to allocate memory for leaderboard");
+        return NULL;
+    }
+    board->log_fd = -1;
+    board->log_path = concat(prefix, ".log");
+    board->index_path = concat(prefix, ".idx");
+    if (!board->log_path || !board->index_path) {
+        leaderboard_free(board);
+        return NULL;
+    }
+
+    board->log_fd = open(board->log_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    if (board->log_fd < 0 || fstat(board->log_fd, &st) != 0) {
+        fprintf(stderr, "Failed to open leaderboard: %s\n", board->log_path);
+        leaderboard_free(board);
+        return NULL;
+    }
+
+    load_index(board);
+    if (board->index_offset > (uint64_t)st.st_size || board->index_offset % sizeof(struct score_record) != 0) {
+        // Index from another log: rebuild it from scratch
+        board->count = 0;
+        board->index_offset = 0;
+    }
+    if (!scan_log(board, st.st_size)) {
+        fprintf(stderr, "Failed to read leaderboard: %s\n", board->log_path);
+        leaderboard_free(board);
+        return NULL;
+    }
+
+    if (needs_compaction(board)) {
+        leaderboard_compact(board);
+    }
+    return board;
+}
+
+bool leaderboard_add(struct leaderboard_t* board, const struct score_entry* entry) {
+    struct score_record record = {
+        .magic = RECORD_MAGIC,
+        .score = entry->score,
+        .length = entry->length,
+        .difficulty = entry->difficulty,
+        .duration_ms = entry->duration_ms,
+        .seed = entry->seed,
+    };
+    record.crc = record_crc(&record);
+
+    // Cut off a torn record left by a crash, so the new one starts on a record boundary
+    struct stat st;
+    if (fstat(board->log_fd, &st) != 0) {
+        return false;
+    }
+    if ((uint64_t)st.st_size != board->log_end && ftruncate(board->log_fd, board->log_end) != 0) {
+        return false;
+    }
+
+    if (write(board->log_fd, &record, sizeof(record)) != (ssize_t)sizeof(record)) {
+        // Leave the log as it was before the append
+        if (ftruncate(board->log_fd, board->log_end) != 0) {
+            fprintf(stderr, "Failed to restore leaderboard: %s\n", board->log_path);
+        }
+        return false;
+    }
+    board->log_end += sizeof(record);
+    top_insert(board, &record);
+
+    if (++board->unsynced >= LEADERBOARD_FSYNC_BATCH) {
+        fsync(board->log_fd);
+        board->unsynced = 0;
+    }
+    if (needs_compaction(board)) {
+        leaderboard_compact(board);
+    }
+    return true;
+}
+
+int leaderboard_top(const struct leaderboard_t* board, struct score_entry* out, int n) {
+    int count = (n < board->count) ? n : board->count;
+    for (int i = 0; i < count; i++) {
+        out[i] = (struct score_entry){
+            .score = board->top[i].score,
+            .length = board->top[i].length,
+            .difficulty = board->top[i].difficulty,
+            .duration_ms = board->top[i].duration_ms,
+            .seed = board->top[i].seed,
+        };
+    }
+    return count;
+}
+
+/**
+ * fsync the directory holding a file, so a rename into it is durable.
+ */
+static void sync_parent_directory(const char* path) {
+    char* copy = strdup(path);
+    if (!copy) {
+        return;
+    }
+    int fd = open(dirname(copy), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(copy);
+}
+
+bool leaderboard_compact(struct leaderboard_t* board) {
+    // The index must never cover records that could still be lost
+    if (fsync(board->log_fd) != 0) {
+        return false;
+    }
+    board->unsynced = 0;
+
+    char* tmp_path = concat(board->index_path, ".tmp");
+    if (!tmp_path) {
+        return false;
+    }
+    struct index_header header = {
+        .magic = INDEX_MAGIC,
+        .version = INDEX_VERSION,
+        .count = board->count,
+        .crc = crc32_update(0, board->top, board->count * sizeof(struct score_record)),
+        .log_offset = board->log_end,
+    };
+
+    FILE* file = fopen(tmp_path, "wb");
+    bool ok = file
+        && fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(board->top, sizeof(struct score_record), board->count, file) == (size_t)board->count
+        && fflush(file) == 0
+        && fsync(fileno(file)) == 0;
+    if (file) {
+        ok = (fclose(file) == 0) && ok;
+    }
+    ok = ok && rename(tmp_path, board->index_path) == 0;
+    if (ok) {
+        sync_parent_directory(board->index_path);
+        board->index_offset = board->log_end;
+    } else {
+        unlink(tmp_path);
+        fprintf(stderr, "Failed to write leaderboard index: %s\n", board->index_path);
+    }
+    free(tmp_path);
+    return ok;
+}
+
+void leaderboard_close(struct leaderboard_t** board) {
+    if (!board || !*board) {
+        return;
+    }
+    if ((*board)->log_end != (*board)->index_offset) {
+        leaderboard_compact(*board);
+    } else if ((*board)->unsynced > 0) {
+        fsync((*board)->log_fd);
+    }
+    leaderboard_free(*board);
+    *board = NULL;
+}
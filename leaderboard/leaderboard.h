@@ -0,0 +1,95 @@
+#ifndef _LEADERBOARD_H_
+#define _LEADERBOARD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Local leaderboard stored in two files:
+ *
+ *   <prefix>.log  append-only log of fixed-size records, each with its own
+ *                 CRC32. A torn final write is detected and cut off before
+ *                 the next append; earlier records are never rewritten.
+ *   <prefix>.idx  compacted index: the best records sorted by score, and the
+ *                 log offset it covers. It is replaced atomically (rename),
+ *                 so opening only reads the index and the short log tail.
+ */
+#define LEADERBOARD_CAPACITY 100       // records kept in the index
+#define LEADERBOARD_FSYNC_BATCH 8      // appends between two fsync
+#define LEADERBOARD_COMPACT_EVERY 64   // log records not covered by the index before compaction
+
+struct score_entry {
+    uint32_t score;
+    uint32_t length;
+    uint32_t difficulty;
+    uint32_t duration_ms;
+    uint64_t seed;
+};
+
+/**
+ * On-disk record (32 bytes). The CRC covers the whole record with crc = 0.
+ */
+struct score_record {
+    uint32_t magic;
+    uint32_t score;
+    uint32_t length;
+    uint32_t difficulty;
+    uint32_t duration_ms;
+    uint32_t crc;
+    uint64_t seed;
+};
+
+struct leaderboard_t {
+    char* log_path;
+    char* index_path;
+    int log_fd;
+    uint64_t log_end;          // offset after the last valid record
+    uint64_t index_offset;     // log offset covered by the index file
+    int unsynced;              // appends since the last fsync
+    int count;
+    struct score_record top[LEADERBOARD_CAPACITY];  // sorted by decreasing score
+};
+
+/**
+ * Open (or create) a leaderboard: load the index, then the log records it does not cover.
+ *
+ * @param prefix Path prefix of the .log and .idx files.
+ * @return A pointer to the leaderboard, or NULL on failure.
+ */
+struct leaderboard_t* leaderboard_open(const char* prefix);
+
+/**
+ * Append a game result to the log and insert it in the top list.
+ *
+ * @param board The leaderboard.
+ * @param entry The game result.
+ * @return true if the record was written, false otherwise.
+ */
+bool leaderboard_add(struct leaderboard_t* board, const struct score_entry* entry);
+
+/**
+ * Copy the best results, highest score first.
+ *
+ * @param board The leaderboard.
+ * @param out Array receiving at most n entries.
+ * @param n Maximum number of entries to copy.
+ * @return The number of entries copied.
+ */
+int leaderboard_top(const struct leaderboard_t* board, struct score_entry* out, int n);
+
+/**
+ * Flush the log to disk and rewrite the index so it covers the whole log.
+ *
+ * @param board The leaderboard.
+ * @return true on success, false otherwise.
+ */
+bool leaderboard_compact(struct leaderboard_t* board);
+
+/**
+ * Compact the leaderboard if needed, close its files and free it.
+ *
+ * @param board A pointer to the pointer of the leaderboard to close.
+ */
+void leaderboard_close(struct leaderboard_t** board);
+
+#endif
@@ -0,0 +1,324 @@
+#include "level.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PORTAL_LETTERS 26
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Check that an array of size bytes at offset lies inside the mapping,
+ * without overflowing on a crafted offset.
+ */
+static bool level_range_valid(uint64_t offset, uint64_t size, size_t map_size) {
+    return offset <= map_size && size <= map_size - offset;
+}
+
+/**
+ * Check that the header describes arrays lying inside the mapping.
+ */
+static bool level_header_valid(const struct level_header* header, size_t map_size) {
+    if (header->magic != LEVEL_MAGIC || header->version != LEVEL_VERSION
+        || header->header_size != sizeof(struct level_header)) {
+        return false;
+    }
+    uint64_t cells_size = (uint64_t)header->width * header->height;
+    uint64_t spawns_size = (uint64_t)header->spawn_count * sizeof(struct level_point);
+    uint64_t portals_size = (uint64_t)header->portal_count * sizeof(struct level_portal);
+    return header->width > 0 && header->height > 0
+        && header->width <= INT32_MAX && header->height <= INT32_MAX
+        && header->cells_offset % LEVEL_ALIGN == 0
+        && level_range_valid(header->cells_offset, cells_size, map_size)
+        && header->spawns_offset % sizeof(uint32_t) == 0
+        && level_range_valid(header->spawns_offset, spawns_size, map_size)
+        && header->portals_offset % sizeof(uint32_t) == 0
+        && level_range_valid(header->portals_offset, portals_size, map_size);
+}
+
+static bool level_point_valid(const struct level_header* header, const struct level_point* point) {
+    return point->x < header->width && point->y < header->height;
+}
+
+/**
+ * Check that the LEVEL_SPAWN_BODY cells above a spawn point, where the body
+ * of the snake is placed, are neither walls nor portals.
+ */
+static bool level_spawn_body_free(const uint8_t* cells, uint32_t width, struct level_point spawn) {
+    if (spawn.y < LEVEL_SPAWN_BODY) {
+        return false;
+    }
+    for (uint32_t i = 1; i <= LEVEL_SPAWN_BODY; i++) {
+        uint8_t cell = cells[(size_t)(spawn.y - i) * width + spawn.x];
+        if (cell != LEVEL_EMPTY && cell != LEVEL_SPAWN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check that the spawn points and both ends of every portal are map cells:
+ * the game turns them into pixel positions.
+ */
+static bool level_points_valid(const struct level_t* level) {
+    const struct level_header* header = level->header;
+    for (uint32_t i = 0; i < header->spawn_count; i++) {
+        if (!level_point_valid(header, &level->spawns[i])
+            || !level_spawn_body_free(level->cells, header->width, level->spawns[i])) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->portal_count; i++) {
+        if (!level_point_valid(header, &level->portals[i].a) || !level_point_valid(header, &level->portals[i].b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct level_t* level_load(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open level: %s\n", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct level_header)) {
+        fprintf(stderr, "Invalid level file: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    // The mapping stays valid after close(); pages are loaded lazily on first access
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map level: %s\n", path);
+        return NULL;
+    }
+
+    const struct level_header* header = map;
+    if (!level_header_valid(header, st.st_size)) {
+        fprintf(stderr, "Invalid level file: %s\n", path);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    struct level_t* level = malloc(sizeof(struct level_t));
+    if (!level) {
+        fprintf(stderr, "Failed to allocate memory for level");
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    level->header = header;
+    level->cells = (const uint8_t*)map + header->cells_offset;
+    level->spawns = (const struct level_point*)((const uint8_t*)map + header->spawns_offset);
+    level->portals = (const struct level_portal*)((const uint8_t*)map + header->portals_offset);
+    level->map = map;
+    level->map_size = st.st_size;
+    if (!level_points_valid(level)) {
+        fprintf(stderr, "Invalid level file: %s\n", path);
+        level_unload(&level);
+        return NULL;
+    }
+    return level;
+}
+
+void level_unload(struct level_t** level) {
+    if (!level || !*level) {
+        return;
+    }
+    munmap((*level)->map, (*level)->map_size);
+    free(*level);
+    *level = NULL;
+}
+
+bool level_portal_exit(const struct level_t* level, int x, int y, struct level_point* exit) {
+    for (uint32_t i = 0; i < level->header->portal_count; i++) {
+        const struct level_portal* portal = &level->portals[i];
+        if (portal->a.x == (uint32_t)x && portal->a.y == (uint32_t)y) {
+            *exit = portal->b;
+            return true;
+        }
+        if (portal->b.x == (uint32_t)x && portal->b.y == (uint32_t)y) {
+            *exit = portal->a;
+            return true;
+        }
+    }
+    return false;
+}
+
+int draw_level(struct gfx_context_t* ctxt, const struct level_t* level, int x_origin, int y_origin,
+    int columns, int rows, int zoom, uint32_t wall_color, uint32_t portal_color) {
+    const int width = ((int)level->header->width < columns) ? (int)level->header->width : columns;
+    const int height = ((int)level->header->height < rows) ? (int)level->header->height : rows;
+
+    int blocked = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = level->cells + (size_t)y * level->header->width;
+        for (int x = 0; x < width; x++) {
+            if (row[x] == LEVEL_WALL) {
+                draw_pixel(ctxt, x_origin + x * zoom, y_origin + y * zoom, zoom, wall_color);
+                blocked++;
+            } else if (row[x] == LEVEL_PORTAL) {
+                draw_pixel(ctxt, x_origin + x * zoom, y_origin + y * zoom, zoom, portal_color);
+                blocked++;
+            }
+        }
+    }
+    return blocked;
+}
+
+/**
+ * Read a whole text file into a NUL-terminated buffer.
+ */
+static char* read_text_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (size >= 0) ? malloc(size + 1) : NULL;
+    if (text) {
+        size_t read = fread(text, 1, size, file);
+        text[read] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+bool level_compile_text(const char* text_path, const char* map_path) {
+    char* text = read_text_file(text_path);
+    if (!text) {
+        fprintf(stderr, "Failed to read text map: %s\n", text_path);
+        return false;
+    }
+
+    // First pass: dimensions and number of spawn points
+    uint32_t width = 0, height = 0, line_length = 0, spawn_total = 0;
+    for (const char* c = text; *c; c++) {
+        if (*c == 'S') {
+            spawn_total++;
+        }
+        if (*c == '\n') {
+            height++;
+            line_length = 0;
+        } else if (*c != '\r' && ++line_length > width) {
+            width = line_length;
+        }
+    }
+    if (line_length > 0) {
+        height++;
+    }
+
+    uint8_t* cells = (width && height) ? calloc((size_t)width * height, 1) : NULL;
+    struct level_point* spawns = malloc((spawn_total + 1) * sizeof(struct level_point));
+    struct level_point letters[PORTAL_LETTERS][2];
+    int letter_count[PORTAL_LETTERS] = { 0 };
+    uint32_t spawn_count = 0;
+    bool ok = cells && spawns;
+    if (!ok) {
+        fprintf(stderr, "Empty or too large text map: %s\n", text_path);
+    }
+
+    // Second pass: cells, spawn points and portal ends
+    uint32_t x = 0, y = 0;
+    for (const char* c = text; ok && *c; c++) {
+        if (*c == '\n') {
+            y++;
+            x = 0;
+            continue;
+        }
+        if (*c == '\r') {
+            continue;
+        }
+        uint8_t* cell = &cells[(size_t)y * width + x];
+        if (*c == '#') {
+            *cell = LEVEL_WALL;
+        } else if (*c == 'S') {
+            *cell = LEVEL_SPAWN;
+            spawns[spawn_count++] = (struct level_point){ x, y };
+        } else if (*c >= 'a' && *c <= 'z') {
+            int letter = *c - 'a';
+            if (letter_count[letter] == 2) {
+                fprintf(stderr, "%s:%u: portal '%c' used more than twice\n", text_path, y + 1, *c);
+                ok = false;
+            } else {
+                letters[letter][letter_count[letter]++] = (struct level_point){ x, y };
+                *cell = LEVEL_PORTAL;
+            }
+        } else if (*c != '.' && *c != ' ') {
+            fprintf(stderr, "%s:%u: unknown map character '%c'\n", text_path, y + 1, *c);
+            ok = false;
+        }
+        x++;
+    }
+
+    for (uint32_t i = 0; ok && i < spawn_count; i++) {
+        if (!level_spawn_body_free(cells, width, spawns[i])) {
+            fprintf(stderr, "%s:%u: spawn point needs %d free cells above it\n",
+                text_path, spawns[i].y + 1, LEVEL_SPAWN_BODY);
+            ok = false;
+        }
+    }
+
+    struct level_portal portals[PORTAL_LETTERS];
+    uint32_t portal_count = 0;
+    for (int letter = 0; ok && letter < PORTAL_LETTERS; letter++) {
+        if (letter_count[letter] == 1) {
+            fprintf(stderr, "%s: portal '%c' has no exit\n", text_path, 'a' + letter);
+            ok = false;
+        } else if (letter_count[letter] == 2) {
+            portals[portal_count++] = (struct level_portal){ letters[letter][0], letters[letter][1] };
+        }
+    }
+
+    FILE* file = ok ? fopen(map_path, "wb") : NULL;
+    if (ok && !file) {
+        fprintf(stderr, "Failed to create map: %s\n", map_path);
+        ok = false;
+    }
+    if (ok) {
+        struct level_header header = {
+            .magic = LEVEL_MAGIC,
+            .version = LEVEL_VERSION,
+            .header_size = sizeof(struct level_header),
+            .width = width,
+            .height = height,
+            .spawn_count = spawn_count,
+            .portal_count = portal_count,
+        };
+        header.cells_offset = align_up(sizeof(header), LEVEL_ALIGN);
+        header.spawns_offset = align_up(header.cells_offset + (uint64_t)width * height, sizeof(uint32_t));
+        header.portals_offset = header.spawns_offset + spawn_count * sizeof(struct level_point);
+
+        static const uint8_t padding[LEVEL_ALIGN] = { 0 };
+        ok = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(padding, 1, header.cells_offset - sizeof(header), file) == header.cells_offset - sizeof(header)
+            && fwrite(cells, 1, (size_t)width * height, file) == (size_t)width * height
+            && fwrite(padding, 1, header.spawns_offset - header.cells_offset - (uint64_t)width * height, file)
+                == header.spawns_offset - header.cells_offset - (uint64_t)width * height
+            && fwrite(spawns, sizeof(struct level_point), spawn_count, file) == spawn_count
+            && fwrite(portals, sizeof(struct level_portal), portal_count, file) == portal_count;
+        ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            fprintf(stderr, "Failed to write map: %s\n", map_path);
+        }
+    }
+
+    free(cells);
+    free(spawns);
+    free(text);
+    return ok;
+}
@@ -0,0 +1,145 @@
+#ifndef _LEVEL_H_
+#define _LEVEL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../gfx/gfx.h"
+
+/*
+ * Binary map format (native little-endian), designed to be used in place
+ * after mmap, without any parsing step:
+ *
+ *   struct level_header                     at offset 0
+ *   uint8_t cells[height][width]            at cells_offset (64-byte aligned)
+ *   struct level_point spawns[spawn_count]  at spawns_offset
+ *   struct level_portal portals[...]        at portals_offset
+ *
+ * The cells array is the occupancy grid itself: one enum level_cell per cell,
+ * row-major, so a cell lookup is cells[y * width + x].
+ */
+#define LEVEL_MAGIC 0x4d4b4e53u  // "SNKM"
+#define LEVEL_VERSION 1
+#define LEVEL_ALIGN 64
+#define LEVEL_SPAWN_BODY 2   // free cells above a spawn point, for the body of the snake
+
+enum level_cell {
+    LEVEL_EMPTY = 0,
+    LEVEL_WALL = 1,
+    LEVEL_PORTAL = 2,
+    LEVEL_SPAWN = 3
+};
+
+struct level_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t spawn_count;
+    uint32_t portal_count;
+    uint64_t cells_offset;
+    uint64_t spawns_offset;
+    uint64_t portals_offset;
+};
+
+struct level_point {
+    uint32_t x, y;
+};
+
+/**
+ * Pair of linked portal cells: entering one exits from the other.
+ */
+struct level_portal {
+    struct level_point a, b;
+};
+
+/**
+ * A loaded (memory-mapped, read-only) level. Every pointer points into the
+ * mapping, so a level can be shared by any number of threads or processes.
+ */
+struct level_t {
+    const struct level_header* header;
+    const uint8_t* cells;
+    const struct level_point* spawns;
+    const struct level_portal* portals;
+    void* map;
+    size_t map_size;
+};
+
+/**
+ * Map a binary level file into memory and validate its header.
+ *
+ * @param path Path of the binary map file.
+ * @return A pointer to the level, or NULL if the file is missing or invalid.
+ */
+struct level_t* level_load(const char* path);
+
+/**
+ * Unmap a level and free its descriptor.
+ *
+ * @param level A pointer to the pointer of the level to unload.
+ */
+void level_unload(struct level_t** level);
+
+/**
+ * Compile a text map into the binary map format.
+ *
+ * Text form, one line per row: '#' wall, '.' or ' ' empty, 'S' spawn point,
+ * and a lowercase letter for a portal (each letter must appear exactly twice).
+ * The snake spawns heading down, its body on the LEVEL_SPAWN_BODY cells above
+ * the spawn point, which must be neither walls nor portals.
+ *
+ * @param text_path Path of the text map.
+ * @param map_path Path of the binary map to write.
+ * @return true on success, false on error (message on stderr).
+ */
+bool level_compile_text(const char* text_path, const char* map_path);
+
+/**
+ * Get a cell of the level, cells outside the map being empty.
+ *
+ * @param level The level.
+ * @param x Column of the cell.
+ * @param y Row of the cell.
+ * @return The cell type.
+ */
+static inline enum level_cell level_cell_at(const struct level_t* level, int x, int y) {
+    if (x < 0 || y < 0 || (uint32_t)x >= level->header->width || (uint32_t)y >= level->header->height) {
+        return LEVEL_EMPTY;
+    }
+    return (enum level_cell)level->cells[(size_t)y * level->header->width + x];
+}
+
+/**
+ * Find the other end of the portal at the given cell.
+ *
+ * @param level The level.
+ * @param x Column of the portal cell.
+ * @param y Row of the portal cell.
+ * @param exit Receives the linked portal cell.
+ * @return true if (x, y) is a portal, false otherwise.
+ */
+bool level_portal_exit(const struct level_t* level, int x, int y, struct level_point* exit);
+
+/**
+ * Draw the obstacles and portals of a level on the board.
+ * Map cell (0, 0) is drawn at (x_origin, y_origin); cells outside the
+ * columns x rows board area are skipped.
+ *
+ * @param ctxt The graphics context.
+ * @param level The level to draw.
+ * @param x_origin X coordinate (pixels) of the first board cell.
+ * @param y_origin Y coordinate (pixels) of the first board cell.
+ * @param columns Number of board columns.
+ * @param rows Number of board rows.
+ * @param zoom The size of a cell.
+ * @param wall_color Color of the obstacles.
+ * @param portal_color Color of the portals.
+ * @return The number of board cells blocked by walls and portals.
+ */
+int draw_level(struct gfx_context_t* ctxt, const struct level_t* level, int x_origin, int y_origin,
+    int columns, int rows, int zoom, uint32_t wall_color, uint32_t portal_color);
+
+#endif
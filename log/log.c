@@ -0,0 +1,312 @@
+#include "log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define LOG_LINE_MAX 512        // longer lines are truncated
+#define LOG_BATCH_BYTES 16384   // formatted bytes written at once
+
+struct log_record {
+    enum log_level level;
+    int count;
+    const char* format;
+    uint64_t time_ns;
+    struct log_arg args[LOG_MAX_ARGS];
+};
+
+/**
+ * Bounded MPMC ring slot (Vyukov): the sequence tells whether the slot is
+ * free for the producer of position p (sequence == p) or holds the record
+ * of position p for the consumer (sequence == p + 1).
+ */
+struct log_slot {
+    _Atomic uint64_t sequence;
+    struct log_record record;
+};
+
+int log_level = LOG_LEVEL_INFO;
+
+static const char* level_names[] = { "debug", "info", "warn", "error" };
+
+static struct log_slot slots[LOG_RING_RECORDS];
+static _Atomic uint64_t enqueue_position = 0;
+static uint64_t dequeue_position = 0;   // guarded by consumer_lock
+static pthread_mutex_t consumer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static FILE* output = NULL;
+static uint64_t start_ns = 0;
+static pthread_t writer;
+static atomic_bool running = false;
+static atomic_bool stopping = false;
+static _Atomic uint64_t written_count = 0;
+static _Atomic uint64_t dropped_count = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool ring_push(const struct log_record* record) {
+    uint64_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+    struct log_slot* slot;
+    for (;;) {
+        slot = &slots[position & (LOG_RING_RECORDS - 1)];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t difference = (int64_t)(sequence - position);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1,
+                memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;   // full
+        } else {
+            position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+        }
+    }
+    slot->record = *record;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Pop the oldest record. The caller holds consumer_lock.
+ */
+static bool ring_pop(struct log_record* record) {
+    struct log_slot* slot = &slots[dequeue_position & (LOG_RING_RECORDS - 1)];
+    uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != dequeue_position + 1) {
+        return false;
+    }
+    *record = slot->record;
+    atomic_store_explicit(&slot->sequence, dequeue_position + LOG_RING_RECORDS, memory_order_release);
+    dequeue_position++;
+    return true;
+}
+
+/**
+ * Format one conversion with its stored argument, rebuilding the
+ * conversion with the length modifier of the argument type.
+ */
+static int format_arg(char* out, size_t size, const char* flags, size_t flags_length, char conversion,
+    const struct log_arg* arg) {
+    char spec[32];
+    if (flags_length > sizeof(spec) - 4) {
+        flags_length = sizeof(spec) - 4;
+    }
+    spec[0] = '%';
+    memcpy(spec + 1, flags, flags_length);
+    char* end = spec + 1 + flags_length;
+
+    switch (conversion) {
+    case 'd':
+    case 'i':
+        memcpy(end, "lld", 4);
+        return snprintf(out, size, spec, (long long)(arg->type == LOG_ARG_UINT ? (int64_t)arg->value.u : arg->value.i));
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        end[0] = 'l';
+        end[1] = 'l';
+        end[2] = conversion;
+        end[3] = '\0';
+        return snprintf(out, size, spec, (unsigned long long)arg->value.u);
+    case 'c':
+        memcpy(end, "c", 2);
+        return snprintf(out, size, spec, (int)arg->value.i);
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        end[0] = conversion;
+        end[1] = '\0';
+        return snprintf(out, size, spec, arg->type == LOG_ARG_DOUBLE ? arg->value.f : (double)arg->value.i);
+    case 's':
+        memcpy(end, "s", 2);
+        return snprintf(out, size, spec, (arg->type == LOG_ARG_STRING && arg->value.s) ? arg->value.s : "(?)");
+    case 'p':
+        memcpy(end, "p", 2);
+        return snprintf(out, size, spec, arg->value.p);
+    default:
+        return snprintf(out, size, "%%%c", conversion);
+    }
+}
+
+/**
+ * Format a record as one line: time since log_init, level and message.
+ *
+ * @return The length of the line, newline included.
+ */
+static size_t format_record(const struct log_record* record, char* line, size_t size) {
+    size_t length = (size_t)snprintf(line, size, "%10.3f %-5s ",
+        (record->time_ns - start_ns) / 1.0e9, level_names[record->level]);
+    int next = 0;
+    for (const char* c = record->format; *c && length < size - 1; c++) {
+        if (*c != '%') {
+            line[length++] = *c;
+            continue;
+        }
+        if (c[1] == '%') {
+            line[length++] = '%';
+            c++;
+            continue;
+        }
+        const char* flags = ++c;
+        c += strspn(c, "-+ #0123456789.");
+        size_t flags_length = (size_t)(c - flags);
+        c += strspn(c, "hlLqjzt");
+        if (!*c) {
+            break;
+        }
+        if (next >= record->count) {
+            continue;   // missing argument
+        }
+        int written = format_arg(line + length, size - length, flags, flags_length, *c, &record->args[next++]);
+        if (written > 0) {
+            length += (size_t)written;
+        }
+    }
+    if (length > size - 2) {
+        length = size - 2;
+    }
+    line[length++] = '\n';
+    line[length] = '\0';
+    return length;
+}
+
+/**
+ * Write the pending records in batches. The caller holds consumer_lock.
+ */
+static void drain(void) {
+    char batch[LOG_BATCH_BYTES];
+    size_t used = 0;
+    struct log_record record;
+    uint64_t count = 0;
+    while (ring_pop(&record)) {
+        if (used + LOG_LINE_MAX > sizeof(batch)) {
+            fwrite(batch, 1, used, output);
+            used = 0;
+        }
+        used += format_record(&record, batch + used, LOG_LINE_MAX);
+        count++;
+    }
+    if (used > 0) {
+        fwrite(batch, 1, used, output);
+    }
+    if (count > 0) {
+        fflush(output);
+        atomic_fetch_add_explicit(&written_count, count, memory_order_relaxed);
+    }
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    const struct timespec period = { 0, LOG_FLUSH_MS * 1000000L };
+    while (!atomic_load(&stopping)) {
+        nanosleep(&period, NULL);
+        pthread_mutex_lock(&consumer_lock);
+        drain();
+        pthread_mutex_unlock(&consumer_lock);
+    }
+    return NULL;
+}
+
+static void read_level(void) {
+    const char* name = getenv("SNAKE_LOG_LEVEL");
+    if (!name || !*name) {
+        return;
+    }
+    for (int level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; level++) {
+        if (strcasecmp(name, level_names[level]) == 0) {
+            log_level = level;
+            return;
+        }
+    }
+    fprintf(stderr, "Unknown SNAKE_LOG_LEVEL '%s', using info\n", name);
+}
+
+bool log_init(FILE* stream) {
+    if (atomic_load(&running)) {
+        return true;
+    }
+    for (uint64_t i = 0; i < LOG_RING_RECORDS; i++) {
+        atomic_init(&slots[i].sequence, i);
+    }
+    atomic_store(&enqueue_position, 0);
+    dequeue_position = 0;
+    output = stream;
+    start_ns = now_ns();
+    read_level();
+    atomic_store(&stopping, false);
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start the log writer, logging synchronously\n");
+        return false;
+    }
+    atomic_store(&running, true);
+    return true;
+}
+
+void log_write(enum log_level level, const char* format, int count, const struct log_arg* args) {
+    struct log_record record = { level, count < LOG_MAX_ARGS ? count : LOG_MAX_ARGS, format, now_ns(), { { 0 } } };
+    memcpy(record.args, args, (size_t)record.count * sizeof(struct log_arg));
+    if (atomic_load_explicit(&running, memory_order_acquire)) {
+        if (!ring_push(&record)) {
+            atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        }
+        return;
+    }
+
+    // No writer: format in place
+    char line[LOG_LINE_MAX];
+    if (!output) {
+        output = stdout;
+        start_ns = record.time_ns;
+    }
+    size_t length = format_record(&record, line, sizeof(line));
+    pthread_mutex_lock(&consumer_lock);
+    fwrite(line, 1, length, output);
+    fflush(output);
+    pthread_mutex_unlock(&consumer_lock);
+    atomic_fetch_add_explicit(&written_count, 1, memory_order_relaxed);
+}
+
+void log_flush(void) {
+    if (!atomic_load(&running)) {
+        return;
+    }
+    pthread_mutex_lock(&consumer_lock);
+    drain();
+    pthread_mutex_unlock(&consumer_lock);
+}
+
+void log_shutdown(void) {
+    if (!atomic_load(&running)) {
+        return;
+    }
+    atomic_store(&stopping, true);
+    pthread_join(writer, NULL);
+    atomic_store_explicit(&running, false, memory_order_release);
+    pthread_mutex_lock(&consumer_lock);
+    drain();
+    pthread_mutex_unlock(&consumer_lock);
+
+    uint64_t dropped = atomic_load(&dropped_count);
+    if (dropped > 0) {
+        fprintf(output, "Log: %llu record(s) dropped (ring full)\n", (unsigned long long)dropped);
+    }
+}
+
+void log_get_stats(struct log_stats* stats) {
+    stats->written = atomic_load(&written_count);
+    stats->dropped = atomic_load(&dropped_count);
+}
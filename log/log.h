@@ -0,0 +1,164 @@
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Leveled asynchronous logger.
+ *
+ * A log call stores its format string (a string literal) and its raw
+ * arguments in a fixed-size record, pushed into a lock-free bounded ring
+ * (multi-producer, one consumer). A background thread drains the ring in
+ * batches, formats the records and writes each batch with a single write.
+ * When the ring is full the record is dropped and counted: a log call never
+ * blocks and never allocates.
+ *
+ * String arguments are stored as pointers and formatted later: they must
+ * outlive the call (literals, static names). Formats support the usual
+ * d i u x X o c f e g a s p conversions with flags, width and precision;
+ * length modifiers are ignored (arguments keep their own type). Before
+ * log_init, and after log_shutdown, records are formatted and written by the
+ * calling thread.
+ *
+ * Calls below -DSNAKE_LOG_MIN_LEVEL=n (0 debug, 1 info, 2 warn, 3 error) are
+ * removed at compile time; the rest are filtered at run time by
+ * SNAKE_LOG_LEVEL=debug|info|warn|error (info by default).
+ */
+#define LOG_RING_RECORDS 1024   // power of two
+#define LOG_MAX_ARGS 6
+#define LOG_FLUSH_MS 10         // writer poll period
+
+#ifndef SNAKE_LOG_MIN_LEVEL
+#define SNAKE_LOG_MIN_LEVEL 0
+#endif
+
+enum log_level {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+};
+
+enum log_arg_type {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER
+};
+
+struct log_arg {
+    enum log_arg_type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double f;
+        const char* s;
+        const void* p;
+    } value;
+};
+
+struct log_stats {
+    uint64_t written;
+    uint64_t dropped;     // ring full
+};
+
+extern int log_level;      // runtime threshold, enum log_level
+
+/**
+ * Read SNAKE_LOG_LEVEL and start the writer thread.
+ *
+ * @param stream The output stream (stdout for the game).
+ * @return true if the writer is running.
+ */
+bool log_init(FILE* stream);
+
+/**
+ * Push a record. Use the LOG_* macros instead.
+ *
+ * @param level The record level.
+ * @param format A string literal.
+ * @param count Number of arguments.
+ * @param args The arguments.
+ */
+void log_write(enum log_level level, const char* format, int count, const struct log_arg* args);
+
+/**
+ * Write every pending record before returning, e.g. before printing
+ * directly to the same stream.
+ */
+void log_flush(void);
+
+/**
+ * Flush the ring, stop the writer and report dropped records.
+ */
+void log_shutdown(void);
+
+/**
+ * Read the record counters.
+ *
+ * @param stats Receives the counters.
+ */
+void log_get_stats(struct log_stats* stats);
+
+static inline struct log_arg log_arg_int(int64_t value) {
+    return (struct log_arg){ LOG_ARG_INT, { .i = value } };
+}
+
+static inline struct log_arg log_arg_uint(uint64_t value) {
+    return (struct log_arg){ LOG_ARG_UINT, { .u = value } };
+}
+
+static inline struct log_arg log_arg_double(double value) {
+    return (struct log_arg){ LOG_ARG_DOUBLE, { .f = value } };
+}
+
+static inline struct log_arg log_arg_string(const char* value) {
+    return (struct log_arg){ LOG_ARG_STRING, { .s = value } };
+}
+
+static inline struct log_arg log_arg_pointer(const void* value) {
+    return (struct log_arg){ LOG_ARG_POINTER, { .p = value } };
+}
+
+/// Capture an argument with its type, without formatting it.
+#define LOG_ARG(x) _Generic((x), \
+    float: log_arg_double, double: log_arg_double, \
+    char*: log_arg_string, const char*: log_arg_string, \
+    void*: log_arg_pointer, const void*: log_arg_pointer, \
+    unsigned char: log_arg_uint, unsigned short: log_arg_uint, unsigned int: log_arg_uint, \
+    unsigned long: log_arg_uint, unsigned long long: log_arg_uint, \
+    default: log_arg_int)(x)
+
+// Argument lists of 0 to LOG_MAX_ARGS arguments after the format
+#define LOG_COUNT_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define LOG_COUNT(...) LOG_COUNT_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, 0)
+#define LOG_FORMAT_(format, ...) format
+#define LOG_FORMAT(...) LOG_FORMAT_(__VA_ARGS__, 0)
+#define LOG_ARGS_0(f)
+#define LOG_ARGS_1(f, a) LOG_ARG(a),
+#define LOG_ARGS_2(f, a, b) LOG_ARG(a), LOG_ARG(b),
+#define LOG_ARGS_3(f, a, b, c) LOG_ARGS_2(f, a, b) LOG_ARG(c),
+#define LOG_ARGS_4(f, a, b, c, d) LOG_ARGS_3(f, a, b, c) LOG_ARG(d),
+#define LOG_ARGS_5(f, a, b, c, d, e) LOG_ARGS_4(f, a, b, c, d) LOG_ARG(e),
+#define LOG_ARGS_6(f, a, b, c, d, e, g) LOG_ARGS_5(f, a, b, c, d, e) LOG_ARG(g),
+#define LOG_CONCAT_(a, b) a##b
+#define LOG_CONCAT(a, b) LOG_CONCAT_(a, b)
+
+/// Log a record at a level: LOG_AT(level, "format", args...).
+#define LOG_AT(level, ...) \
+    do { \
+        if ((level) >= SNAKE_LOG_MIN_LEVEL && (int)(level) >= log_level) { \
+            log_write((level), LOG_FORMAT(__VA_ARGS__), LOG_COUNT(__VA_ARGS__), \
+                (const struct log_arg[]){ LOG_CONCAT(LOG_ARGS_, LOG_COUNT(__VA_ARGS__))(__VA_ARGS__) { 0 } }); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
@@ -2,12 +2,24 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include "gfx/gfx.h"
 #include "snake/snake.h"
 #include "queue/queue.h"
 #include "coord/coord.h"
 #include "menu/menu.h"
 #include "food/food.h"
+#include "capture/capture.h"
+#include "level/level.h"
+#include "leaderboard/leaderboard.h"
+#include "trace/trace.h"
+#include "latency/latency.h"
+#include "bot/bot.h"
+#include "export/export.h"
+#include "log/log.h"
+#include "alloc/alloc.h"
+#include "soak/soak.h"
+#include "timer/timer.h"
 
 #define MAX_FOOD_COUNT 50
 #define FOOD_SPAWN_INTERVAL 5000.0 // millisecondes
@@ -15,11 +27,33 @@
 #define BORDER_OFFSET 16
 #define ZOOM 8
 
+// The board is rendered at one logical pixel per cell and upscaled ZOOM times when presented
+#define CELL 1
+#define BORDER_CELLS (BORDER_OFFSET / ZOOM)
+
+// Share of the move interval the bot may spend on a decision
+#define BOT_BUDGET_RATIO 0.5
+
+#define EXPORT_TICKS_BATCH 4096   // tick records kept before they are handed to the export
+
+#define LEADERBOARD_PATH "snake_scores"  // default prefix of the .log/.idx files
+#define HIGH_SCORES_SHOWN 5
+
+/**
+ * When the game loop presents a frame (SNAKE_PACING).
+ */
+enum pacing_mode {
+	PACING_FIXED,   // every frame, 60 times a second
+	PACING_CHANGE,  // only when the board changed, sleeping until the next move, food or input
+	PACING_VSYNC    // as PACING_CHANGE, presents synchronized with the display
+};
+
 enum screen_color_state {
 	EMPTY = COLOR_BLACK,
 	SNAKE = COLOR_WHITE,
 	FOOD = COLOR_RED,
-	WALL = COLOR_BLUE
+	WALL = COLOR_BLUE,
+	PORTAL = COLOR_GREEN
 };
 
 /**
@@ -73,10 +107,13 @@ static struct gfx_context_t* setup_context(const int width, const int height) {
  * Get the next movement direction based on keyboard input, avoiding invalid turns.
  *
  * @param current_direction The current direction of the snake.
+ * @param key_event_ns Receives the time the direction key was queued (CLOCK_MONOTONIC), 0 if none was read.
  * @return The new direction based on user input (WASD or arrow keys), or the current one if no input is detected.
  */
-enum direction get_next_direction(enum direction current_direction) {
-	SDL_Keycode key = gfx_keypressed();
+enum direction get_next_direction(enum direction current_direction, uint64_t* key_event_ns) {
+	uint64_t event_ns = 0;
+	SDL_Keycode key = gfx_keypressed_at(&event_ns);
+	*key_event_ns = 0;
 
 	enum direction requested = current_direction;
 
@@ -106,6 +143,7 @@ enum direction get_next_direction(enum direction current_direction) {
 	}
 	}
 
+	*key_event_ns = event_ns;
 	return requested;
 }
 
@@ -132,6 +170,79 @@ double elapsed_ms(struct timespec* start, struct timespec* end) {
 		(end->tv_nsec - start->tv_nsec) / 1.0e6;            // nanoseconds to ms
 }
 
+/**
+ * Read the pacing mode from SNAKE_PACING ("fixed", "change" or "vsync").
+ *
+ * @return The selected mode, PACING_CHANGE by default.
+ */
+static enum pacing_mode read_pacing_mode(void) {
+	const char* name = getenv("SNAKE_PACING");
+	if (!name || !*name || strcmp(name, "change") == 0) {
+		return PACING_CHANGE;
+	}
+	if (strcmp(name, "fixed") == 0) {
+		return PACING_FIXED;
+	}
+	if (strcmp(name, "vsync") == 0) {
+		return PACING_VSYNC;
+	}
+	fprintf(stderr, "Unknown SNAKE_PACING mode: %s (fixed, change or vsync)\n", name);
+	return PACING_CHANGE;
+}
+
+/**
+ * Timer callback of the game events: raise the flag given as data, the game
+ * loop handles the event.
+ */
+static void raise_flag(struct timer_event* timer, void* data) {
+	(void)timer;
+	*(bool*)data = true;
+}
+
+/**
+ * Convert a duration in milliseconds to timer ticks, at least one.
+ */
+static uint64_t ms_to_ticks(double ms) {
+	uint64_t ticks = (uint64_t)(ms / TIMER_TICK_MS + 0.5);
+	return ticks ? ticks : 1;
+}
+
+/**
+ * Move a head that entered a portal to the cell after the linked portal.
+ *
+ * @param ctxt The graphics context.
+ * @param level The loaded level (portal links).
+ * @param head The new head position, updated in place.
+ * @param dir The direction of movement, kept when leaving the portal.
+ * @param x_min X coordinate of the first board cell.
+ * @param y_min Y coordinate of the first board cell.
+ * @param x_max X coordinate of the last board cell.
+ * @param y_max Y coordinate of the last board cell.
+ * @return The collision type at the exit; a portal leading into another portal, or out of the board, is a wall.
+ */
+static enum collision_type go_through_portal(struct gfx_context_t* ctxt, const struct level_t* level,
+	struct coord_t* head, enum direction dir, int x_min, int y_min, int x_max, int y_max) {
+	struct level_point exit;
+	if (!level || !level_portal_exit(level, (head->x - x_min) / CELL, (head->y - y_min) / CELL, &exit)) {
+		return WALL_COLLISION;
+	}
+
+	// The exit cell is on the map, but the map can be larger than the board
+	if ((int)exit.x > (x_max - x_min) / CELL || (int)exit.y > (y_max - y_min) / CELL) {
+		return WALL_COLLISION;
+	}
+	struct coord_t portal = { .x = x_min + (int)exit.x * CELL, .y = y_min + (int)exit.y * CELL, .next = NULL };
+	struct coord_t* out = new_position(dir, &portal, CELL);
+	if (!out) {
+		return WALL_COLLISION;
+	}
+	head->x = out->x;
+	head->y = out->y;
+	coord_free(out);
+
+	enum collision_type collision = get_collision_type(ctxt, head, CELL);
+	return (collision == PORTAL_COLLISION) ? WALL_COLLISION : collision;
+}
 
 int main(int argc, char const* argv[]) {
 	const int width = 1280;
@@ -140,7 +251,7 @@ int main(int argc, char const* argv[]) {
 	double food_spawn_interval = FOOD_SPAWN_INTERVAL;
 	int max_food_count = MAX_FOOD_COUNT;
 
-	// Optional parameters: [food_spawn_interval_seconds] [max_food_count]
+	// Optional parameters: [food_spawn_interval_seconds] [max_food_count] [level.map]
 	if (argc >= 3) {
 		double interval_input = atof(argv[1]);
 		int food_input = atoi(argv[2]);
@@ -154,18 +265,129 @@ int main(int argc, char const* argv[]) {
 		} else {
 			fprintf(stderr, "Invalid parameters. Using defaults: %.0f ms interval, %d max food\n",
 				food_spawn_interval, max_food_count);
-			fprintf(stderr, "Usage: %s [interval_seconds > 0] [max_food_count > 0]\n", argv[0]);
+			fprintf(stderr, "Usage: %s [interval_seconds > 0] [max_food_count > 0] [level.map]\n", argv[0]);
 		}
 	} else {
 		printf("No parameters provided. Using defaults: %.0f ms interval, %d max food\n",
 			food_spawn_interval, max_food_count);
 	}
 
+	// Optional event trace: SNAKE_TRACE=trace.json (also dumped on SIGUSR1)
+	trace_init();
+
+	struct level_t* level = NULL;
+	if (argc >= 4) {
+		level = level_load(argv[3]);
+		if (!level) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Optional soak run: SNAKE_SOAK=<duration> (90s, 30m, 8h) of bot-driven games, headless by default.
+	// The monitor is created before the other resources, so a failure has little to release.
+	double soak_seconds = 0.0, soak_period = SOAK_DEFAULT_PERIOD_S;
+	struct soak_t* soak = NULL;
+	const char* soak_duration = getenv("SNAKE_SOAK");
+	if (soak_duration && *soak_duration) {
+		const char* soak_sample = getenv("SNAKE_SOAK_SAMPLE");
+		if (!soak_parse_duration(soak_duration, &soak_seconds)
+			|| (soak_sample && *soak_sample && !soak_parse_duration(soak_sample, &soak_period))) {
+			fprintf(stderr, "Invalid SNAKE_SOAK or SNAKE_SOAK_SAMPLE duration (e.g. 90s, 30m, 8h)\n");
+			level_unload(&level);
+			trace_shutdown();
+			return EXIT_FAILURE;
+		}
+		soak = soak_create(soak_seconds, soak_period);
+		if (!soak) {
+			level_unload(&level);
+			trace_shutdown();
+			return EXIT_FAILURE;
+		}
+		setenv("SDL_VIDEODRIVER", "dummy", 0);
+	}
+
+	// Allocation counters (make ALLOC=1), installed before SDL allocates anything
+	const bool alloc_stats = alloc_init();
+
 	struct gfx_context_t* ctxt = setup_context(width, height);
 	if (!ctxt) {
+		soak_destroy(&soak);
+		level_unload(&level);
+		trace_shutdown();
 		return EXIT_FAILURE;
 	}
 
+	// Game events are written by a background thread: SNAKE_LOG_LEVEL=debug|info|warn|error
+	log_init(stdout);
+
+	// Local leaderboard, SNAKE_SCORES overrides the file prefix; a soak run leaves it untouched
+	const char* scores_path = getenv("SNAKE_SCORES");
+	struct leaderboard_t* leaderboard = NULL;
+	if (soak_seconds <= 0.0) {
+		leaderboard = leaderboard_open((scores_path && *scores_path) ? scores_path : LEADERBOARD_PATH);
+	}
+
+	// Optional session recording: SNAKE_CAPTURE=session.y4m or SNAKE_CAPTURE=frames/frame_%06u.ppm
+	struct capture_t* capture = NULL;
+	const char* capture_path = getenv("SNAKE_CAPTURE");
+	if (capture_path && *capture_path) {
+		// Game frames are captured at the board resolution
+		capture = capture_open(capture_path, width / ZOOM, height / ZOOM, 60);
+	}
+
+	enum pacing_mode pacing = read_pacing_mode();
+	if (capture && pacing != PACING_FIXED) {
+		// The recording has a constant frame rate
+		printf("Capture enabled: using fixed frame pacing\n");
+		pacing = PACING_FIXED;
+	}
+	if (pacing == PACING_VSYNC && !gfx_set_vsync(ctxt, true)) {
+		fprintf(stderr, "VSync unavailable, falling back to timer pacing\n");
+		pacing = PACING_CHANGE;
+	}
+
+	// Optional input latency measurement: SNAKE_LATENCY=1, reported after each game
+	struct latency_t* latency = NULL;
+	const char* latency_mode = getenv("SNAKE_LATENCY");
+	if (latency_mode && *latency_mode && *latency_mode != '0') {
+		latency = latency_create();
+	}
+
+	// Optional autopilot: SNAKE_BOT=on (one search thread per core) or SNAKE_BOT=<threads>
+	struct bot_t* bot = NULL;
+	const char* bot_mode = getenv("SNAKE_BOT");
+	if (bot_mode && *bot_mode && strcmp(bot_mode, "0") != 0) {
+		bot = bot_create(atoi(bot_mode));
+		if (bot) {
+			printf("Bot enabled: %d search thread(s)\n", bot_threads(bot));
+		}
+	}
+
+	if (soak) {
+		if (!bot) {
+			bot = bot_create(0);
+		}
+		gfx_set_key_source(soak_menu_key, soak);
+		printf("Soak run: %.0f s, sampled every %.0f s\n", soak_seconds, soak_period);
+	}
+
+	// Optional columnar export: SNAKE_EXPORT=<dir>, SNAKE_EXPORT_TICKS=1 adds one row per move
+	struct export_t* export = NULL;
+	struct export_tick* ticks = NULL;
+	const char* export_dir = getenv("SNAKE_EXPORT");
+	if (export_dir && *export_dir) {
+		const char* ticks_mode = getenv("SNAKE_EXPORT_TICKS");
+		export = export_open(export_dir, ticks_mode && *ticks_mode && *ticks_mode != '0');
+	}
+	if (export && export->ticks) {
+		// Allocated once: full batches are handed to the export during the game
+		ticks = malloc(EXPORT_TICKS_BATCH * sizeof(struct export_tick));
+		if (!ticks) {
+			fprintf(stderr, "Failed to allocate memory for export ticks");
+			export_close(&export);
+		}
+	}
+
 	bool exit_game = false;
 	while (!exit_game) {
 		gfx_clear(ctxt, EMPTY);
@@ -176,134 +398,362 @@ int main(int argc, char const* argv[]) {
 		}
 
 		double snake_move_interval = snake_move_interval = difficulty_to_interval(difficulty);
-		srand(time(NULL));
+		const unsigned int seed = (unsigned int)time(NULL);
+		srand(seed);
 
-		// Game init
-		int x_min = (BORDER_OFFSET / ZOOM) * ZOOM;
-		int y_min = (BORDER_OFFSET / ZOOM) * ZOOM;
-		int x_max = width - BORDER_OFFSET - ZOOM;
-		int y_max = height - BORDER_OFFSET - ZOOM;
+		// Game init, in board cells
+		if (!gfx_set_scale(ctxt, ZOOM)) {
+			fprintf(stderr, "Failed to switch to the board resolution\n");
+			break;
+		}
+		const int board_width = ctxt->width;
+		const int board_height = ctxt->height;
+		int x_min = BORDER_CELLS * CELL;
+		int y_min = BORDER_CELLS * CELL;
+		int x_max = board_width - BORDER_CELLS * CELL - CELL;
+		int y_max = board_height - BORDER_CELLS * CELL - CELL;
 
 		// Place the borders just outside the playable area
 		int border_left = x_min - 1;
-		int border_right = x_max + ZOOM + 1;
+		int border_right = x_max + CELL + 1;
 		int border_top = y_min - 1;
-		int border_bottom = y_max + ZOOM + 1;
+		int border_bottom = y_max + CELL + 1;
 		draw_border(ctxt, border_left, border_right, border_top, border_bottom, WALL);
 
 		int playable_width = x_max - x_min;
 		int playable_height = y_max - y_min;
-		int max_snake_size = (playable_width / ZOOM) * (playable_height / ZOOM);
-
-		struct queue_t* queue = init_snake(x_max, y_max, ZOOM);
-		draw_snake_initial(ctxt, queue, ZOOM, SNAKE);
+		int max_snake_size = (playable_width / CELL) * (playable_height / CELL);
+
+		struct queue_t* queue = NULL;
+		if (level) {
+			int columns = playable_width / CELL + 1;
+			int rows = playable_height / CELL + 1;
+			max_snake_size -= draw_level(ctxt, level, x_min, y_min, columns, rows, CELL, WALL, PORTAL);
+
+			// The body extends upwards from the spawn point
+			uint32_t spawn_count = level->header->spawn_count;
+			if (spawn_count > 0) {
+				struct level_point spawn = level->spawns[rand() % spawn_count];
+				bool inside = ((int)spawn.x < columns && spawn.y >= LEVEL_SPAWN_BODY && (int)spawn.y < rows);
+				// Drawn walls and portals must not be covered (and later erased) by the body
+				for (int i = 0; inside && i <= LEVEL_SPAWN_BODY; i++) {
+					inside = gfx_cell_is(ctxt, x_min + spawn.x * CELL, y_min + (spawn.y - i) * CELL, CELL, EMPTY);
+				}
+				if (inside) {
+					queue = init_snake_at(x_min + spawn.x * CELL, y_min + spawn.y * CELL, CELL);
+				}
+			}
+		}
+		if (!queue) {
+			queue = init_snake(x_max, y_max, CELL);
+		}
+		draw_snake_initial(ctxt, queue, CELL, SNAKE);
+		// Every node the snake can need, plus the food and portal temporaries
+		if (!coord_pool_reserve((size_t)max_snake_size + 2)) {
+			fprintf(stderr, "Failed to reserve the snake nodes\n");
+		}
+		alloc_game_begin();
 
 		int food_counter = 1, score = 0;
-		spawn_food(ctxt, BORDER_OFFSET, ZOOM, EMPTY, FOOD);
+		spawn_food(ctxt, BORDER_CELLS, CELL, EMPTY, FOOD);
 
 		const double frames_per_second = 60.0;
 		const double time_between_frames = 1.0 / frames_per_second * 1e6;
 
 		int last_direction, direction = right;
-		struct timespec last_food_time, last_move_time;
-		clock_gettime(CLOCK_MONOTONIC, &last_food_time);
-
-		bool first_move = true, done = false, has_snake_won = false;
+		struct timespec game_start_time;
+		clock_gettime(CLOCK_MONOTONIC, &game_start_time);
+
+		bool done = false, has_snake_won = false;
+		uint32_t decision_us = 0, tick_count = 0, batched_ticks = 0;
+		enum export_outcome outcome = EXPORT_OUTCOME_QUIT;
+		const double bot_budget_ms = snake_move_interval * BOT_BUDGET_RATIO;
+
+		// Timed events, in ticks since the start of the game: the bot decides
+		// ahead of each move so that the move stays on time
+		const uint64_t move_ticks = ms_to_ticks(snake_move_interval);
+		const uint64_t food_ticks = ms_to_ticks(food_spawn_interval);
+		const uint64_t budget_ticks = (uint64_t)(bot_budget_ms / TIMER_TICK_MS);
+		bool move_due = false, decide_due = false, food_due = false;
+		struct timer_wheel_t wheel;
+		struct timer_event move_timer, decide_timer, food_timer;
+		timer_wheel_init(&wheel, 0);
+		timer_init(&move_timer, raise_flag, &move_due);
+		timer_init(&decide_timer, raise_flag, &decide_due);
+		timer_init(&food_timer, raise_flag, &food_due);
+		timer_schedule_at(&wheel, &move_timer, move_ticks);
+		if (bot) {
+			timer_schedule_at(&wheel, &decide_timer, move_ticks - budget_ticks);
+		}
+		timer_schedule_at(&wheel, &food_timer, food_ticks);
+		uint64_t food_tick = 0, tick = 0;
 		while (!done) {
+			TRACE_SCOPE("frame");
+			alloc_frame_begin();
+			trace_poll();
 			struct timespec frame_start_time, frame_end_time, current_time;
 			clock_gettime(CLOCK_MONOTONIC, &frame_start_time);
 
-			last_direction = direction;
-			direction = get_next_direction(direction);
+			{
+				TRACE_SCOPE("input");
+				last_direction = direction;
+				uint64_t key_event_ns;
+				enum direction requested = get_next_direction(direction, &key_event_ns);
+				if (!bot) {
+					direction = requested;
+				}
+				if (latency && key_event_ns) {
+					latency_key_read(latency, key_event_ns);
+				}
+				done = quit_signal() || (soak && soak_finished(soak));
+			}
 
-			done = quit_signal();
 			// Memory leaks occur in gfx_present
-			gfx_present(ctxt);
-
+			if (pacing == PACING_FIXED || ctxt->dirty) {
+				if (latency) {
+					latency_present_begin(latency);
+				}
+				gfx_present(ctxt);
+				if (latency) {
+					latency_present_end(latency);
+				}
+				if (capture) {
+					TRACE_SCOPE("capture_frame");
+					capture_frame(capture, ctxt->pixels);
+				}
+			}
 
 			has_snake_won = queue->size >= max_snake_size;
 			if (has_snake_won) {
-				printf("You win\n");
+				outcome = EXPORT_OUTCOME_WON;
+				LOG_INFO("You win");
 				break;
 			}
 
 			clock_gettime(CLOCK_MONOTONIC, &current_time);
+			double game_ms = elapsed_ms(&game_start_time, &current_time);
+			tick = (uint64_t)(game_ms / TIMER_TICK_MS);
+			timer_wheel_advance(&wheel, tick);
 
-			// Check if it's time to spawn food
-			double time_since_last_food = elapsed_ms(&last_food_time, &current_time);
-			bool should_spawn_food = (
-				(time_since_last_food >= food_spawn_interval && food_counter < max_food_count)
-				|| food_counter == 0
-				);
+			// Check if it's time to spawn food; a spawn delayed by the food limit happens once food is eaten
+			bool should_spawn_food = ((food_due && food_counter < max_food_count) || food_counter == 0);
 			if (should_spawn_food) {
 				food_counter++;
-				spawn_food(ctxt, BORDER_OFFSET, ZOOM, EMPTY, FOOD);
-				clock_gettime(CLOCK_MONOTONIC, &last_food_time);
-			}
-
-			// Handles the first move to initialize the timer
-			if (first_move) {
-				clock_gettime(CLOCK_MONOTONIC, &last_move_time);
-				first_move = false;
-				continue;
+				spawn_food(ctxt, BORDER_CELLS, CELL, EMPTY, FOOD);
+				food_due = false;
+				food_tick = tick;
+				timer_schedule_at(&wheel, &food_timer, tick + food_ticks);
 			}
 
 			// Handles the snake movement
-			double time_since_last_move = elapsed_ms(&last_move_time, &current_time);
-			bool should_move_snake = (time_since_last_move >= snake_move_interval);
-			if (should_move_snake) {
-				struct coord_t* new_head = new_position(direction, queue->tail, ZOOM);
+			if (decide_due) {
+				struct bot_view view = {
+					.ctxt = ctxt,
+					.zoom = CELL,
+					.queue = queue,
+					.direction = direction,
+					.border = BORDER_CELLS,
+					.food_count = food_counter,
+					.max_food = max_food_count,
+					.ticks_since_food = (int)((double)(tick - food_tick) * TIMER_TICK_MS / snake_move_interval),
+					.food_interval_ticks = (int)(food_spawn_interval / snake_move_interval),
+				};
+				// The search arenas only grow when a search goes deeper than every earlier one
+				alloc_allow_begin();
+				direction = bot_decide(bot, &view, bot_budget_ms);
+				alloc_allow_end();
+				decide_due = false;
+				struct timespec decision_start_time = current_time;
+				clock_gettime(CLOCK_MONOTONIC, &current_time);
+				decision_us = (uint32_t)(elapsed_ms(&decision_start_time, &current_time) * 1000.0);
+				game_ms = elapsed_ms(&game_start_time, &current_time);
+				tick = (uint64_t)(game_ms / TIMER_TICK_MS);
+				timer_wheel_advance(&wheel, tick);
+			}
+			if (move_due) {
+				TRACE_SCOPE("move");
+				move_due = false;
+				if (soak) {
+					soak_move(soak, game_ms - (double)(move_timer.expires * TIMER_TICK_MS));
+				}
+				struct coord_t* new_head = new_position(direction, queue->tail, CELL);
 				bool is_reverse_turn = (last_direction + direction == 3);
-				enum collision_type collision = get_collision_type(ctxt, new_head, ZOOM);
+				enum collision_type collision = get_collision_type(ctxt, new_head, CELL);
+				if (collision == PORTAL_COLLISION) {
+					collision = go_through_portal(ctxt, level, new_head, direction, x_min, y_min, x_max, y_max);
+				}
 
 				bool hit_wall_or_reverse = (collision == WALL_COLLISION || is_reverse_turn);
 				bool hit_self = (collision == SNAKE_COLLISION);
 				bool ate_food = (collision == FOOD_COLLISION);
 				if (hit_wall_or_reverse) {
-					printf("Wall collision or reverse turn detected\n");
-					free(new_head);
+					outcome = EXPORT_OUTCOME_WALL;
+					LOG_INFO("Wall collision or reverse turn detected");
+					coord_free(new_head);
 					break;
 				}
 
 				if (hit_self) {
-					printf("Snake self-collision detected\n");
-					free(new_head);
+					outcome = EXPORT_OUTCOME_SELF;
+					LOG_INFO("Snake self-collision detected");
+					coord_free(new_head);
 					break;
 				}
 
 				if (ate_food) {
 					score += 10;
-					printf("Food eaten!\n");
-					draw_pixel(ctxt, new_head->x, new_head->y, ZOOM, EMPTY);
-					draw_pixel(ctxt, new_head->x, new_head->y, ZOOM, SNAKE);
+					LOG_INFO("Food eaten! score %d, length %d", score, queue->size + 1);
+					draw_pixel(ctxt, new_head->x, new_head->y, CELL, EMPTY);
+					draw_pixel(ctxt, new_head->x, new_head->y, CELL, SNAKE);
 					queue_enqueue(queue, new_head);
 					food_counter--;
 				} else {
-					move_snake(ctxt, queue, new_head, ZOOM, SNAKE, EMPTY);
+					move_snake(ctxt, queue, new_head, CELL, SNAKE, EMPTY);
+				}
+				if (latency) {
+					latency_move_applied(latency);
+				}
+				if (ticks) {
+					ticks[batched_ticks++] = (struct export_tick){
+						.head_x = (uint16_t)((queue->tail->x - x_min) / CELL),
+						.head_y = (uint16_t)((queue->tail->y - y_min) / CELL),
+						.length = (uint32_t)queue->size,
+						.score = (uint32_t)score,
+						.food = (uint16_t)food_counter,
+						.decision_us = decision_us,
+					};
+					if (batched_ticks == EXPORT_TICKS_BATCH) {
+						// Copied into the column blocks, written once a block is full
+						if (!export_add_ticks(export, ticks, batched_ticks)) {
+							LOG_WARN("Failed to export %u ticks", batched_ticks);
+						}
+						batched_ticks = 0;
+					}
+				}
+				tick_count++;
+				decision_us = 0;
+
+				// Next move on the grid of move ticks, unless it is already a full interval late
+				uint64_t next_move = move_timer.expires + move_ticks;
+				if (next_move <= tick) {
+					next_move = tick + move_ticks;
+				}
+				timer_schedule_at(&wheel, &move_timer, next_move);
+				if (bot) {
+					timer_schedule_at(&wheel, &decide_timer, next_move - budget_ticks);
 				}
-				clock_gettime(CLOCK_MONOTONIC, &last_move_time);
 			}
 
 			// Handles the FPS limit
 			clock_gettime(CLOCK_MONOTONIC, &frame_end_time);
-			double frame_duration_ms = elapsed_ms(&frame_start_time, &frame_end_time);
-			double sleep_time_for_fps_limit = time_between_frames - frame_duration_ms;
+			if (soak) {
+				soak_frame(soak, elapsed_ms(&frame_start_time, &frame_end_time));
+			}
+			if (pacing == PACING_FIXED) {
+				double frame_duration_ms = elapsed_ms(&frame_start_time, &frame_end_time);
+				double sleep_time_for_fps_limit = time_between_frames - frame_duration_ms;
 
-			if (sleep_time_for_fps_limit > 0.0) {
-				usleep((int32_t)sleep_time_for_fps_limit);
+				if (sleep_time_for_fps_limit > 0.0) {
+					TRACE_SCOPE("sleep");
+					usleep((int32_t)sleep_time_for_fps_limit);
+				}
+			} else if (!ctxt->dirty) {
+				// Nothing to show: sleep until the next timer (move, decision, food) or an input
+				uint64_t next_ticks = timer_wheel_next(&wheel);
+				if (next_ticks != TIMER_NONE) {
+					double wait_ms = (double)((wheel.now + next_ticks) * TIMER_TICK_MS)
+						- elapsed_ms(&game_start_time, &frame_end_time);
+					if (wait_ms > 0.0) {
+						gfx_wait_event(ctxt, (int)wait_ms + 1);
+					}
+				}
 			}
 		}
 
+		alloc_frame_end();
+		int snake_length = queue->size;
 		queue_destroy(&queue);
+		// The reports below print directly: write the game events first
+		log_flush();
+		struct timespec game_end_time;
+		clock_gettime(CLOCK_MONOTONIC, &game_end_time);
+		const uint32_t duration_ms = (uint32_t)elapsed_ms(&game_start_time, &game_end_time);
+		if (export) {
+			struct export_game game = {
+				.seed = seed,
+				.difficulty = (uint8_t)difficulty,
+				.outcome = (uint8_t)outcome,
+				.score = (uint32_t)score,
+				.length = (uint32_t)snake_length,
+				.duration_ms = duration_ms,
+			};
+			if (!export_add_game(export, &game, ticks, ticks ? batched_ticks : tick_count)) {
+				fprintf(stderr, "Failed to export the game\n");
+			}
+		}
+		if (latency) {
+			latency_report(latency, stdout);
+			latency_reset(latency);
+		}
+		if (bot) {
+			bot_report(bot, stdout);
+			bot_reset_stats(bot);
+		}
+		if (alloc_stats) {
+			alloc_report(stdout);
+		}
+		if (soak) {
+			soak_game_end(soak);
+		}
 		if (done) {
 			break;
 		}
 
-		bool play_again = show_end_screen(ctxt, score, has_snake_won);
+		struct score_entry top[HIGH_SCORES_SHOWN];
+		int top_count = 0;
+		if (leaderboard) {
+			// Only the games of the player are ranked, the bot's are not
+			if (!bot) {
+				struct score_entry entry = {
+					.score = score,
+					.length = snake_length,
+					.difficulty = difficulty,
+					.duration_ms = duration_ms,
+					.seed = seed,
+				};
+				leaderboard_add(leaderboard, &entry);
+			}
+			top_count = leaderboard_top(leaderboard, top, HIGH_SCORES_SHOWN);
+		}
+
+		bool play_again = show_end_screen(ctxt, score, has_snake_won, top, top_count);
 		if (!play_again) {
 			exit_game = true;
 		}
 	}
+	if (capture) {
+		struct capture_stats stats;
+		capture_close(&capture, &stats);
+		printf("Capture: %llu frames written, %llu dropped\n",
+			(unsigned long long)stats.written, (unsigned long long)stats.dropped);
+	}
+	if (export && !export_close(&export)) {
+		fprintf(stderr, "Failed to flush the export\n");
+	}
+	free(ticks);
+	bool stable = true;
+	if (soak) {
+		log_flush();
+		stable = soak_report(soak, stdout);
+		gfx_set_key_source(NULL, NULL);
+		soak_destroy(&soak);
+	}
+	latency_destroy(&latency);
+	bot_destroy(&bot);
 	gfx_destroy(ctxt);
-	return EXIT_SUCCESS;
+	leaderboard_close(&leaderboard);
+	level_unload(&level);
+	trace_shutdown();
+	log_shutdown();
+	return stable ? EXIT_SUCCESS : EXIT_FAILURE;
 }
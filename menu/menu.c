@@ -5,6 +5,11 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include "../trace/trace.h"
+
+// Longest sleep of an idle menu: it wakes up as soon as an event arrives
+#define MENU_IDLE_WAIT_MS 250
+
 /**
  * Render a menu item (e.g., "EASY", "PLAY AGAIN") at a given vertical position.
  * The text is centered horizontally and rendered in red if selected, otherwise white.
@@ -15,9 +20,7 @@
  * @param selected True if this item is currently selected (highlighted).
  */
 static void draw_menu_item(struct gfx_context_t* ctxt, const char* label, int y, bool selected) {
-    SDL_Color white = { 255, 255, 255, 255 };
-    SDL_Color red = { 255, 0, 0, 255 };
-    draw_text_ttf(ctxt, label, ctxt->width / 2 - 100, y, 32, selected ? red : white, FONT_PATH);
+    draw_text(ctxt, label, ctxt->width / 2 - 100, y, 32, selected ? COLOR_RED : COLOR_WHITE);
 }
 
 /**
@@ -27,10 +30,10 @@ static void draw_menu_item(struct gfx_context_t* ctxt, const char* label, int y,
  * @param text The string to display.
  * @param y The vertical position on the screen.
  * @param size Font size in points.
- * @param color Text color (SDL_Color struct).
+ * @param color Text color.
  */
-static void draw_label(struct gfx_context_t* ctxt, const char* text, int y, int size, SDL_Color color) {
-    draw_text_ttf(ctxt, text, ctxt->width / 2 - 100, y, size, color, FONT_PATH);
+static void draw_label(struct gfx_context_t* ctxt, const char* text, int y, int size, uint32_t color) {
+    draw_text(ctxt, text, ctxt->width / 2 - 100, y, size, color);
 }
 
 /**
@@ -63,25 +66,32 @@ static int handle_selection_input(int selection, int min, int max, bool* confirm
 
 enum difficulty_level show_start_screen(struct gfx_context_t* ctxt) {
     int selection = NORMAL;
-    SDL_Color white = { 255, 255, 255, 255 };
-    SDL_Color blue = { 0, 0, 255, 255 };
+    int drawn_selection = -1;
 
+    // Menus are drawn at full resolution
+    gfx_set_scale(ctxt, 1);
     const int spacing = 60;
     const int y = ctxt->height / 2 - 2 * spacing;
 
     while (true) {
+        TRACE_SCOPE("start_screen");
         if (quit_signal()) {
             return LEAVE;
         }
 
-        gfx_clear(ctxt, COLOR_BLACK);
-        draw_label(ctxt, "SNAKE", y - 2 * spacing, 48, white);
-        draw_menu_item(ctxt, "EASY", y, selection == EASY);
-        draw_menu_item(ctxt, "NORMAL", y + spacing, selection == NORMAL);
-        draw_menu_item(ctxt, "HARD", y + 2 * spacing, selection == HARD);
-        draw_label(ctxt, "PRESS ENTER", y + 4 * spacing, 24, blue);
-
-        SDL_RenderPresent(ctxt->renderer);
+        // Redraw and present only when something changed
+        if (selection != drawn_selection) {
+            gfx_clear(ctxt, COLOR_BLACK);
+            draw_label(ctxt, "SNAKE", y - 2 * spacing, 48, COLOR_WHITE);
+            draw_menu_item(ctxt, "EASY", y, selection == EASY);
+            draw_menu_item(ctxt, "NORMAL", y + spacing, selection == NORMAL);
+            draw_menu_item(ctxt, "HARD", y + 2 * spacing, selection == HARD);
+            draw_label(ctxt, "PRESS ENTER", y + 4 * spacing, 24, COLOR_BLUE);
+            drawn_selection = selection;
+        }
+        if (ctxt->dirty) {
+            gfx_present(ctxt);
+        }
 
         bool confirmed = false;
         selection = handle_selection_input(selection, EASY, HARD, &confirmed);
@@ -93,36 +103,67 @@ enum difficulty_level show_start_screen(struct gfx_context_t* ctxt) {
         }
 
         usleep(2000); // Avoid skipping options by holding key
+        gfx_wait_event(ctxt, MENU_IDLE_WAIT_MS);
     }
 
     return (enum difficulty_level)selection;
 }
 
-bool show_end_screen(struct gfx_context_t* ctxt, int score, bool does_player_win) {
+/**
+ * Render the leaderboard under the end screen menu.
+ *
+ * @param ctxt The graphics context.
+ * @param top The best scores, highest first.
+ * @param top_count The number of entries to render.
+ * @param y The vertical position of the first line.
+ */
+static void draw_high_scores(struct gfx_context_t* ctxt, const struct score_entry* top, int top_count, int y) {
+    static const char* difficulty_names[] = { "EASY", "NORMAL", "HARD" };
+
+    draw_label(ctxt, "HIGH SCORES", y, 24, COLOR_YELLOW);
+    for (int i = 0; i < top_count; i++) {
+        const char* difficulty = (top[i].difficulty <= HARD) ? difficulty_names[top[i].difficulty] : "?";
+        char line[64];
+        snprintf(line, sizeof(line), "%d. %5u %s", i + 1, top[i].score, difficulty);
+        draw_label(ctxt, line, y + 36 + 24 * i, 16, COLOR_WHITE);
+    }
+}
+
+bool show_end_screen(struct gfx_context_t* ctxt, int score, bool does_player_win,
+    const struct score_entry* top, int top_count) {
     int selection = 0;  // 0 = play again, 1 = leave
-    SDL_Color white = { 255, 255, 255, 255 };
+    int drawn_selection = -1;
 
+    gfx_set_scale(ctxt, 1);
     const int spacing = 60;
     const int y = ctxt->height / 2 - 2 * spacing;
 
     while (true) {
+        TRACE_SCOPE("end_screen");
         if (quit_signal()) {
             return false;
         }
 
-        gfx_clear(ctxt, COLOR_BLACK);
+        if (selection != drawn_selection) {
+            gfx_clear(ctxt, COLOR_BLACK);
 
-        const char* result_text = does_player_win ? "YOU WIN" : "GAME OVER";
+            const char* result_text = does_player_win ? "YOU WIN" : "GAME OVER";
 
-        char score_text[32];
-        snprintf(score_text, sizeof(score_text), "Your score is %d", score);
+            char score_text[32];
+            snprintf(score_text, sizeof(score_text), "Your score is %d", score);
 
-        draw_label(ctxt, result_text, y - 2 * spacing, 48, white);
-        draw_label(ctxt, score_text, y - spacing, 32, white);
-        draw_menu_item(ctxt, "PLAY AGAIN", y, selection == 0);
-        draw_menu_item(ctxt, "LEAVE", y + spacing, selection == 1);
-
-        SDL_RenderPresent(ctxt->renderer);
+            draw_label(ctxt, result_text, y - 2 * spacing, 48, COLOR_WHITE);
+            draw_label(ctxt, score_text, y - spacing, 32, COLOR_WHITE);
+            draw_menu_item(ctxt, "PLAY AGAIN", y, selection == 0);
+            draw_menu_item(ctxt, "LEAVE", y + spacing, selection == 1);
+            if (top && top_count > 0) {
+                draw_high_scores(ctxt, top, top_count, y + 3 * spacing);
+            }
+            drawn_selection = selection;
+        }
+        if (ctxt->dirty) {
+            gfx_present(ctxt);
+        }
 
         bool confirmed = false;
         selection = handle_selection_input(selection, 0, 1, &confirmed);
@@ -134,6 +175,7 @@ bool show_end_screen(struct gfx_context_t* ctxt, int score, bool does_player_win
         }
 
         usleep(2000); // Avoid double selection due to fast key repeat
+        gfx_wait_event(ctxt, MENU_IDLE_WAIT_MS);
     }
 
     return (selection == 0);
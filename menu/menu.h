@@ -2,11 +2,10 @@
 #define _MENU_H
 
 #include "../gfx/gfx.h"
+#include "../leaderboard/leaderboard.h"
 
 #include <stdbool.h>
 
-#define FONT_PATH "assets/PixelOperatorMono8.ttf"
-
 enum difficulty_level {
     EASY,
     NORMAL,
@@ -36,9 +35,12 @@ enum difficulty_level show_start_screen(struct gfx_context_t* ctxt);
  * @param ctxt The graphics context used for rendering.
  * @param score The final score achieved by the player.
  * @param does_player_win A boolean indicating if the player has won the game.
+ * @param top The best scores to list, highest first (may be NULL).
+ * @param top_count The number of entries in top.
  *
  * @return true if the player chooses to play again, false to exit.
  */
-bool show_end_screen(struct gfx_context_t* ctxt, int const score, bool does_player_win);
+bool show_end_screen(struct gfx_context_t* ctxt, int const score, bool does_player_win,
+    const struct score_entry* top, int top_count);
 
 #endif
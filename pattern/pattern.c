@@ -0,0 +1,25 @@
+#include "pattern.h"
+
+#include <string.h>
+
+bool parse_frame_pattern(const char* pattern, bool* zero, int* digits, int* prefix, int* suffix) {
+    const char* conversion = strchr(pattern, '%');
+    if (!conversion) {
+        return false;
+    }
+    const char* spec = conversion + 1;
+    *zero = (*spec == '0');
+    *digits = 0;
+    for (; *spec >= '0' && *spec <= '9'; spec++) {
+        *digits = *digits * 10 + (*spec - '0');
+        if (*digits > PATTERN_MAX_DIGITS) {
+            return false;
+        }
+    }
+    if ((*spec != 'u' && *spec != 'd') || strchr(spec, '%')) {
+        return false;
+    }
+    *prefix = (int)(conversion - pattern);
+    *suffix = (int)(spec + 1 - pattern);
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef _PATTERN_H_
+#define _PATTERN_H_
+
+#include <stdbool.h>
+
+// Largest field width of the frame number in a frame pattern
+#define PATTERN_MAX_DIGITS 32
+
+/**
+ * Find the frame number conversion of a frame path pattern (e.g.
+ * "frames/frame_%06u.ppm"): exactly one %u or %d, with an optional 0 flag
+ * and field width. Any other '%' is rejected.
+ *
+ * The pattern itself is never used as a format: a frame name is built with
+ * "%.*s%0*u%s" (or "%.*s%*u%s" without the 0 flag) from the prefix bytes of
+ * the pattern, the frame number and the pattern after the conversion.
+ *
+ * @param pattern The path pattern.
+ * @param zero Set if the frame number is padded with zeros.
+ * @param digits Set to the field width of the frame number.
+ * @param prefix Set to the number of pattern bytes before the conversion.
+ * @param suffix Set to the offset of the pattern after the conversion.
+ * @return true if the pattern is valid.
+ */
+bool parse_frame_pattern(const char* pattern, bool* zero, int* digits, int* prefix, int* suffix);
+
+#endif
@@ -64,6 +64,6 @@ bool queue_dequeue(struct queue_t* queue) {
     }
     queue->size--;
 
-    free(temp);
+    coord_free(temp);
     return true;
 }
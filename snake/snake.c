@@ -3,12 +3,16 @@
 #include <stdlib.h>
 
 struct queue_t* init_snake(const int width, const int height, const int zoom) {
-    struct queue_t* queue = queue_create();
-
     // Align the central coordinates to the grid based on ZOOM
     const int x = (width / 2 / zoom) * zoom;
     const int y = (height / 2 / zoom) * zoom;
 
+    return init_snake_at(x, y, zoom);
+}
+
+struct queue_t* init_snake_at(const int x, const int y, const int zoom) {
+    struct queue_t* queue = queue_create();
+
     // Initialize the snake's body (head, mid, tail) at the center of the grid
     struct coord_t* head = coord_init(x, y);
     struct coord_t* mid = coord_init(x, y - zoom);
@@ -65,6 +69,10 @@ void move_snake(struct gfx_context_t* ctxt, struct queue_t* queue, struct coord_
 }
 
 enum collision_type get_collision_type(struct gfx_context_t* ctxt, const struct coord_t* pos, int zoom) {
+    // Fast path: most moves go to an empty cell
+    if (gfx_cell_is(ctxt, pos->x, pos->y, zoom, COLOR_BLACK)) {
+        return NO_COLLISION;
+    }
     for (int ix = 0; ix < zoom; ix++) {
         for (int iy = 0; iy < zoom; iy++) {
             uint32_t pixel = gfx_getpixel(ctxt, pos->x + ix, pos->y + iy);
@@ -75,6 +83,8 @@ enum collision_type get_collision_type(struct gfx_context_t* ctxt, const struct
                 return SNAKE_COLLISION;
             case COLOR_RED:
                 return FOOD_COLLISION;
+            case COLOR_GREEN:
+                return PORTAL_COLLISION;
             default:
                 break;
             }
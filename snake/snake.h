@@ -16,7 +16,8 @@ enum collision_type {
     NO_COLLISION,
     WALL_COLLISION,
     SNAKE_COLLISION,
-    FOOD_COLLISION
+    FOOD_COLLISION,
+    PORTAL_COLLISION
 };
 
 /**
@@ -29,6 +30,17 @@ enum collision_type {
  */
 struct queue_t* init_snake(const int width, const int height, const int zoom);
 
+/**
+ * Initializes the snake with its head at the given position, the body
+ * extending upwards from it.
+ *
+ * @param x the x coordinate of the head (aligned on the grid)
+ * @param y the y coordinate of the head (aligned on the grid)
+ * @param zoom the zoom level (grid size)
+ * @return a pointer to a queue containing the initial snake body
+ */
+struct queue_t* init_snake_at(const int x, const int y, const int zoom);
+
 /**
  * Calculates a new position based on the current direction and position.
  *
@@ -68,7 +80,7 @@ void move_snake(struct gfx_context_t* ctxt, struct queue_t* queue, struct coord_
  * @param ctxt the graphics context
  * @param pos the position to evaluate
  * @param zoom the size of the cell (used to scale coordinates)
- * @return the corresponding collision type (wall, snake, food, or none)
+ * @return the corresponding collision type (wall, snake, food, portal, or none)
  */
 enum collision_type get_collision_type(struct gfx_context_t* ctxt, const struct coord_t* pos, int zoom);
 #endif
\ No newline at end of file
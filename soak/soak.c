@@ -0,0 +1,332 @@
+#include "soak.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../log/log.h"
+#include "../menu/menu.h"
+
+#define SOAK_WARMUP_SAMPLES 2      // first samples (startup growth) left out of the trends
+#define SOAK_REPORT_ROWS 60        // sample rows printed at most
+
+static const char* metric_names[SOAK_METRICS] = { "rss_kb", "fds", "threads", "frame_p99_ms", "drift_p99_ms" };
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+bool soak_parse_duration(const char* text, double* seconds) {
+    char* end;
+    double value = strtod(text, &end);
+    double unit = 1.0;
+    if (*end == 'm') {
+        unit = 60.0;
+    } else if (*end == 'h') {
+        unit = 3600.0;
+    } else if (*end != 's' && *end != '\0') {
+        return false;
+    }
+    if (*end && end[1]) {
+        return false;
+    }
+    *seconds = value * unit;
+    return *seconds > 0.0;
+}
+
+/**
+ * Queue the keys of the start screen: the selection starts on NORMAL.
+ */
+static void queue_start_keys(struct soak_t* soak) {
+    static const SDL_Keycode moves[] = { [EASY] = SDLK_UP, [NORMAL] = 0, [HARD] = SDLK_DOWN };
+    const enum difficulty_level difficulty = (enum difficulty_level)(soak->games % 3);
+    if (moves[difficulty]) {
+        soak->keys[soak->key_count++] = moves[difficulty];
+    }
+    soak->keys[soak->key_count++] = SDLK_RETURN;
+}
+
+struct soak_t* soak_create(double duration_s, double period_s) {
+    struct soak_t* soak = calloc(1, sizeof(struct soak_t));
+    if (!soak) {
+        fprintf(stderr, "Failed to allocate memory for soak run");
+        return NULL;
+    }
+    soak->duration_s = duration_s;
+    soak->period_s = period_s;
+    soak->start_s = now_s();
+    soak->next_sample_s = soak->start_s + period_s;
+    queue_start_keys(soak);
+    return soak;
+}
+
+void soak_destroy(struct soak_t** soak) {
+    if (!soak || !*soak) {
+        return;
+    }
+    free(*soak);
+    *soak = NULL;
+}
+
+SDL_Keycode soak_menu_key(void* data) {
+    struct soak_t* soak = data;
+    if (soak->key_next >= soak->key_count) {
+        return 0;
+    }
+    return soak->keys[soak->key_next++];
+}
+
+void soak_game_end(struct soak_t* soak) {
+    soak->games++;
+    soak->key_count = 0;
+    soak->key_next = 0;
+    soak->keys[soak->key_count++] = SDLK_RETURN;   // end screen: play again
+    queue_start_keys(soak);
+}
+
+static void histogram_add(struct soak_histogram* histogram, double value_ms) {
+    if (value_ms < 0.0) {
+        value_ms = 0.0;
+    }
+    int bucket = (int)(value_ms / SOAK_BUCKET_MS);
+    histogram->buckets[bucket < SOAK_HISTOGRAM_BUCKETS ? bucket : SOAK_HISTOGRAM_BUCKETS - 1]++;
+    histogram->max = (value_ms > histogram->max) ? value_ms : histogram->max;
+    histogram->count++;
+}
+
+static double histogram_percentile(const struct soak_histogram* histogram, double fraction) {
+    if (histogram->count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)(fraction * (histogram->count - 1));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < SOAK_HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen > rank) {
+            const double value = (bucket + 0.5) * SOAK_BUCKET_MS;
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * Read a small /proc file into buffer, NUL terminated.
+ */
+static bool read_proc(const char* path, char* buffer, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t length = read(fd, buffer, size - 1);
+    close(fd);
+    if (length <= 0) {
+        return false;
+    }
+    buffer[length] = '\0';
+    return true;
+}
+
+/**
+ * RSS and thread count from /proc/self/stat (fields 24 and 20).
+ */
+static void sample_stat(struct soak_sample* sample) {
+    char buffer[1024];
+    if (!read_proc("/proc/self/stat", buffer, sizeof(buffer))) {
+        return;
+    }
+    // The command name may contain spaces: fields are counted from its closing parenthesis
+    char* field = strrchr(buffer, ')');
+    if (!field) {
+        return;
+    }
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    for (int index = 2; field && index <= 24; index++) {
+        field = strchr(field + 1, ' ');
+        if (field && index + 1 == 20) {
+            sample->values[SOAK_THREADS] = (double)strtol(field + 1, NULL, 10);
+        } else if (field && index + 1 == 24) {
+            sample->values[SOAK_RSS_KB] = (double)(strtol(field + 1, NULL, 10) * page_kb);
+        }
+    }
+}
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * Open file descriptors: entries of /proc/self/fd, minus the one reading it.
+ */
+static int count_fds(void) {
+    int fd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return -1;
+    }
+    int count = 0;
+    char buffer[4096] __attribute__((aligned(8)));
+    long length;
+    while ((length = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < length;) {
+            const struct linux_dirent64* entry = (const struct linux_dirent64*)(buffer + offset);
+            if (entry->d_name[0] != '.') {
+                count++;
+            }
+            offset += entry->d_reclen;
+        }
+    }
+    close(fd);
+    return count - 1;
+}
+
+/**
+ * Check every metric over the last samples: growth without any decrease,
+ * beyond a tolerance for the noisy ones, raises one alert until it stops.
+ */
+static void check_trends(struct soak_t* soak) {
+    static const double relative[SOAK_METRICS] = { 0.01, 0.0, 0.0, 0.10, 0.10 };
+    static const double absolute[SOAK_METRICS] = { 1024.0, 0.5, 0.5, 0.05, 0.05 };
+    if (soak->sample_count < SOAK_WARMUP_SAMPLES + SOAK_TREND_SAMPLES) {
+        return;
+    }
+    const struct soak_sample* window = &soak->samples[soak->sample_count - SOAK_TREND_SAMPLES];
+    for (int m = 0; m < SOAK_METRICS; m++) {
+        bool monotonic = true;
+        for (int i = 1; i < SOAK_TREND_SAMPLES && monotonic; i++) {
+            monotonic = window[i].values[m] >= window[i - 1].values[m];
+        }
+        const double first = window[0].values[m];
+        const double last = window[SOAK_TREND_SAMPLES - 1].values[m];
+        const double tolerance = (first * relative[m] > absolute[m]) ? first * relative[m] : absolute[m];
+        const bool growing = monotonic && last - first > tolerance;
+        if (growing && !soak->growing[m]) {
+            soak->alerts++;
+            soak->metric_alerts[m]++;
+            LOG_WARN("soak: %s grew over the last %d samples: %.2f -> %.2f", metric_names[m], SOAK_TREND_SAMPLES, first, last);
+        }
+        soak->growing[m] = growing;
+    }
+}
+
+static void take_sample(struct soak_t* soak, double now) {
+    if (soak->sample_count == SOAK_MAX_SAMPLES) {
+        for (int i = 0; i < SOAK_MAX_SAMPLES / 2; i++) {
+            soak->samples[i] = soak->samples[2 * i + 1];
+        }
+        soak->sample_count = SOAK_MAX_SAMPLES / 2;
+        soak->period_s *= 2.0;
+    }
+    struct soak_sample* sample = &soak->samples[soak->sample_count++];
+    memset(sample, 0, sizeof(*sample));
+    sample->time_s = now - soak->start_s;
+    sample->games = soak->games;
+    sample_stat(sample);
+    sample->values[SOAK_FDS] = count_fds();
+    sample->values[SOAK_FRAME_P99_MS] = histogram_percentile(&soak->frame_ms, 0.99);
+    sample->values[SOAK_DRIFT_P99_MS] = histogram_percentile(&soak->drift_ms, 0.99);
+    sample->frame_p50_ms = histogram_percentile(&soak->frame_ms, 0.50);
+    sample->frame_max_ms = soak->frame_ms.max;
+    sample->drift_p50_ms = histogram_percentile(&soak->drift_ms, 0.50);
+    sample->drift_max_ms = soak->drift_ms.max;
+    memset(&soak->frame_ms, 0, sizeof(soak->frame_ms));
+    memset(&soak->drift_ms, 0, sizeof(soak->drift_ms));
+    check_trends(soak);
+}
+
+void soak_frame(struct soak_t* soak, double frame_ms) {
+    soak->frames++;
+    histogram_add(&soak->frame_ms, frame_ms);
+    double now = now_s();
+    if (now >= soak->next_sample_s) {
+        take_sample(soak, now);
+        soak->next_sample_s = now + soak->period_s;
+    }
+}
+
+void soak_move(struct soak_t* soak, double drift_ms) {
+    soak->moves++;
+    histogram_add(&soak->drift_ms, drift_ms);
+}
+
+bool soak_finished(const struct soak_t* soak) {
+    return now_s() - soak->start_s >= soak->duration_s;
+}
+
+/**
+ * Least squares slope of a metric, per hour.
+ */
+static double slope_per_hour(const struct soak_sample* samples, int count, int metric) {
+    double mean_t = 0.0, mean_v = 0.0;
+    for (int i = 0; i < count; i++) {
+        mean_t += samples[i].time_s / count;
+        mean_v += samples[i].values[metric] / count;
+    }
+    double covariance = 0.0, variance = 0.0;
+    for (int i = 0; i < count; i++) {
+        covariance += (samples[i].time_s - mean_t) * (samples[i].values[metric] - mean_v);
+        variance += (samples[i].time_s - mean_t) * (samples[i].time_s - mean_t);
+    }
+    return (variance > 0.0) ? covariance / variance * 3600.0 : 0.0;
+}
+
+bool soak_report(struct soak_t* soak, FILE* stream) {
+    const double elapsed = now_s() - soak->start_s;
+    fprintf(stream, "Soak: %.0f s, %llu game(s), %llu move(s), %llu frame(s), %d sample(s) every %.0f s\n",
+        elapsed, (unsigned long long)soak->games, (unsigned long long)soak->moves,
+        (unsigned long long)soak->frames, soak->sample_count, soak->period_s);
+    if (soak->sample_count == 0) {
+        fprintf(stream, "Soak: no sample, run longer than the sample period\n");
+        return true;
+    }
+
+    fprintf(stream, "%9s %7s %9s %5s %7s %9s %9s %9s %9s %9s %9s\n", "time_s", "games", "rss_kb", "fds", "threads",
+        "frame_p50", "frame_p99", "frame_max", "drift_p50", "drift_p99", "drift_max");
+    const int step = (soak->sample_count + SOAK_REPORT_ROWS - 1) / SOAK_REPORT_ROWS;
+    for (int i = 0; i < soak->sample_count; i++) {
+        if (i % step != 0 && i != soak->sample_count - 1) {
+            continue;
+        }
+        const struct soak_sample* s = &soak->samples[i];
+        fprintf(stream, "%9.0f %7llu %9.0f %5.0f %7.0f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", s->time_s,
+            (unsigned long long)s->games, s->values[SOAK_RSS_KB], s->values[SOAK_FDS], s->values[SOAK_THREADS],
+            s->frame_p50_ms, s->values[SOAK_FRAME_P99_MS], s->frame_max_ms,
+            s->drift_p50_ms, s->values[SOAK_DRIFT_P99_MS], s->drift_max_ms);
+    }
+
+    // Trends after the warm-up samples
+    const int skip = (soak->sample_count > SOAK_WARMUP_SAMPLES) ? SOAK_WARMUP_SAMPLES : 0;
+    const struct soak_sample* samples = &soak->samples[skip];
+    const int count = soak->sample_count - skip;
+    fprintf(stream, "Trends (%d sample(s) after warm-up):\n", count);
+    for (int m = 0; m < SOAK_METRICS; m++) {
+        double low = samples[0].values[m], high = low;
+        for (int i = 1; i < count; i++) {
+            low = (samples[i].values[m] < low) ? samples[i].values[m] : low;
+            high = (samples[i].values[m] > high) ? samples[i].values[m] : high;
+        }
+        fprintf(stream, "  %-13s %10.2f -> %10.2f  range %.2f..%.2f  slope %+.3f/h  %llu alert(s)\n", metric_names[m],
+            samples[0].values[m], samples[count - 1].values[m], low, high, slope_per_hour(samples, count, m),
+            (unsigned long long)soak->metric_alerts[m]);
+    }
+    if (soak->alerts == 0) {
+        fprintf(stream, "Soak verdict: stable\n");
+        return true;
+    }
+    fprintf(stream, "Soak verdict: %llu alert(s), growth in", (unsigned long long)soak->alerts);
+    for (int m = 0; m < SOAK_METRICS; m++) {
+        if (soak->metric_alerts[m]) {
+            fprintf(stream, " %s", metric_names[m]);
+        }
+    }
+    fprintf(stream, "\n");
+    return false;
+}
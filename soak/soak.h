@@ -0,0 +1,136 @@
+#ifndef _SOAK_H_
+#define _SOAK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../gfx/gfx.h"
+
+/*
+ * Soak run: bot-driven games cycled through the start screen, the game and
+ * the end screen for a fixed duration, the menus being driven by synthetic
+ * keys (gfx_set_key_source). Difficulties are cycled.
+ *
+ * Every sample period the process is measured (RSS, open file descriptors,
+ * threads from /proc/self) together with the frame times and the tick
+ * drift (lateness of each move) since the previous sample. A metric that
+ * grew over the last SOAK_TREND_SAMPLES samples without ever shrinking
+ * raises an alert. Sampling reads /proc with plain syscalls and does not
+ * allocate.
+ */
+#define SOAK_DEFAULT_PERIOD_S 60.0
+#define SOAK_MAX_SAMPLES 1024      // when full, every other sample is dropped and the period doubles
+#define SOAK_TREND_SAMPLES 8
+#define SOAK_HISTOGRAM_BUCKETS 10000
+#define SOAK_BUCKET_MS 0.01        // histogram resolution, 10 us buckets up to 100 ms
+
+enum soak_metric {
+    SOAK_RSS_KB,
+    SOAK_FDS,
+    SOAK_THREADS,
+    SOAK_FRAME_P99_MS,
+    SOAK_DRIFT_P99_MS,
+    SOAK_METRICS
+};
+
+struct soak_sample {
+    double time_s;             // since the start of the run
+    uint64_t games;
+    double values[SOAK_METRICS];
+    double frame_p50_ms;
+    double frame_max_ms;
+    double drift_p50_ms;
+    double drift_max_ms;
+};
+
+struct soak_histogram {
+    uint64_t count;
+    double max;
+    uint32_t buckets[SOAK_HISTOGRAM_BUCKETS];
+};
+
+struct soak_t {
+    double duration_s;
+    double period_s;
+    double start_s;
+    double next_sample_s;
+    uint64_t games;
+    uint64_t frames;
+    uint64_t moves;
+
+    SDL_Keycode keys[8];       // menu keys still to send
+    int key_count;
+    int key_next;
+
+    struct soak_histogram frame_ms;   // current sample window
+    struct soak_histogram drift_ms;
+
+    struct soak_sample samples[SOAK_MAX_SAMPLES];
+    int sample_count;
+    bool growing[SOAK_METRICS];       // alert raised and the growth goes on
+    uint64_t alerts;
+    uint64_t metric_alerts[SOAK_METRICS];
+};
+
+/**
+ * Parse a duration: a number of seconds, or a number followed by s, m or h.
+ *
+ * @param text The duration.
+ * @param seconds Receives the duration.
+ * @return true if the duration is valid and positive.
+ */
+bool soak_parse_duration(const char* text, double* seconds);
+
+/**
+ * Start a soak run and queue the keys of the first start screen.
+ *
+ * @param duration_s Length of the run.
+ * @param period_s Time between two samples.
+ * @return A pointer to the run, or NULL if allocation fails.
+ */
+struct soak_t* soak_create(double duration_s, double period_s);
+
+void soak_destroy(struct soak_t** soak);
+
+/**
+ * Key source of the menus (gfx_key_source_fn): the queued keys, one per call.
+ */
+SDL_Keycode soak_menu_key(void* soak);
+
+/**
+ * A game ended: queue the keys to play again and choose the next difficulty.
+ */
+void soak_game_end(struct soak_t* soak);
+
+/**
+ * Record a frame of the game loop and take a sample when one is due.
+ *
+ * @param soak The run.
+ * @param frame_ms Time spent in the frame, sleep excluded.
+ */
+void soak_frame(struct soak_t* soak, double frame_ms);
+
+/**
+ * Record a move.
+ *
+ * @param soak The run.
+ * @param drift_ms Time between the move and its due time.
+ */
+void soak_move(struct soak_t* soak, double drift_ms);
+
+/**
+ * @return true once the duration of the run has elapsed.
+ */
+bool soak_finished(const struct soak_t* soak);
+
+/**
+ * Print the samples, the trend of every metric and the verdict.
+ *
+ * @param soak The run.
+ * @param stream The output stream.
+ * @return true if no alert was raised.
+ */
+bool soak_report(struct soak_t* soak, FILE* stream);
+
+#endif
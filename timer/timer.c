@@ -0,0 +1,196 @@
+#include "timer.h"
+
+#define SLOT_MASK ((uint64_t)TIMER_SLOTS - 1)
+#define LEVEL_FIRING TIMER_LEVELS   // level of the timers taken out of their slot to fire
+
+static inline unsigned level_shift(int level) {
+    return (unsigned)(level * TIMER_LEVEL_BITS);
+}
+
+static inline uint64_t rotate_right(uint64_t bits, unsigned count) {
+    count &= 63;
+    return count ? (bits >> count) | (bits << (64 - count)) : bits;
+}
+
+/**
+ * Append a timer to the slot of its expiry, relative to the current tick.
+ */
+static void insert(struct timer_wheel_t* wheel, struct timer_event* timer) {
+    uint64_t expires = (timer->expires < wheel->now) ? wheel->now : timer->expires;
+    uint64_t delta = expires - wheel->now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (uint64_t)1 << level_shift(level + 1)) {
+        level++;
+    }
+    if (level == TIMER_LEVELS - 1 && delta >= (uint64_t)1 << level_shift(TIMER_LEVELS)) {
+        // Out of range: wait in the furthest slot, cascaded again from there
+        expires = wheel->now + ((uint64_t)1 << level_shift(TIMER_LEVELS)) - 1;
+    }
+    unsigned slot = (unsigned)((expires >> level_shift(level)) & SLOT_MASK);
+
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->next = NULL;
+    timer->link = wheel->tails[level][slot];
+    *timer->link = timer;
+    wheel->tails[level][slot] = &timer->next;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+}
+
+static void unlink_timer(struct timer_wheel_t* wheel, struct timer_event* timer) {
+    *timer->link = timer->next;
+    if (timer->next) {
+        timer->next->link = timer->link;
+    }
+    if (timer->level != LEVEL_FIRING) {
+        if (!timer->next) {
+            wheel->tails[timer->level][timer->slot] = timer->link;
+        }
+        if (!wheel->slots[timer->level][timer->slot]) {
+            wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+        }
+    }
+    timer->next = NULL;
+    timer->link = NULL;
+}
+
+/**
+ * Detach the list of a slot and leave the slot empty.
+ */
+static struct timer_event* take_slot(struct timer_wheel_t* wheel, int level, unsigned slot) {
+    struct timer_event* list = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->tails[level][slot] = &wheel->slots[level][slot];
+    wheel->occupied[level] &= ~((uint64_t)1 << slot);
+    return list;
+}
+
+/**
+ * Move the timers of a slot of an upper level to the lower levels.
+ */
+static void cascade(struct timer_wheel_t* wheel, int level, unsigned slot) {
+    struct timer_event* timer = take_slot(wheel, level, slot);
+    while (timer) {
+        struct timer_event* next = timer->next;
+        insert(wheel, timer);
+        timer = next;
+    }
+}
+
+void timer_wheel_init(struct timer_wheel_t* wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->pending = 0;
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        wheel->occupied[level] = 0;
+        for (unsigned slot = 0; slot < TIMER_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+            wheel->tails[level][slot] = &wheel->slots[level][slot];
+        }
+    }
+}
+
+void timer_init(struct timer_event* timer, timer_fn callback, void* data) {
+    *timer = (struct timer_event){ .callback = callback, .data = data };
+}
+
+void timer_schedule_at(struct timer_wheel_t* wheel, struct timer_event* timer, uint64_t tick) {
+    if (timer_pending(timer)) {
+        unlink_timer(wheel, timer);
+        wheel->pending--;
+    }
+    timer->expires = tick;
+    insert(wheel, timer);
+    wheel->pending++;
+}
+
+void timer_schedule(struct timer_wheel_t* wheel, struct timer_event* timer, uint64_t delay) {
+    timer_schedule_at(wheel, timer, wheel->now + delay);
+}
+
+void timer_cancel(struct timer_wheel_t* wheel, struct timer_event* timer) {
+    if (timer_pending(timer)) {
+        unlink_timer(wheel, timer);
+        wheel->pending--;
+    }
+}
+
+size_t timer_wheel_advance(struct timer_wheel_t* wheel, uint64_t tick) {
+    size_t fired = 0;
+    while (wheel->now <= tick) {
+        if (wheel->pending == 0) {
+            wheel->now = tick + 1;
+            break;
+        }
+
+        unsigned index = (unsigned)(wheel->now & SLOT_MASK);
+        if (index == 0) {
+            // Level 0 wrapped around: bring down the next slot of each level that wrapped too
+            for (int level = 1; level < TIMER_LEVELS; level++) {
+                unsigned slot = (unsigned)((wheel->now >> level_shift(level)) & SLOT_MASK);
+                cascade(wheel, level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        // The callbacks see the next tick as current, so that a timer they
+        // schedule never lands in the slot being fired
+        struct timer_event* batch = take_slot(wheel, 0, index);
+        if (batch) {
+            batch->link = &batch;
+            for (struct timer_event* timer = batch; timer; timer = timer->next) {
+                timer->level = LEVEL_FIRING;
+            }
+        }
+        wheel->now++;
+        while (batch) {
+            struct timer_event* timer = batch;
+            unlink_timer(wheel, timer);
+            wheel->pending--;
+            fired++;
+            timer->callback(timer, timer->data);
+        }
+
+        // Jump to the next non-empty slot of level 0, or to its wrap around
+        uint64_t next = (wheel->now | SLOT_MASK) + 1;
+        unsigned from = (unsigned)(wheel->now & SLOT_MASK);
+        uint64_t ahead = from ? wheel->occupied[0] >> from << from : 0;
+        if (ahead) {
+            next = (wheel->now & ~SLOT_MASK) | (uint64_t)__builtin_ctzll(ahead);
+        }
+        if (from != 0 && next > wheel->now) {
+            wheel->now = (next > tick + 1) ? tick + 1 : next;
+        }
+    }
+    return fired;
+}
+
+uint64_t timer_wheel_next(const struct timer_wheel_t* wheel) {
+    if (wheel->pending == 0) {
+        return TIMER_NONE;
+    }
+    uint64_t next = TIMER_NONE;
+    unsigned index = (unsigned)(wheel->now & SLOT_MASK);
+    if (wheel->occupied[0]) {
+        next = (uint64_t)__builtin_ctzll(rotate_right(wheel->occupied[0], index));
+    }
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+        if (!wheel->occupied[level]) {
+            continue;
+        }
+        // The current slot of a level is cascaded when the level is reached,
+        // at the first tick of its block: past that tick, the current slot
+        // holds the timers of a full turn later
+        uint64_t block = wheel->now >> level_shift(level);
+        uint64_t first = (wheel->now & (((uint64_t)1 << level_shift(level)) - 1)) ? 1 : 0;
+        unsigned from = (unsigned)((block + first) & SLOT_MASK);
+        uint64_t steps = (uint64_t)__builtin_ctzll(rotate_right(wheel->occupied[level], from)) + first;
+        uint64_t start = (block + steps) << level_shift(level);
+        uint64_t delta = start - wheel->now;
+        if (delta < next) {
+            next = delta;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,127 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timer wheel keyed on simulation ticks (TIMER_TICK_MS each).
+ *
+ * TIMER_LEVELS wheels of TIMER_SLOTS slots: level 0 holds the timers due in
+ * the next 64 ticks, one slot per tick; level n holds the later ones, one
+ * slot per 64^n ticks, and a slot of level n is moved down ("cascaded") when
+ * level n-1 wraps around to it. Timers further than 64^TIMER_LEVELS ticks
+ * wait in the last level and are cascaded again until they are in range.
+ *
+ * Timers are intrusive (embedded by the caller, never allocated) and sit in
+ * a doubly linked slot list: scheduling and cancelling are O(1). An
+ * occupancy bitmap per level lets timer_wheel_advance jump over empty slots,
+ * so advancing costs one step per non-empty slot of level 0 and one per 64
+ * ticks elapsed, whatever the number of pending timers.
+ *
+ * Timers fire in order of expiry. As firing only depends on tick numbers
+ * and on the order of the calls, the same schedule replays identically.
+ */
+#define TIMER_TICK_MS 1
+#define TIMER_LEVEL_BITS 6
+#define TIMER_SLOTS (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVELS 4
+#define TIMER_NONE UINT64_MAX   // timer_wheel_next: nothing pending
+
+struct timer_event;
+
+/**
+ * Called when a timer expires. The timer is no longer pending and may be
+ * scheduled again from the callback.
+ */
+typedef void (*timer_fn)(struct timer_event* timer, void* data);
+
+struct timer_event {
+    struct timer_event* next;
+    struct timer_event** link;   // pointer to this timer in the previous node, NULL when not pending
+    uint64_t expires;            // tick of expiry
+    timer_fn callback;
+    void* data;
+    uint8_t level;
+    uint8_t slot;
+};
+
+struct timer_wheel_t {
+    uint64_t now;                // next tick to process: every timer due before it has fired
+    size_t pending;
+    uint64_t occupied[TIMER_LEVELS];   // one bit per non-empty slot
+    struct timer_event* slots[TIMER_LEVELS][TIMER_SLOTS];
+    struct timer_event** tails[TIMER_LEVELS][TIMER_SLOTS];
+};
+
+/**
+ * Empty a wheel.
+ *
+ * @param wheel The wheel.
+ * @param now The first tick of the wheel.
+ */
+void timer_wheel_init(struct timer_wheel_t* wheel, uint64_t now);
+
+/**
+ * Prepare a timer, not pending.
+ *
+ * @param timer The timer.
+ * @param callback Called on expiry.
+ * @param data Passed to the callback.
+ */
+void timer_init(struct timer_event* timer, timer_fn callback, void* data);
+
+/**
+ * Schedule a timer at an absolute tick, rescheduling it if it is pending.
+ * A tick already processed fires on the next advance.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ * @param tick The tick of expiry.
+ */
+void timer_schedule_at(struct timer_wheel_t* wheel, struct timer_event* timer, uint64_t tick);
+
+/**
+ * Schedule a timer a number of ticks after the current tick of the wheel.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ * @param delay Ticks from now; 0 fires on the next advance.
+ */
+void timer_schedule(struct timer_wheel_t* wheel, struct timer_event* timer, uint64_t delay);
+
+/**
+ * Cancel a timer. Nothing happens if it is not pending.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ */
+void timer_cancel(struct timer_wheel_t* wheel, struct timer_event* timer);
+
+static inline bool timer_pending(const struct timer_event* timer) {
+    return timer->link != NULL;
+}
+
+/**
+ * Process the ticks up to and including a tick, firing the timers due.
+ *
+ * @param wheel The wheel.
+ * @param tick The last tick to process.
+ * @return The number of timers fired.
+ */
+size_t timer_wheel_advance(struct timer_wheel_t* wheel, uint64_t tick);
+
+/**
+ * Lower bound of the ticks from the current tick to the next expiry: no timer
+ * fires before it. A timer of an upper level only counts from the tick its
+ * slot is cascaded, which can be well before it is due, so the result is
+ * exact only when the level 0 timers are the only ones pending or the first
+ * ones due. A caller sleeping until then must advance the wheel and ask again.
+ *
+ * @param wheel The wheel.
+ * @return The number of ticks, or TIMER_NONE if no timer is pending.
+ */
+uint64_t timer_wheel_next(const struct timer_wheel_t* wheel);
+
+#endif
@@ -0,0 +1,392 @@
+/**
+ * Cell layout benchmark: the access patterns of the game run on boards in
+ * every layout of board_t (row-major, 8x8 tiles, Z-order) and on a chunked
+ * board, on the same cells, and are reported in ns per cell access relative
+ * to row-major.
+ *
+ *   lookahead  head walking the board, testing the 3 cells ahead each move
+ *   flood      breadth-first flood fill of the free cells around the center
+ *   search     bot lookahead: every cell within 6 moves of random heads
+ *   viewport   160x100 cell window (1280x800 at zoom 8) read row by row
+ *
+ * A last run walks snakes across a sparse world with scattered food, far
+ * too large for a dense grid, and reports the chunks in use and pooled.
+ *
+ * Usage: ./boardbench [side...]   (default: 1024 2048 4096 8192)
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../board/board.h"
+#include "../board/chunked.h"
+
+#define WALL_PERCENT 5
+#define LOOKAHEAD_MOVES 4000000
+#define FLOOD_CELLS (1 << 22)      // visits, the fill stops there on large boards
+#define SEARCH_HEADS 100000
+#define SEARCH_RADIUS 6
+#define VIEWPORT_WIDTH 160
+#define VIEWPORT_HEIGHT 100
+#define VIEWPORT_FRAMES 2000
+#define SPARSE_SIDE (1 << 30)      // cells per side of the sparse world
+#define SPARSE_FOOD 4096
+#define SPARSE_SNAKES 64
+#define SPARSE_LENGTH 512
+#define SPARSE_MOVES 20000000
+#define LAYOUTS (BOARD_LAYOUTS + 1)   // the board_t layouts, then the chunked board
+
+enum cell {
+    CELL_EMPTY,
+    CELL_WALL,
+    CELL_SNAKE,
+    CELL_VISITED
+};
+
+enum pattern {
+    PATTERN_LOOKAHEAD,
+    PATTERN_FLOOD,
+    PATTERN_SEARCH,
+    PATTERN_VIEWPORT,
+    PATTERNS
+};
+
+static const char* pattern_names[PATTERNS] = { "lookahead", "flood", "search", "viewport" };
+
+struct point {
+    int x, y;
+};
+
+/**
+ * A dense board in one of its layouts, or a chunked board.
+ */
+struct bench_board {
+    struct board_t* dense;
+    struct chunked_board_t* chunked;
+    int width, height;
+};
+
+static inline uint8_t cell_get(struct bench_board* board, int x, int y) {
+    return board->chunked ? chunked_get(board->chunked, x, y) : board_get(board->dense, x, y);
+}
+
+static inline void cell_set(struct bench_board* board, int x, int y, uint8_t value) {
+    if (board->chunked) {
+        chunked_set(board->chunked, x, y, value);
+    } else {
+        board_set(board->dense, x, y, value);
+    }
+}
+
+// Keeps the results of measured loops alive
+static volatile long sink;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+/**
+ * Same walls on every layout: a border ring and WALL_PERCENT of random cells.
+ */
+static void fill_walls(struct bench_board* board) {
+    unsigned int seed = 1;
+    for (int y = 0; y < board->height; y++) {
+        for (int x = 0; x < board->width; x++) {
+            bool border = (x == 0 || y == 0 || x == board->width - 1 || y == board->height - 1);
+            bool wall = border || (int)(rand_r(&seed) % 100) < WALL_PERCENT;
+            cell_set(board, x, y, wall ? CELL_WALL : CELL_EMPTY);
+        }
+    }
+}
+
+/**
+ * Walk a head across the board: test the cells ahead, turn to a free one
+ * (straight first), mark the body and clear the tail 64 moves later.
+ */
+static long bench_lookahead(struct bench_board* board) {
+    static const int dx[] = { 1, 0, -1, 0 };
+    static const int dy[] = { 0, 1, 0, -1 };
+    struct point body[64] = { { 0, 0 } };
+    unsigned int seed = 2;
+    struct point head = { board->width / 2, board->height / 2 };
+    int dir = 0;
+    long accesses = 0, blocked = 0;
+    for (long move = 0; move < LOOKAHEAD_MOVES; move++) {
+        int turns[3] = { dir, (dir + 1) & 3, (dir + 3) & 3 };
+        if (rand_r(&seed) % 8 == 0) {
+            turns[0] = turns[1 + rand_r(&seed) % 2];
+            turns[1] = dir;
+        }
+        int chosen = -1;
+        for (int i = 0; i < 3; i++) {
+            accesses++;
+            if (cell_get(board, head.x + dx[turns[i]], head.y + dy[turns[i]]) == CELL_EMPTY) {
+                chosen = turns[i];
+                break;
+            }
+        }
+        if (chosen < 0) {
+            // Dead end: jump elsewhere, as a new game would start
+            blocked++;
+            head = (struct point){ 1 + (int)(rand_r(&seed) % (unsigned)(board->width - 2)),
+                1 + (int)(rand_r(&seed) % (unsigned)(board->height - 2)) };
+            continue;
+        }
+        dir = chosen;
+        head.x += dx[dir];
+        head.y += dy[dir];
+        struct point* tail = &body[move & 63];
+        if (move >= 64 && cell_get(board, tail->x, tail->y) == CELL_SNAKE) {
+            cell_set(board, tail->x, tail->y, CELL_EMPTY);
+        }
+        *tail = head;
+        cell_set(board, head.x, head.y, CELL_SNAKE);
+        accesses += 2;
+    }
+    for (int i = 0; i < 64; i++) {
+        if (cell_get(board, body[i].x, body[i].y) == CELL_SNAKE) {
+            cell_set(board, body[i].x, body[i].y, CELL_EMPTY);
+        }
+    }
+    sink += blocked;
+    return accesses;
+}
+
+static long bench_flood(struct bench_board* board, struct point* queue) {
+    static const int dx[] = { 1, 0, -1, 0 };
+    static const int dy[] = { 0, 1, 0, -1 };
+    long accesses = 0;
+    int head = 0, count = 0;
+    struct point start = { board->width / 2, board->height / 2 };
+    cell_set(board, start.x, start.y, CELL_VISITED);
+    queue[count++] = start;
+    while (head < count) {
+        struct point cell = queue[head++];
+        for (int d = 0; d < 4; d++) {
+            int x = cell.x + dx[d], y = cell.y + dy[d];
+            accesses++;
+            if (cell_get(board, x, y) == CELL_EMPTY && count < FLOOD_CELLS) {
+                cell_set(board, x, y, CELL_VISITED);
+                accesses++;
+                queue[count++] = (struct point){ x, y };
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        cell_set(board, queue[i].x, queue[i].y, CELL_EMPTY);
+    }
+    sink += count;
+    return accesses;
+}
+
+static long bench_search(struct bench_board* board) {
+    unsigned int seed = 3;
+    long accesses = 0, free_cells = 0;
+    for (int i = 0; i < SEARCH_HEADS; i++) {
+        int cx = SEARCH_RADIUS + (int)(rand_r(&seed) % (unsigned)(board->width - 2 * SEARCH_RADIUS));
+        int cy = SEARCH_RADIUS + (int)(rand_r(&seed) % (unsigned)(board->height - 2 * SEARCH_RADIUS));
+        for (int dy = -SEARCH_RADIUS; dy <= SEARCH_RADIUS; dy++) {
+            int span = SEARCH_RADIUS - abs(dy);
+            for (int dx = -span; dx <= span; dx++) {
+                free_cells += (cell_get(board, cx + dx, cy + dy) == CELL_EMPTY);
+                accesses++;
+            }
+        }
+    }
+    sink += free_cells;
+    return accesses;
+}
+
+static long bench_viewport(struct bench_board* board) {
+    long accesses = 0, walls = 0;
+    int width = (board->width < VIEWPORT_WIDTH) ? board->width : VIEWPORT_WIDTH;
+    int height = (board->height < VIEWPORT_HEIGHT) ? board->height : VIEWPORT_HEIGHT;
+    for (int frame = 0; frame < VIEWPORT_FRAMES; frame++) {
+        // The camera follows a head moving diagonally, a cell per frame
+        int x0 = frame % (board->width - width + 1);
+        int y0 = frame % (board->height - height + 1);
+        for (int y = y0; y < y0 + height; y++) {
+            for (int x = x0; x < x0 + width; x++) {
+                walls += (cell_get(board, x, y) == CELL_WALL);
+            }
+        }
+        accesses += (long)width * height;
+    }
+    sink += walls;
+    return accesses;
+}
+
+static double run_pattern(enum pattern pattern, struct bench_board* board, struct point* queue, long* accesses) {
+    double start = now_ms();
+    switch (pattern) {
+    case PATTERN_LOOKAHEAD:
+        *accesses = bench_lookahead(board);
+        break;
+    case PATTERN_FLOOD:
+        *accesses = bench_flood(board, queue);
+        break;
+    case PATTERN_SEARCH:
+        *accesses = bench_search(board);
+        break;
+    default:
+        *accesses = bench_viewport(board);
+        break;
+    }
+    return now_ms() - start;
+}
+
+static bool bench_side(int side, struct point* queue) {
+    double ns[LAYOUTS][PATTERNS];
+    size_t bytes[LAYOUTS];
+    for (int layout = 0; layout < LAYOUTS; layout++) {
+        struct bench_board board = { NULL, NULL, side, side };
+        if (layout < BOARD_LAYOUTS) {
+            board.dense = board_create(side, side, (enum board_layout)layout);
+        } else {
+            board.chunked = chunked_create(side, side);
+        }
+        if (!board.dense && !board.chunked) {
+            return false;
+        }
+        fill_walls(&board);
+        for (int pattern = 0; pattern < PATTERNS; pattern++) {
+            long accesses;
+            double ms = run_pattern((enum pattern)pattern, &board, queue, &accesses);
+            ns[layout][pattern] = ms * 1.0e6 / (double)accesses;
+        }
+        if (board.dense) {
+            bytes[layout] = board.dense->size;
+            board_destroy(&board.dense);
+        } else {
+            struct chunked_stats stats;
+            chunked_get_stats(board.chunked, &stats);
+            bytes[layout] = stats.bytes;
+            chunked_destroy(&board.chunked);
+        }
+    }
+
+    printf("%dx%d\n", side, side);
+    printf("  %-8s %10s", "layout", "MiB");
+    for (int pattern = 0; pattern < PATTERNS; pattern++) {
+        printf(" %18s", pattern_names[pattern]);
+    }
+    printf("\n");
+    for (int layout = 0; layout < LAYOUTS; layout++) {
+        const char* name = (layout < BOARD_LAYOUTS) ? board_layout_name((enum board_layout)layout) : "chunked";
+        printf("  %-8s %10.1f", name, bytes[layout] / 1048576.0);
+        for (int pattern = 0; pattern < PATTERNS; pattern++) {
+            printf(" %8.2f ns x%-6.2f", ns[layout][pattern], ns[layout][pattern] / ns[BOARD_ROW_MAJOR][pattern]);
+        }
+        printf("\n");
+    }
+    return true;
+}
+
+/**
+ * Snakes wandering a chunked world: the chunks they leave return to the pool
+ * and are reused for the ones they enter.
+ */
+static bool bench_sparse(void) {
+    static const int dx[] = { 1, 0, -1, 0 };
+    static const int dy[] = { 0, 1, 0, -1 };
+    struct chunked_board_t* world = chunked_create(SPARSE_SIDE, SPARSE_SIDE);
+    struct point* bodies = malloc(SPARSE_SNAKES * SPARSE_LENGTH * sizeof(struct point));
+    if (!world || !bodies) {
+        chunked_destroy(&world);
+        free(bodies);
+        return false;
+    }
+    unsigned int seed = 4;
+    for (int i = 0; i < SPARSE_FOOD; i++) {
+        chunked_set(world, (int)(rand_r(&seed) % SPARSE_SIDE), (int)(rand_r(&seed) % SPARSE_SIDE), CELL_WALL);
+    }
+    struct point heads[SPARSE_SNAKES];
+    int dirs[SPARSE_SNAKES];
+    for (int i = 0; i < SPARSE_SNAKES; i++) {
+        heads[i] = (struct point){ (int)(rand_r(&seed) % (SPARSE_SIDE / 2)) + SPARSE_SIDE / 4,
+            (int)(rand_r(&seed) % (SPARSE_SIDE / 2)) + SPARSE_SIDE / 4 };
+        dirs[i] = i & 3;
+        for (int j = 0; j < SPARSE_LENGTH; j++) {
+            bodies[i * SPARSE_LENGTH + j] = heads[i];
+        }
+        chunked_set(world, heads[i].x, heads[i].y, CELL_SNAKE);
+    }
+
+    struct chunked_stats stats;
+    chunked_get_stats(world, &stats);
+    size_t peak_live = stats.live;
+    long accesses = 0;
+    double start = now_ms();
+    for (long move = 0; move < SPARSE_MOVES; move++) {
+        int snake = (int)(move % SPARSE_SNAKES);
+        long step = move / SPARSE_SNAKES;
+        struct point* head = &heads[snake];
+        int dir = dirs[snake];
+        if (rand_r(&seed) % 16 == 0) {
+            dir = (dir + 1 + 2 * (int)(rand_r(&seed) % 2)) & 3;
+        }
+        for (int turn = 0; turn < 4 && chunked_get(world, head->x + dx[dir], head->y + dy[dir]) != CELL_EMPTY; turn++) {
+            dir = (dir + 1) & 3;
+            accesses++;
+        }
+        accesses++;
+        dirs[snake] = dir;
+        head->x += dx[dir];
+        head->y += dy[dir];
+        struct point* tail = &bodies[snake * SPARSE_LENGTH + step % SPARSE_LENGTH];
+        if (step >= SPARSE_LENGTH) {
+            chunked_set(world, tail->x, tail->y, CELL_EMPTY);
+        }
+        *tail = *head;
+        chunked_set(world, head->x, head->y, CELL_SNAKE);
+        accesses += 2;
+        if (world->live > peak_live) {
+            peak_live = world->live;
+        }
+    }
+    double ms = now_ms() - start;
+
+    chunked_get_stats(world, &stats);
+    printf("sparse world %dx%d (%.0f TiB as a dense grid), %d snakes of %d cells, %d food\n",
+        SPARSE_SIDE, SPARSE_SIDE, (double)SPARSE_SIDE * SPARSE_SIDE / 1099511627776.0,
+        SPARSE_SNAKES, SPARSE_LENGTH, SPARSE_FOOD);
+    printf("  %d moves %10.2f ns/access, chunks: %zu live (peak %zu), %zu pooled, %.1f MiB\n",
+        SPARSE_MOVES, ms * 1.0e6 / (double)accesses, stats.live, peak_live, stats.pooled,
+        stats.bytes / 1048576.0);
+    chunked_destroy(&world);
+    free(bodies);
+    return true;
+}
+
+int main(int argc, char const* argv[]) {
+    static const int default_sides[] = { 1024, 2048, 4096, 8192 };
+    struct point* queue = malloc(FLOOD_CELLS * sizeof(struct point));
+    if (!queue) {
+        fprintf(stderr, "Failed to allocate memory for the flood fill queue\n");
+        return EXIT_FAILURE;
+    }
+
+    int count = (argc > 1) ? argc - 1 : (int)(sizeof(default_sides) / sizeof(default_sides[0]));
+    for (int i = 0; i < count; i++) {
+        int side = (argc > 1) ? atoi(argv[i + 1]) : default_sides[i];
+        if (side < 2 * SEARCH_RADIUS + 2) {
+            fprintf(stderr, "Usage: %s [side >= %d]...\n", argv[0], 2 * SEARCH_RADIUS + 2);
+            free(queue);
+            return EXIT_FAILURE;
+        }
+        if (!bench_side(side, queue)) {
+            fprintf(stderr, "Failed to allocate a %dx%d board\n", side, side);
+            free(queue);
+            return EXIT_FAILURE;
+        }
+    }
+    free(queue);
+    if (!bench_sparse()) {
+        fprintf(stderr, "Failed to allocate the sparse world\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
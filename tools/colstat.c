@@ -0,0 +1,184 @@
+/**
+ * Aggregates over a columnar export (SNAKE_EXPORT, diffcheck -x): games per
+ * outcome and difficulty, score and length statistics, and over the ticks
+ * table the mean length and food count and the decision time percentiles.
+ * Columns are mapped and scanned in place, without parsing.
+ *
+ * Usage: ./colstat dir
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../export/export.h"
+
+#define DECISION_BUCKETS 65536   // 1 us buckets, longer decisions go to the last one
+
+static const char* outcome_names[EXPORT_OUTCOMES] = { "won", "wall", "self", "quit" };
+
+struct summary {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min, max;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+static void summary_add(struct summary* summary, uint64_t value) {
+    if (summary->count == 0 || value < summary->min) {
+        summary->min = value;
+    }
+    if (value > summary->max) {
+        summary->max = value;
+    }
+    summary->sum += value;
+    summary->count++;
+}
+
+static void summary_print(const char* name, const struct summary* summary) {
+    if (summary->count == 0) {
+        return;
+    }
+    printf("  %-12s mean %10.1f  min %8llu  max %8llu\n", name, (double)summary->sum / summary->count,
+        (unsigned long long)summary->min, (unsigned long long)summary->max);
+}
+
+static const char* difficulty_name(unsigned int difficulty) {
+    static const char* names[] = { "easy", "normal", "hard" };
+    if (difficulty < sizeof(names) / sizeof(names[0])) {
+        return names[difficulty];
+    }
+    return (difficulty == EXPORT_SIMULATED) ? "simulated" : "unknown";
+}
+
+static uint64_t scan_games(const struct export_table* games) {
+    const uint8_t* difficulty = games->columns[EXPORT_GAME_DIFFICULTY];
+    const uint8_t* outcome = games->columns[EXPORT_GAME_OUTCOME];
+    const uint32_t* ticks = games->columns[EXPORT_GAME_TICKS];
+    const uint32_t* score = games->columns[EXPORT_GAME_SCORE];
+    const uint32_t* length = games->columns[EXPORT_GAME_LENGTH];
+    const uint32_t* duration = games->columns[EXPORT_GAME_DURATION_MS];
+
+    struct summary scores = { 0 }, lengths = { 0 }, moves = { 0 }, durations = { 0 };
+    uint64_t outcomes[EXPORT_OUTCOMES + 1] = { 0 };
+    uint64_t per_difficulty[256] = { 0 }, score_per_difficulty[256] = { 0 };
+    for (uint64_t i = 0; i < games->rows; i++) {
+        summary_add(&scores, score[i]);
+        summary_add(&lengths, length[i]);
+        summary_add(&moves, ticks[i]);
+        summary_add(&durations, duration[i]);
+        outcomes[outcome[i] < EXPORT_OUTCOMES ? outcome[i] : EXPORT_OUTCOMES]++;
+        per_difficulty[difficulty[i]]++;
+        score_per_difficulty[difficulty[i]] += score[i];
+    }
+
+    printf("games: %llu\n", (unsigned long long)games->rows);
+    if (games->rows == 0) {
+        return 0;
+    }
+    summary_print("score", &scores);
+    summary_print("length", &lengths);
+    summary_print("ticks", &moves);
+    summary_print("duration_ms", &durations);
+    printf("  outcome     ");
+    for (int o = 0; o < EXPORT_OUTCOMES; o++) {
+        printf(" %s %llu (%.1f%%)", outcome_names[o], (unsigned long long)outcomes[o], 100.0 * outcomes[o] / games->rows);
+    }
+    printf("\n");
+    for (int d = 0; d < 256; d++) {
+        if (per_difficulty[d] > 0) {
+            printf("  %-12s %llu game(s), mean score %.1f\n", difficulty_name((unsigned int)d),
+                (unsigned long long)per_difficulty[d], (double)score_per_difficulty[d] / per_difficulty[d]);
+        }
+    }
+    return games->rows;
+}
+
+static uint32_t percentile(const uint64_t* histogram, uint64_t count, double fraction) {
+    uint64_t rank = (uint64_t)(fraction * (count - 1));
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < DECISION_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (seen > rank) {
+            return bucket;
+        }
+    }
+    return DECISION_BUCKETS - 1;
+}
+
+static uint64_t scan_ticks(const struct export_table* ticks) {
+    const uint32_t* length = ticks->columns[EXPORT_TICK_LENGTH];
+    const uint32_t* score = ticks->columns[EXPORT_TICK_SCORE];
+    const uint16_t* food = ticks->columns[EXPORT_TICK_FOOD];
+    const uint32_t* decision = ticks->columns[EXPORT_TICK_DECISION_US];
+
+    // One pass per column: each loop reads a single contiguous array
+    uint64_t length_sum = 0, food_sum = 0;
+    uint32_t max_score = 0, max_decision = 0;
+    for (uint64_t i = 0; i < ticks->rows; i++) {
+        length_sum += length[i];
+    }
+    for (uint64_t i = 0; i < ticks->rows; i++) {
+        max_score = (score[i] > max_score) ? score[i] : max_score;
+    }
+    for (uint64_t i = 0; i < ticks->rows; i++) {
+        food_sum += food[i];
+    }
+    uint64_t* histogram = calloc(DECISION_BUCKETS, sizeof(uint64_t));
+    uint64_t decisions = 0;
+    if (histogram) {
+        for (uint64_t i = 0; i < ticks->rows; i++) {
+            const uint32_t us = decision[i];
+            histogram[us < DECISION_BUCKETS ? us : DECISION_BUCKETS - 1]++;
+            max_decision = (us > max_decision) ? us : max_decision;
+        }
+        decisions = ticks->rows - histogram[0];
+    }
+
+    printf("ticks: %llu\n", (unsigned long long)ticks->rows);
+    if (ticks->rows > 0) {
+        printf("  length       mean %10.1f\n", (double)length_sum / ticks->rows);
+        printf("  food         mean %10.2f\n", (double)food_sum / ticks->rows);
+        printf("  score        max  %10u\n", max_score);
+    }
+    if (decisions > 0) {
+        // Ticks without a bot decision (0 us) are left out
+        histogram[0] = 0;
+        printf("  decision_us  p50 %u  p99 %u  max %u (%llu decision(s))\n",
+            percentile(histogram, decisions, 0.50), percentile(histogram, decisions, 0.99), max_decision,
+            (unsigned long long)decisions);
+    }
+    free(histogram);
+    return ticks->rows;
+}
+
+int main(int argc, char const* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s dir\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct export_table games, ticks;
+    if (!export_table_open(argv[1], EXPORT_GAMES, &games)) {
+        return EXIT_FAILURE;
+    }
+    if (!export_table_open(argv[1], EXPORT_TICKS, &ticks)) {
+        export_table_close(&games);
+        return EXIT_FAILURE;
+    }
+
+    double start = now_ms();
+    uint64_t rows = scan_games(&games) + scan_ticks(&ticks);
+    double elapsed = now_ms() - start;
+    printf("scanned %llu row(s) in %.1f ms (%.0f rows/s)\n", (unsigned long long)rows, elapsed,
+        rows * 1000.0 / (elapsed > 0.0 ? elapsed : 1.0));
+
+    export_table_close(&games);
+    export_table_close(&ticks);
+    return EXIT_SUCCESS;
+}
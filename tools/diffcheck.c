@@ -0,0 +1,512 @@
+/**
+ * Differential checker of the game engines: runs the reference engine and a
+ * candidate side by side on the same boards, seeds and inputs, comparing
+ * their states after every tick. The first diverging input is minimized
+ * (delta debugging) and saved as a repro file that can be replayed.
+ *
+ * The games of the reference engine can be exported (-x) as columnar tables,
+ * one tick row per move.
+ *
+ * Usage: ./diffcheck [-e engine] [-t ticks] [-j threads] [-s seed] [-o repro] [-x dir]
+ *        ./diffcheck [-e engine] -r repro
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../engine/engine.h"
+#include "../export/export.h"
+
+#define DEFAULT_TICKS 10000000L
+#define MAX_MOVES 4096
+#define MAX_THREADS 256
+#define DEFAULT_REPRO "diffcheck.repro"
+
+static const char move_names[] = { [left] = 'L', [up] = 'U', [down] = 'D', [right] = 'R' };
+
+struct divergence {
+    int tick;          // index of the move after which the states differ, -1 before the first move
+    char diff[128];
+};
+
+struct failure {
+    long index;        // case index, the lowest one is kept
+    unsigned int case_seed;
+    int count;
+    char moves[MAX_MOVES];
+    struct divergence divergence;
+};
+
+/**
+ * Game played by the reference engine, for the export.
+ */
+struct recording {
+    struct export_game game;
+    struct export_tick ticks[MAX_MOVES];
+};
+
+struct checker {
+    const struct engine_ops* candidate;
+    struct export_t* export;    // NULL unless -x
+    unsigned int seed;
+    long target_ticks;
+    atomic_long next_case;
+    atomic_long ticks;
+    atomic_bool stop;
+    pthread_mutex_t lock;
+    bool failed;
+    struct failure failure;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+/**
+ * Seed of a case: spreads consecutive indices over the whole seed space.
+ */
+static unsigned int case_seed_of(unsigned int seed, long index) {
+    uint64_t z = seed + (uint64_t)index * UINT64_C(0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return (unsigned int)(z ^ (z >> 31));
+}
+
+/**
+ * Board of a case: small boards so that games end, eat and spawn often.
+ */
+static void case_config(unsigned int case_seed, struct engine_config* config) {
+    unsigned int state = case_seed;
+    memset(config, 0, sizeof(*config));
+    config->border = 1 + rand_r(&state) % 2;
+    config->columns = 12 + rand_r(&state) % 37;
+    config->rows = 12 + rand_r(&state) % 29;
+    config->seed = (unsigned int)rand_r(&state);
+    config->food_interval = 1 + rand_r(&state) % 40;
+    config->max_food = 1 + rand_r(&state) % 8;
+    engine_config_layout(config);
+
+    const int x_range = config->columns - 2 * config->border;
+    const int y_range = config->rows - 2 * config->border;
+    const int obstacles = rand_r(&state) % (ENGINE_MAX_OBSTACLES / 2);
+    for (int i = 0; i < obstacles; i++) {
+        int x = config->border + rand_r(&state) % x_range;
+        int y = config->border + rand_r(&state) % y_range;
+        bool on_snake = (x == config->head_x && y >= config->head_y - 2 && y <= config->head_y);
+        if (!on_snake) {
+            config->obstacles[config->obstacle_count++] = (struct engine_point){ x, y };
+        }
+    }
+    // Obstacles reduce the winning length
+    engine_config_layout(config);
+}
+
+/**
+ * Next random input, steered by the reference state so that games last:
+ * mostly straight ahead, turning towards a free cell when blocked and
+ * sometimes at random, with a few unconditional (possibly fatal) moves.
+ */
+static enum direction random_move(const struct engine_state* state, enum direction dir, unsigned int* seed) {
+    static const int dx[] = { [left] = -1, [up] = 0, [down] = 0, [right] = 1 };
+    static const int dy[] = { [left] = 0, [up] = -1, [down] = 1, [right] = 0 };
+    const int roll = rand_r(seed) % 100;
+    if (roll < 2) {
+        return (enum direction)(rand_r(seed) % 4);
+    }
+
+    const struct engine_point head = state->body[state->length - 1];
+    enum direction free_moves[4];
+    int free_count = 0;
+    bool ahead_free = false;
+    for (int d = 0; d < 4; d++) {
+        if (d + dir == 3) {
+            continue;
+        }
+        uint8_t cell = state->cells[(head.y + dy[d]) * state->columns + head.x + dx[d]];
+        if (cell == ENGINE_CELL_EMPTY || cell == ENGINE_CELL_FOOD) {
+            free_moves[free_count++] = (enum direction)d;
+            ahead_free |= (d == (int)dir);
+        }
+    }
+    if ((ahead_free && roll < 85) || free_count == 0) {
+        return dir;
+    }
+    return free_moves[rand_r(seed) % free_count];
+}
+
+static bool parse_move(char name, enum direction* dir) {
+    for (int d = 0; d < 4; d++) {
+        if (move_names[d] == name) {
+            *dir = (enum direction)d;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_boards(const struct engine_state* a, const struct engine_state* b, FILE* stream) {
+    static const char symbols[] = { [ENGINE_CELL_EMPTY] = '.', [ENGINE_CELL_WALL] = '#', [ENGINE_CELL_SNAKE] = 'o',
+        [ENGINE_CELL_FOOD] = '*', [ENGINE_CELL_INVALID] = '?' };
+    for (int y = 0; y < a->rows; y++) {
+        for (int x = 0; x < a->columns; x++) {
+            fputc(symbols[a->cells[y * a->columns + x]], stream);
+        }
+        fputs("   ", stream);
+        for (int x = 0; x < b->columns; x++) {
+            fputc(symbols[b->cells[y * b->columns + x]], stream);
+        }
+        fputc('\n', stream);
+    }
+}
+
+/**
+ * Run the reference and the candidate on a case.
+ *
+ * @param candidate The engine checked against the reference.
+ * @param case_seed The case (board, food seed).
+ * @param moves The input, one direction per tick; generated (and recorded) if input_seed is set.
+ * @param count The number of moves.
+ * @param input_seed rand_r state of the generated input, NULL to replay moves.
+ * @param divergence Receives the first divergence, tick -2 if none.
+ * @param verbose Print both boards at the divergence.
+ * @param recording Receives the reference game, may be NULL.
+ * @return The number of moves run, -1 if an engine could not be created.
+ */
+static long run_case(const struct engine_ops* candidate, unsigned int case_seed, char* moves, int count,
+    unsigned int* input_seed, struct divergence* divergence, bool verbose, struct recording* recording) {
+    struct engine_config config;
+    case_config(case_seed, &config);
+    divergence->tick = -2;
+
+    void* reference = engine_reference.create(&config);
+    void* other = candidate->create(&config);
+    struct engine_state* expected = engine_state_create(&config);
+    struct engine_state* actual = engine_state_create(&config);
+    long ticks = -1;
+    if (!reference || !other || !expected || !actual) {
+        goto cleanup;
+    }
+
+    enum direction dir = right;
+    for (ticks = 0; ticks <= count; ticks++) {
+        if (ticks > 0) {
+            if (input_seed) {
+                dir = random_move(expected, dir, input_seed);
+                moves[ticks - 1] = move_names[dir];
+            } else {
+                parse_move(moves[ticks - 1], &dir);
+            }
+            engine_reference.tick(reference, dir);
+            candidate->tick(other, dir);
+        }
+        engine_reference.snapshot(reference, expected);
+        candidate->snapshot(other, actual);
+        if (!engine_state_equal(expected, actual, divergence->diff, sizeof(divergence->diff))) {
+            divergence->tick = (int)ticks - 1;
+            if (verbose) {
+                printf("reference (left) and %s (right) after %ld move(s): %s\n", candidate->name, ticks, divergence->diff);
+                print_boards(expected, actual, stdout);
+            }
+            break;
+        }
+        if (recording && ticks > 0) {
+            const struct engine_point head = expected->body[expected->length - 1];
+            recording->ticks[ticks - 1] = (struct export_tick){
+                .head_x = (uint16_t)(head.x - config.border),
+                .head_y = (uint16_t)(head.y - config.border),
+                .length = (uint32_t)expected->length,
+                .score = (uint32_t)expected->score,
+                .food = (uint16_t)expected->food_count,
+            };
+        }
+        if (expected->status != ENGINE_RUNNING) {
+            break;
+        }
+    }
+    // The loop ends one past the last move when every move was run
+    if (ticks > count) {
+        ticks = count;
+    }
+    if (recording && ticks >= 0) {
+        static const uint8_t outcomes[] = {
+            [ENGINE_RUNNING] = EXPORT_OUTCOME_QUIT,
+            [ENGINE_HIT_WALL] = EXPORT_OUTCOME_WALL,
+            [ENGINE_HIT_SELF] = EXPORT_OUTCOME_SELF,
+            [ENGINE_WON] = EXPORT_OUTCOME_WON,
+        };
+        recording->game = (struct export_game){
+            .seed = case_seed,
+            .difficulty = EXPORT_SIMULATED,
+            .outcome = outcomes[expected->status],
+            .score = (uint32_t)expected->score,
+            .length = (uint32_t)expected->length,
+        };
+    }
+
+cleanup:
+    engine_state_destroy(&expected);
+    engine_state_destroy(&actual);
+    if (other) {
+        candidate->destroy(other);
+    }
+    if (reference) {
+        engine_reference.destroy(reference);
+    }
+    return ticks;
+}
+
+/**
+ * Delta debugging (ddmin): shrink the moves to a short sequence that still
+ * diverges, trying chunks alone then without each chunk, refining the chunks
+ * when nothing can be removed. Moves after the divergence are dropped.
+ *
+ * @return The number of moves left.
+ */
+static int minimize(const struct engine_ops* candidate, unsigned int case_seed, char* moves,
+    struct divergence* divergence) {
+    char trial[MAX_MOVES];
+    struct divergence result;
+    int granularity = 2;
+    int count = divergence->tick + 1;
+
+    while (count >= 2) {
+        const int chunk = (count + granularity - 1) / granularity;
+        bool reduced = false;
+        for (int pass = 0; pass < 2 && !reduced; pass++) {
+            for (int start = 0; start < count && !reduced; start += chunk) {
+                const int end = (start + chunk < count) ? start + chunk : count;
+                int length;
+                if (pass == 0) {
+                    length = end - start;
+                    memcpy(trial, moves + start, (size_t)length);
+                } else {
+                    memcpy(trial, moves, (size_t)start);
+                    memcpy(trial + start, moves + end, (size_t)(count - end));
+                    length = count - (end - start);
+                }
+                if (length == count || run_case(candidate, case_seed, trial, length, NULL, &result, false, NULL) < 0
+                    || result.tick < -1) {
+                    continue;
+                }
+                count = result.tick + 1;
+                memcpy(moves, trial, (size_t)count);
+                *divergence = result;
+                granularity = (pass == 0) ? 2 : (granularity > 2 ? granularity - 1 : 2);
+                reduced = true;
+            }
+        }
+        if (!reduced) {
+            if (granularity >= count) {
+                break;
+            }
+            granularity = (granularity * 2 < count) ? granularity * 2 : count;
+        }
+    }
+    return count;
+}
+
+static void* check_worker(void* arg) {
+    struct checker* checker = arg;
+    char moves[MAX_MOVES];
+    struct recording* recording = checker->export ? malloc(sizeof(struct recording)) : NULL;
+    while (!atomic_load(&checker->stop) && atomic_load(&checker->ticks) < checker->target_ticks) {
+        long index = atomic_fetch_add(&checker->next_case, 1);
+        unsigned int case_seed = case_seed_of(checker->seed, index);
+        unsigned int input_seed = ~case_seed;
+        struct divergence divergence;
+        long ticks = run_case(checker->candidate, case_seed, moves, MAX_MOVES, &input_seed, &divergence, false, recording);
+        if (ticks < 0) {
+            fprintf(stderr, "Failed to create the engines\n");
+            atomic_store(&checker->stop, true);
+            break;
+        }
+        atomic_fetch_add(&checker->ticks, ticks);
+        if (divergence.tick < -1) {
+            if (recording && !export_add_game(checker->export, &recording->game, recording->ticks, (uint32_t)ticks)) {
+                fprintf(stderr, "Failed to export case %u\n", case_seed);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&checker->lock);
+        if (!checker->failed || index < checker->failure.index) {
+            checker->failed = true;
+            checker->failure.index = index;
+            checker->failure.case_seed = case_seed;
+            checker->failure.count = divergence.tick + 1;
+            checker->failure.divergence = divergence;
+            memcpy(checker->failure.moves, moves, (size_t)checker->failure.count);
+        }
+        pthread_mutex_unlock(&checker->lock);
+        atomic_store(&checker->stop, true);
+    }
+    free(recording);
+    return NULL;
+}
+
+static bool write_repro(const char* path, unsigned int case_seed, const char* moves, int count) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open repro file: %s\n", path);
+        return false;
+    }
+    fprintf(file, "%u %.*s\n", case_seed, count, moves);
+    return fclose(file) == 0;
+}
+
+static int replay(const struct engine_ops* candidate, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open repro file: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    unsigned int case_seed;
+    char moves[MAX_MOVES + 1] = "";
+    int fields = fscanf(file, "%u %4096s", &case_seed, moves);
+    fclose(file);
+    if (fields < 1) {
+        fprintf(stderr, "Invalid repro file: %s (expected \"case_seed moves\")\n", path);
+        return EXIT_FAILURE;
+    }
+    const int count = (int)strlen(moves);
+    enum direction dir;
+    for (int i = 0; i < count; i++) {
+        if (!parse_move(moves[i], &dir)) {
+            fprintf(stderr, "Invalid move '%c' in %s (L, U, D or R)\n", moves[i], path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct divergence divergence;
+    long ticks = run_case(candidate, case_seed, moves, count, NULL, &divergence, true, NULL);
+    if (ticks < 0) {
+        return EXIT_FAILURE;
+    }
+    if (divergence.tick >= -1) {
+        return EXIT_FAILURE;
+    }
+    printf("case %u: %ld tick(s), %s matches the reference\n", case_seed, ticks, candidate->name);
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-e engine] [-t ticks] [-j threads] [-s seed] [-o repro] [-x dir]\n", name);
+    fprintf(stderr, "       %s [-e engine] -r repro\n", name);
+    fprintf(stderr, "Engines: ");
+    engine_list(stderr);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* engine_name = "grid";
+    const char* repro_in = NULL;
+    const char* repro_out = DEFAULT_REPRO;
+    const char* export_dir = NULL;
+    long target_ticks = DEFAULT_TICKS;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int seed = (unsigned int)time(NULL);
+
+    int option;
+    while ((option = getopt(argc, argv, "e:t:j:s:o:r:x:h")) != -1) {
+        switch (option) {
+        case 'e':
+            engine_name = optarg;
+            break;
+        case 't':
+            target_ticks = atol(optarg);
+            break;
+        case 'j':
+            threads = atol(optarg);
+            break;
+        case 's':
+            seed = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            repro_out = optarg;
+            break;
+        case 'r':
+            repro_in = optarg;
+            break;
+        case 'x':
+            export_dir = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    const struct engine_ops* candidate = engine_find(engine_name);
+    if (!candidate || optind != argc || target_ticks <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (repro_in) {
+        return replay(candidate, repro_in);
+    }
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    static struct checker checker;
+    checker.candidate = candidate;
+    checker.seed = seed;
+    checker.target_ticks = target_ticks;
+    atomic_init(&checker.next_case, 0);
+    atomic_init(&checker.ticks, 0);
+    atomic_init(&checker.stop, false);
+    pthread_mutex_init(&checker.lock, NULL);
+    if (export_dir) {
+        checker.export = export_open(export_dir, true);
+        if (!checker.export) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Checking %s against the reference: %ld ticks, %ld thread(s), seed %u\n",
+        candidate->name, target_ticks, threads, seed);
+    double start = now_ms();
+    pthread_t workers[MAX_THREADS];
+    long started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, check_worker, &checker) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        check_worker(&checker);
+    }
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    double elapsed = now_ms() - start;
+    pthread_mutex_destroy(&checker.lock);
+    if (checker.export && !export_close(&checker.export)) {
+        fprintf(stderr, "Failed to flush the export\n");
+    }
+
+    long ticks = atomic_load(&checker.ticks);
+    printf("%ld cases, %ld ticks in %.0f ms (%.0f ticks/s)\n",
+        atomic_load(&checker.next_case), ticks, elapsed, ticks * 1000.0 / (elapsed > 0.0 ? elapsed : 1.0));
+    if (!checker.failed) {
+        printf("No divergence\n");
+        return EXIT_SUCCESS;
+    }
+
+    struct failure* failure = &checker.failure;
+    printf("Divergence in case %u after %d move(s): %s\n",
+        failure->case_seed, failure->divergence.tick + 1, failure->divergence.diff);
+    int count = minimize(candidate, failure->case_seed, failure->moves, &failure->divergence);
+    printf("Minimized to %d move(s): %s\n", count, failure->divergence.diff);
+    if (write_repro(repro_out, failure->case_seed, failure->moves, count)) {
+        printf("Repro written to %s, replay with: %s -e %s -r %s\n", repro_out, argv[0], candidate->name, repro_out);
+    }
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,125 @@
+/**
+ * Font baker: rasterizes the printable ASCII glyphs of a TrueType pixel font
+ * into a C header of 1-bit glyph rows, compiled into the game (see draw_text).
+ * Runs at build time, so the game itself needs neither SDL_ttf nor the font file.
+ *
+ * Usage: ./fontbake font.ttf size output.h
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL_ttf.h>
+
+#define FIRST_CHAR 32
+#define LAST_CHAR 126
+#define MAX_GLYPH_WIDTH 16   // one uint16_t per glyph row
+
+struct glyph {
+    int width;
+    uint16_t rows[64];
+};
+
+/**
+ * Render one character and keep its ink pixels (non zero palette index of a solid surface).
+ */
+static bool bake_glyph(TTF_Font* font, char c, int height, struct glyph* glyph) {
+    const char text[2] = { c, '\0' };
+    SDL_Color ink = { 255, 255, 255, 255 };
+    SDL_Surface* surface = TTF_RenderText_Solid(font, text, ink);
+    if (!surface) {
+        fprintf(stderr, "Failed to render '%c': %s\n", c, TTF_GetError());
+        return false;
+    }
+    bool ok = surface->w <= MAX_GLYPH_WIDTH && surface->h <= height;
+    if (ok) {
+        glyph->width = surface->w;
+        SDL_LockSurface(surface);
+        for (int y = 0; y < surface->h; y++) {
+            const uint8_t* src = (const uint8_t*)surface->pixels + y * surface->pitch;
+            glyph->rows[y] = 0;
+            for (int x = 0; x < surface->w; x++) {
+                if (src[x] != 0) {
+                    glyph->rows[y] |= (uint16_t)(1u << x);
+                }
+            }
+        }
+        SDL_UnlockSurface(surface);
+    } else {
+        fprintf(stderr, "Glyph '%c' is %dx%d, more than %dx%d\n", c, surface->w, surface->h, MAX_GLYPH_WIDTH, height);
+    }
+    SDL_FreeSurface(surface);
+    return ok;
+}
+
+static bool write_header(const char* path, const char* font_path, int size, int width, int height,
+    const struct glyph* glyphs) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    fprintf(file, "// Generated by tools/fontbake from %s at size %d, do not edit.\n", font_path, size);
+    fprintf(file, "#ifndef _FONT_GLYPHS_H_\n#define _FONT_GLYPHS_H_\n\n#include <stdint.h>\n\n");
+    fprintf(file, "#define FONT_FIRST_CHAR %d\n", FIRST_CHAR);
+    fprintf(file, "#define FONT_LAST_CHAR %d\n", LAST_CHAR);
+    fprintf(file, "#define FONT_POINT_SIZE %d\n", size);
+    fprintf(file, "#define FONT_GLYPH_WIDTH %d    // advance, the font is monospaced\n", width);
+    fprintf(file, "#define FONT_GLYPH_HEIGHT %d\n\n", height);
+    fprintf(file, "// Bit x of a row is the pixel at column x\n");
+    fprintf(file, "static const uint16_t font_glyphs[%d][FONT_GLYPH_HEIGHT] = {\n", LAST_CHAR - FIRST_CHAR + 1);
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        fprintf(file, "    {");
+        for (int y = 0; y < height; y++) {
+            fprintf(file, "%s0x%04x", y ? ", " : " ", glyphs[c - FIRST_CHAR].rows[y]);
+        }
+        // A backslash would continue the comment on the next line
+        if (c == ' ' || c == '\\') {
+            fprintf(file, " },  // %d\n", c);
+        } else {
+            fprintf(file, " },  // %d %c\n", c, c);
+        }
+    }
+    fprintf(file, "};\n\n#endif\n");
+    bool ok = !ferror(file);
+    return (fclose(file) == 0) && ok;
+}
+
+int main(int argc, char const* argv[]) {
+    if (argc != 4 || atoi(argv[2]) <= 0) {
+        fprintf(stderr, "Usage: %s font.ttf size output.h\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const int size = atoi(argv[2]);
+
+    if (TTF_Init() == -1) {
+        fprintf(stderr, "Failed to initialize SDL_ttf: %s\n", TTF_GetError());
+        return EXIT_FAILURE;
+    }
+    TTF_Font* font = TTF_OpenFont(argv[1], size);
+    if (!font) {
+        fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
+        TTF_Quit();
+        return EXIT_FAILURE;
+    }
+
+    const int height = TTF_FontHeight(font);
+    static struct glyph glyphs[LAST_CHAR - FIRST_CHAR + 1];
+    bool ok = height > 0 && height <= (int)(sizeof(glyphs[0].rows) / sizeof(glyphs[0].rows[0]));
+    int width = 0;
+    for (int c = FIRST_CHAR; ok && c <= LAST_CHAR; c++) {
+        ok = bake_glyph(font, (char)c, height, &glyphs[c - FIRST_CHAR]);
+        if (ok && glyphs[c - FIRST_CHAR].width > width) {
+            width = glyphs[c - FIRST_CHAR].width;
+        }
+    }
+    TTF_CloseFont(font);
+    TTF_Quit();
+
+    if (!ok || !write_header(argv[3], argv[1], size, width, height, glyphs)) {
+        fprintf(stderr, "Failed to bake %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    printf("%s: %d glyphs of %dx%d pixels\n", argv[3], LAST_CHAR - FIRST_CHAR + 1, width, height);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+/**
+ * Drawing benchmark running on the offscreen gfx backend (no display needed).
+ *
+ * Usage: ./gfxbench [width] [height] [zoom] [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../bitboard/bitboard.h"
+#include "../bot/bot.h"
+#include "../gfx/gfx.h"
+#include "../snake/snake.h"
+#include "../food/food.h"
+#include "../menu/menu.h"
+#include "../trace/trace.h"
+
+#define BORDER_OFFSET 16
+
+// Keeps the results of measured functions alive
+static volatile long sink;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+static void report(const char* name, double total_ms, long operations) {
+    printf("%-24s %10ld ops %12.3f ms %12.1f ns/op\n",
+        name, operations, total_ms, total_ms * 1.0e6 / operations);
+}
+
+static void bench_clear(struct gfx_context_t* ctxt, int iterations) {
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        gfx_clear(ctxt, COLOR_BLACK);
+    }
+    report("gfx_clear", now_ms() - start, iterations);
+}
+
+static void bench_border(struct gfx_context_t* ctxt, int iterations) {
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        draw_border(ctxt, BORDER_OFFSET - 1, ctxt->width - BORDER_OFFSET + 1,
+            BORDER_OFFSET - 1, ctxt->height - BORDER_OFFSET + 1, COLOR_BLUE);
+    }
+    report("draw_border", now_ms() - start, iterations);
+}
+
+static void bench_cells(struct gfx_context_t* ctxt, int zoom, int iterations) {
+    long cells = 0;
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        uint32_t color = (i & 1) ? COLOR_WHITE : COLOR_BLACK;
+        for (uint32_t y = BORDER_OFFSET; y + zoom <= ctxt->height - BORDER_OFFSET; y += zoom) {
+            for (uint32_t x = BORDER_OFFSET; x + zoom <= ctxt->width - BORDER_OFFSET; x += zoom) {
+                draw_pixel(ctxt, x, y, zoom, color);
+                cells++;
+            }
+        }
+    }
+    report("draw_pixel (cell)", now_ms() - start, cells);
+}
+
+/**
+ * Cell fill and test cost for the specialized zooms and a generic one (7).
+ */
+static void bench_cell_kernels(struct gfx_context_t* ctxt, int iterations) {
+    static const int zooms[] = { 1, 2, 4, 8, 16, 32, 7 };
+    for (size_t z = 0; z < sizeof(zooms) / sizeof(zooms[0]); z++) {
+        const int zoom = zooms[z];
+        long cells = 0, empty = 0;
+        double fill_ms = 0.0, test_ms = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            double start = now_ms();
+            for (uint32_t y = 0; y + zoom <= ctxt->height; y += zoom) {
+                for (uint32_t x = 0; x + zoom <= ctxt->width; x += zoom) {
+                    draw_pixel(ctxt, x, y, zoom, COLOR_WHITE);
+                    cells++;
+                }
+            }
+            double middle = now_ms();
+            for (uint32_t y = 0; y + zoom <= ctxt->height; y += zoom) {
+                for (uint32_t x = 0; x + zoom <= ctxt->width; x += zoom) {
+                    empty += gfx_cell_is(ctxt, x, y, zoom, COLOR_BLACK);
+                }
+            }
+            fill_ms += middle - start;
+            test_ms += now_ms() - middle;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "cell fill zoom %d", zoom);
+        report(name, fill_ms, cells);
+        snprintf(name, sizeof(name), "cell test zoom %d", zoom);
+        report(name, test_ms, cells);
+        sink = empty;
+    }
+}
+
+/**
+ * Snake walking around the board: collision test plus head/tail redraw per move.
+ */
+static void bench_snake(struct gfx_context_t* ctxt, int zoom, int iterations) {
+    gfx_clear(ctxt, COLOR_BLACK);
+    struct queue_t* queue = init_snake(ctxt->width - BORDER_OFFSET - zoom, ctxt->height - BORDER_OFFSET - zoom, zoom);
+    draw_snake_initial(ctxt, queue, zoom, COLOR_WHITE);
+
+    const int x_min = BORDER_OFFSET;
+    const int x_max = ctxt->width - BORDER_OFFSET - zoom;
+    enum direction direction = right;
+    long moves = 0;
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        // Sweep right and left, stepping down a row at each end
+        int head_x = queue->tail->x;
+        if ((direction == right && head_x + zoom > x_max) || (direction == left && head_x - zoom < x_min)) {
+            struct coord_t* down_pos = new_position(down, queue->tail, zoom);
+            if (down_pos->y + zoom > (int)ctxt->height - BORDER_OFFSET) {
+                coord_free(down_pos);
+                break;
+            }
+            get_collision_type(ctxt, down_pos, zoom);
+            move_snake(ctxt, queue, down_pos, zoom, COLOR_WHITE, COLOR_BLACK);
+            direction = (direction == right) ? left : right;
+        }
+        struct coord_t* pos = new_position(direction, queue->tail, zoom);
+        get_collision_type(ctxt, pos, zoom);
+        move_snake(ctxt, queue, pos, zoom, COLOR_WHITE, COLOR_BLACK);
+        moves++;
+    }
+    report("snake move", now_ms() - start, moves);
+    queue_destroy(&queue);
+}
+
+static void bench_food(struct gfx_context_t* ctxt, int zoom, int iterations) {
+    gfx_clear(ctxt, COLOR_BLACK);
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        spawn_food(ctxt, BORDER_OFFSET, zoom, COLOR_BLACK, COLOR_RED);
+    }
+    report("spawn_food", now_ms() - start, iterations);
+}
+
+/**
+ * Flood fill and reachability on a 256x256 board with a serpentine wall
+ * pattern (worst case for row sweeps: the region turns back at every wall).
+ */
+static void bench_reachability(int iterations) {
+    const int size = 256;
+    struct bitboard_t* passable = bitboard_create(size, size);
+    struct bitboard_t* targets = bitboard_create(size, size);
+    struct bitboard_t* region = bitboard_create(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            // Walls every 8 rows, alternately open at the right and left end
+            bool wall = (y % 8 == 7) && ((y / 8) % 2 == 0 ? x < size - 1 : x > 0);
+            if (!wall) {
+                bitboard_set(passable, x, y);
+            }
+        }
+    }
+    bitboard_set(targets, size - 1, size - 1);
+
+    long cells = 0;
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        cells += bitboard_flood_fill(passable, 0, 0, region);
+    }
+    report("bitboard flood fill", now_ms() - start, iterations);
+
+    long reached = 0;
+    start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        reached += bitboard_reachable(passable, 0, 0, targets, region);
+    }
+    report("bitboard reachable", now_ms() - start, iterations);
+    sink = cells + reached;
+
+    bitboard_destroy(&passable);
+    bitboard_destroy(&targets);
+    bitboard_destroy(&region);
+}
+
+static void bench_text(struct gfx_context_t* ctxt, int iterations) {
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        draw_text(ctxt, "Your score is 1234", ctxt->width / 2 - 100, ctxt->height / 2, 32, COLOR_WHITE);
+    }
+    report("draw_text", now_ms() - start, iterations);
+}
+
+/**
+ * Search depth and speed of the bot for 1, 2, 4... threads up to the core
+ * count, with the budget of the HARD difficulty (15 ms, half of 30 ms).
+ */
+static void bench_bot(int width, int height, int zoom, int decisions) {
+    struct gfx_context_t* ctxt = gfx_create_backend("gfxbench", width / zoom, height / zoom, GFX_BACKEND_OFFSCREEN);
+    if (!ctxt) {
+        return;
+    }
+    const int border = BORDER_OFFSET / zoom;
+    draw_border(ctxt, border - 1, ctxt->width - border + 1, border - 1, ctxt->height - border + 1, COLOR_BLUE);
+    struct queue_t* queue = init_snake(ctxt->width, ctxt->height, 1);
+    draw_snake_initial(ctxt, queue, 1, COLOR_WHITE);
+    srand(1);
+    for (int i = 0; i < 10; i++) {
+        spawn_food(ctxt, border, 1, COLOR_BLACK, COLOR_RED);
+    }
+    struct bot_view view = {
+        .ctxt = ctxt,
+        .zoom = 1,
+        .queue = queue,
+        .direction = right,
+        .border = border,
+        .food_count = 10,
+        .max_food = 50,
+        .ticks_since_food = 0,
+        .food_interval_ticks = 3,
+    };
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long threads = 1; ; threads *= 2) {
+        if (threads > cores) {
+            threads = cores;
+        }
+        struct bot_t* bot = bot_create((int)threads);
+        if (!bot) {
+            break;
+        }
+        for (int i = 0; i < decisions; i++) {
+            sink += bot_decide(bot, &view, 15.0);
+        }
+        struct bot_stats stats;
+        bot_get_stats(bot, &stats);
+        printf("%-24s %2d thread(s) depth %5.1f (max %2d) %12.0f nodes/s %8llu steals\n",
+            "bot_decide (15 ms)", bot_threads(bot), (double)stats.depth_sum / stats.decisions, stats.max_depth,
+            stats.nodes * 1000.0 / stats.search_ms, (unsigned long long)stats.steals);
+        bot_destroy(&bot);
+        if (threads >= cores) {
+            break;
+        }
+    }
+    queue_destroy(&queue);
+    gfx_destroy(ctxt);
+}
+
+/**
+ * Present cost of a game board on the SDL renderer, for both present paths.
+ * Needs a display, or SDL_VIDEODRIVER=dummy for the software renderer.
+ */
+static void bench_present(int width, int height, int zoom, int iterations) {
+    struct gfx_context_t* ctxt = gfx_create_backend("gfxbench", width, height, GFX_BACKEND_SDL);
+    if (!ctxt || !gfx_set_scale(ctxt, zoom)) {
+        printf("%-24s skipped (no SDL renderer)\n", "gfx_present");
+        if (ctxt) {
+            gfx_destroy(ctxt);
+        }
+        return;
+    }
+
+    // Board at one pixel per cell: border, a long snake and some food
+    const int border = BORDER_OFFSET / zoom;
+    draw_border(ctxt, border - 1, ctxt->width - border + 1, border - 1, ctxt->height - border + 1, COLOR_BLUE);
+    for (uint32_t x = border; x < ctxt->width - border; x++) {
+        gfx_putpixel(ctxt, x, ctxt->height / 2, COLOR_WHITE);
+    }
+    for (int i = 0; i < 20; i++) {
+        spawn_food(ctxt, border, 1, COLOR_BLACK, COLOR_RED);
+    }
+
+    static const struct {
+        enum gfx_present_mode mode;
+        const char* name;
+    } modes[] = {
+        { GFX_PRESENT_TEXTURE, "gfx_present (texture)" },
+        { GFX_PRESENT_RECTS, "gfx_present (rects)" },
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        gfx_set_present_mode(ctxt, modes[m].mode);
+        gfx_present(ctxt);  // creates the rects path state
+        double start = now_ms();
+        for (int i = 0; i < iterations; i++) {
+            // A moving head keeps the frame dirty like in the game
+            gfx_putpixel(ctxt, border + i % (ctxt->width - 2 * border), ctxt->height / 2 + 1, (i & 1) ? COLOR_WHITE : COLOR_BLACK);
+            gfx_present(ctxt);
+        }
+        report(modes[m].name, now_ms() - start, iterations);
+    }
+    gfx_destroy(ctxt);
+}
+
+int main(int argc, char const* argv[]) {
+    int width = (argc > 1) ? atoi(argv[1]) : 1280;
+    int height = (argc > 2) ? atoi(argv[2]) : 800;
+    int zoom = (argc > 3) ? atoi(argv[3]) : 8;
+    int iterations = (argc > 4) ? atoi(argv[4]) : 200;
+    if (width <= 2 * BORDER_OFFSET || height <= 2 * BORDER_OFFSET || zoom <= 0 || iterations <= 0) {
+        fprintf(stderr, "Usage: %s [width] [height] [zoom] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    trace_init();
+    struct gfx_context_t* ctxt = gfx_create_backend("gfxbench", width, height, GFX_BACKEND_OFFSCREEN);
+    if (!ctxt) {
+        fprintf(stderr, "Graphics initialization failed!\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("offscreen %dx%d, zoom %d, %d iterations\n", width, height, zoom, iterations);
+    bench_clear(ctxt, iterations);
+    bench_border(ctxt, iterations);
+    bench_cells(ctxt, zoom, iterations);
+    bench_cell_kernels(ctxt, iterations);
+    bench_snake(ctxt, zoom, iterations * 100);
+    bench_food(ctxt, zoom, iterations);
+    bench_reachability(iterations);
+    bench_text(ctxt, iterations);
+    bench_bot(width, height, zoom, 20);
+
+    gfx_destroy(ctxt);
+    bench_present(width, height, zoom, iterations);
+    trace_shutdown();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+/**
+ * Level map compiler.
+ *
+ * Usage: ./mapc input.txt output.map   compile a text map
+ *        ./mapc -i level.map           print the header of a binary map
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../level/level.h"
+
+static int print_info(const char* path) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct level_t* level = level_load(path);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!level) {
+        return EXIT_FAILURE;
+    }
+
+    double load_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1.0e6;
+    printf("%s: %ux%u cells, %u spawn point(s), %u portal(s), loaded in %.3f ms\n",
+        path, level->header->width, level->header->height,
+        level->header->spawn_count, level->header->portal_count, load_ms);
+    for (uint32_t i = 0; i < level->header->portal_count; i++) {
+        const struct level_portal* portal = &level->portals[i];
+        printf("  portal %u: (%u, %u) <-> (%u, %u)\n", i, portal->a.x, portal->a.y, portal->b.x, portal->b.y);
+    }
+    level_unload(&level);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char const* argv[]) {
+    if (argc == 3 && strcmp(argv[1], "-i") == 0) {
+        return print_info(argv[2]);
+    }
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input.txt output.map\n", argv[0]);
+        fprintf(stderr, "       %s -i level.map\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return level_compile_text(argv[1], argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,168 @@
+#include "trace.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+struct trace_ring {
+    const char* thread_name;
+    _Atomic uint64_t written;   // events ever recorded, only stored by the owner thread
+    struct trace_event events[TRACE_RING_EVENTS];
+};
+
+atomic_bool trace_enabled = false;
+
+static const char* output_path = NULL;
+static struct trace_ring* rings = NULL;   // freed by trace_shutdown
+static int ring_capacity = 0;
+static atomic_int ring_count = 0;          // threads that asked for a ring, may exceed ring_capacity
+static volatile sig_atomic_t dump_requested = 0;
+
+// Ring of the calling thread, claimed on its first event; NULL once rings ran out
+static _Thread_local struct trace_ring* thread_ring = NULL;
+static _Thread_local bool thread_ring_claimed = false;
+static _Thread_local const char* pending_thread_name = NULL;
+
+static void trace_signal_handler(int signal) {
+    (void)signal;
+    dump_requested = 1;
+}
+
+uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void trace_init(void) {
+    const char* path = getenv("SNAKE_TRACE");
+    if (!path || !*path) {
+        return;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int capacity = TRACE_BASE_THREADS + ((cores > 0) ? (int)cores : 1);
+    rings = calloc((size_t)capacity, sizeof(struct trace_ring));
+    if (!rings) {
+        fprintf(stderr, "Failed to allocate memory for trace rings");
+        return;
+    }
+    ring_capacity = capacity;
+    output_path = path;
+    signal(SIGUSR1, trace_signal_handler);
+    trace_thread_name("main");
+    atomic_store_explicit(&trace_enabled, true, memory_order_relaxed);
+}
+
+static struct trace_ring* claim_ring(void) {
+    thread_ring_claimed = true;
+    int index = atomic_fetch_add(&ring_count, 1);
+    if (index >= ring_capacity) {
+        return NULL;
+    }
+    thread_ring = &rings[index];
+    thread_ring->thread_name = pending_thread_name;
+    return thread_ring;
+}
+
+void trace_thread_name(const char* name) {
+    pending_thread_name = name;
+    if (thread_ring) {
+        thread_ring->thread_name = name;
+    }
+}
+
+void trace_record(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+    // A scope entered before trace_shutdown ends after its rings were freed
+    if (__builtin_expect(!atomic_load_explicit(&trace_enabled, memory_order_relaxed), 0)) {
+        return;
+    }
+    struct trace_ring* ring = thread_ring;
+    if (__builtin_expect(!ring, 0)) {
+        if (thread_ring_claimed || !(ring = claim_ring())) {
+            return;
+        }
+    }
+    uint64_t written = atomic_load_explicit(&ring->written, memory_order_relaxed);
+    ring->events[written & (TRACE_RING_EVENTS - 1)] = (struct trace_event){ name, start_ns, duration_ns };
+    atomic_store_explicit(&ring->written, written + 1, memory_order_release);
+}
+
+bool trace_dump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    int count = atomic_load(&ring_count);
+    int untraced = 0;
+    if (count > ring_capacity) {
+        untraced = count - ring_capacity;
+        count = ring_capacity;
+    }
+    for (int tid = 0; tid < count; tid++) {
+        const struct trace_ring* ring = &rings[tid];
+        if (ring->thread_name) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", tid, ring->thread_name);
+            first = false;
+        }
+
+        uint64_t written = atomic_load_explicit(&ring->written, memory_order_acquire);
+        uint64_t begin = (written > TRACE_RING_EVENTS) ? written - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            const struct trace_event* event = &ring->events[i & (TRACE_RING_EVENTS - 1)];
+            // Timestamps are in microseconds
+            if (event->duration_ns == 0) {
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    first ? "" : ",\n", event->name, tid, event->start_ns / 1e3);
+            } else {
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", event->name, tid, event->start_ns / 1e3, event->duration_ns / 1e3);
+            }
+            first = false;
+        }
+    }
+    if (untraced > 0) {
+        // Global instant event, shown across the whole timeline
+        fprintf(file, "%s{\"name\":\"%d thread(s) not traced, %d rings\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+            first ? "" : ",\n", untraced, ring_capacity, trace_now_ns() / 1e3);
+        fprintf(stderr, "Trace: %d thread(s) not traced, all %d rings in use\n", untraced, ring_capacity);
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write trace file: %s\n", path);
+    }
+    return ok;
+}
+
+void trace_poll(void) {
+    if (__builtin_expect(dump_requested, 0)) {
+        dump_requested = 0;
+        if (output_path && trace_dump(output_path)) {
+            printf("Trace written to %s\n", output_path);
+        }
+    }
+}
+
+void trace_shutdown(void) {
+    if (!output_path) {
+        return;
+    }
+    atomic_store_explicit(&trace_enabled, false, memory_order_relaxed);
+    if (trace_dump(output_path)) {
+        printf("Trace written to %s\n", output_path);
+    }
+    output_path = NULL;
+    free(rings);
+    rings = NULL;
+    ring_capacity = 0;
+    thread_ring = NULL;
+}
@@ -0,0 +1,116 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Trace event recorder, exported as Chrome trace JSON (chrome://tracing,
+ * ui.perfetto.dev).
+ *
+ * Each thread records fixed-size events into its own ring buffer (no lock,
+ * no allocation); once full, the oldest events are overwritten. Recording is
+ * enabled at run time by SNAKE_TRACE=<output.json>: the rings are written to
+ * that file at exit, and on demand when the process receives SIGUSR1.
+ *
+ * The rings, TRACE_BASE_THREADS plus one per core, are allocated when tracing
+ * is enabled. Threads started once they are all claimed are not recorded;
+ * their number is reported in the export.
+ *
+ * The macros are compiled in only with -DSNAKE_TRACE; when compiled in but
+ * disabled, a scope costs a load and a not-taken branch.
+ */
+#define TRACE_RING_EVENTS 8192   // per thread, power of two
+#define TRACE_BASE_THREADS 4     // rings besides one per core: main, log and capture writers
+
+struct trace_event {
+    const char* name;     // string literal, never copied
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+struct trace_scope {
+    const char* name;
+    uint64_t start_ns;    // 0 if tracing was disabled when the scope was entered
+};
+
+// Read with relaxed loads: a scope only needs to see the flag eventually
+extern atomic_bool trace_enabled;
+
+/**
+ * Enable tracing if SNAKE_TRACE is set: allocate the rings and install the
+ * SIGUSR1 dump handler.
+ */
+void trace_init(void);
+
+/**
+ * Name the calling thread in the exported trace.
+ *
+ * @param name A string literal.
+ */
+void trace_thread_name(const char* name);
+
+/**
+ * Record a complete event in the calling thread ring.
+ *
+ * @param name A string literal.
+ * @param start_ns Start time (trace_now_ns).
+ * @param duration_ns Duration in nanoseconds.
+ */
+void trace_record(const char* name, uint64_t start_ns, uint64_t duration_ns);
+
+/**
+ * Write the rings as Chrome trace JSON. Events being overwritten by another
+ * thread during the dump may be inconsistent.
+ *
+ * @param path The output file.
+ * @return true on success, false otherwise.
+ */
+bool trace_dump(const char* path);
+
+/**
+ * Dump the rings if SIGUSR1 was received since the last call. Called from the main loop.
+ */
+void trace_poll(void);
+
+/**
+ * Dump the rings to the SNAKE_TRACE file, disable tracing and free the rings.
+ * Called once every other traced thread has stopped; later events of the
+ * calling thread are dropped.
+ */
+void trace_shutdown(void);
+
+uint64_t trace_now_ns(void);
+
+static inline struct trace_scope trace_scope_begin(const char* name) {
+    struct trace_scope scope = { name, 0 };
+    if (__builtin_expect(atomic_load_explicit(&trace_enabled, memory_order_relaxed), 0)) {
+        scope.start_ns = trace_now_ns();
+    }
+    return scope;
+}
+
+static inline void trace_scope_end(struct trace_scope* scope) {
+    if (__builtin_expect(scope->start_ns != 0, 0)) {
+        trace_record(scope->name, scope->start_ns, trace_now_ns() - scope->start_ns);
+    }
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef SNAKE_TRACE
+/// Trace the enclosing block, from this line to the end of the block.
+#define TRACE_SCOPE(name) \
+    struct trace_scope TRACE_CONCAT(trace_scope_, __LINE__) \
+    __attribute__((cleanup(trace_scope_end))) = trace_scope_begin(name)
+/// Trace a zero-duration event.
+#define TRACE_INSTANT(name) \
+    do { if (__builtin_expect(atomic_load_explicit(&trace_enabled, memory_order_relaxed), 0)) trace_record(name, trace_now_ns(), 0); } while (0)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#endif
+
+#endif